@@ -0,0 +1,682 @@
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "ObjectList.h"
+#include "ObjectPool.h"
+#include "Profiler.h"
+#include "SdkMeshAnimation.h"
+#include "SdkMeshHierarchy.h"
+#include "SdkMeshView.h"
+#include "SlotMap.h"
+#include "TestClothScene.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+	const int NUM_REPETITIONS = 5;
+
+	// results of measured loops, kept so that they are not optimized away
+	volatile std::uint64_t g_Checksum = 0;
+
+	class CounterObject : public Object
+	{
+	private:
+		void UpdateImpl() override
+		{
+			m_Count++;
+		}
+
+		std::uint32_t m_Count = 0;
+	};
+
+	// lightweight objects of several types, dispatched per object
+	template <int TYPE>
+	class VirtualObject : public Object
+	{
+	private:
+		void UpdateImpl() override
+		{
+			m_Value = m_Value * 3 + TYPE;
+		}
+
+		std::uint32_t m_Value = 0;
+	};
+
+	// the same objects, dispatched per type
+	template <int TYPE>
+	class TypeBatchedObject : public BatchedObject<TypeBatchedObject<TYPE>>
+	{
+		friend class BatchedObject<TypeBatchedObject<TYPE>>;
+
+	private:
+		void UpdateImpl() override
+		{
+			m_Value = m_Value * 3 + TYPE;
+		}
+
+		std::uint32_t m_Value = 0;
+	};
+
+	// interleave four types as objects added in arbitrary order would be
+	template <template <int> class ObjectType>
+	std::vector<ObjectHandle> MakeInterleavedObjects(std::size_t numObjects)
+	{
+		std::vector<ObjectHandle> objects;
+		objects.reserve(numObjects);
+		for (std::size_t i = 0; i < numObjects; i++)
+		{
+			switch (i % 4)
+			{
+			case 0: objects.push_back(MakeObjectHandle<ObjectType<0>>()); break;
+			case 1: objects.push_back(MakeObjectHandle<ObjectType<1>>()); break;
+			case 2: objects.push_back(MakeObjectHandle<ObjectType<2>>()); break;
+			default: objects.push_back(MakeObjectHandle<ObjectType<3>>()); break;
+			}
+		}
+
+		return objects;
+	}
+
+	// best of several runs of iterate(), in nanoseconds per object
+	template <typename Function>
+	double MeasureNanoseconds(std::size_t numObjects, Function iterate)
+	{
+		double best = 0.0;
+		for (int i = 0; i < NUM_REPETITIONS; i++)
+		{
+			CpuTimer timer;
+			iterate();
+			double milliseconds = timer.GetMilliseconds();
+			best = i == 0 ? milliseconds : std::min(best, milliseconds);
+		}
+
+		return best * 1e6 / numObjects;
+	}
+
+	template <typename T>
+	std::uint64_t AppendArray(std::vector<std::uint8_t>& file, const T* pElements, std::size_t count)
+	{
+		auto offset = file.size();
+		file.resize(offset + count * sizeof(T));
+		std::memcpy(file.data() + offset, pElements, count * sizeof(T));
+		return offset;
+	}
+
+	// .sdkmesh file of a grid of positions drawn in numSubsets subsets
+	std::vector<std::uint8_t> MakeSdkMesh(std::uint32_t resolution, std::uint32_t numSubsets)
+	{
+		using namespace SdkMesh;
+
+		std::vector<DirectX::XMFLOAT3> vertices;
+		for (std::uint32_t y = 0; y < resolution; y++)
+		{
+			for (std::uint32_t x = 0; x < resolution; x++)
+			{
+				vertices.push_back(DirectX::XMFLOAT3(static_cast<float>(x), static_cast<float>(y), 0.0f));
+			}
+		}
+
+		std::vector<std::uint32_t> indices;
+		for (std::uint32_t y = 0; y + 1 < resolution; y++)
+		{
+			for (std::uint32_t x = 0; x + 1 < resolution; x++)
+			{
+				std::uint32_t q = x + y * resolution;
+				for (auto i : { q, q + 1, q + 1 + resolution, q, q + 1 + resolution, q + resolution })
+				{
+					indices.push_back(i);
+				}
+			}
+		}
+
+		Header header = {};
+		header.Version = FILE_VERSION;
+		header.HeaderSize = sizeof(Header);
+		header.NumVertexBuffers = 1;
+		header.NumIndexBuffers = 1;
+		header.NumMeshes = 1;
+		header.NumTotalSubsets = numSubsets;
+		header.NumFrames = 1;
+		header.NumMaterials = 1;
+
+		VertexBufferHeader vertexBuffer = {};
+		vertexBuffer.NumVertices = vertices.size();
+		vertexBuffer.StrideBytes = sizeof(DirectX::XMFLOAT3);
+		vertexBuffer.SizeBytes = vertices.size() * sizeof(DirectX::XMFLOAT3);
+		vertexBuffer.Decl[0].Type = 2;
+		vertexBuffer.Decl[1].Stream = 0xff;
+		vertexBuffer.Decl[1].Type = 17;
+
+		IndexBufferHeader indexBuffer = {};
+		indexBuffer.NumIndices = indices.size();
+		indexBuffer.SizeBytes = indices.size() * sizeof(std::uint32_t);
+		indexBuffer.IndexType = INDEX_32BIT;
+
+		Mesh mesh = {};
+		mesh.NumVertexBuffers = 1;
+		mesh.NumSubsets = numSubsets;
+
+		// whole triangles per subset, the last one takes the rest
+		std::vector<Subset> subsets(numSubsets, Subset());
+		std::vector<std::uint32_t> subsetIndices;
+		auto numTriangles = indices.size() / 3;
+		for (std::uint32_t i = 0; i < numSubsets; i++)
+		{
+			subsets[i].IndexStart = numTriangles * i / numSubsets * 3;
+			subsets[i].IndexCount = numTriangles * (i + 1) / numSubsets * 3 - subsets[i].IndexStart;
+			subsets[i].VertexCount = vertices.size();
+			subsetIndices.push_back(i);
+		}
+
+		Frame frame = {};
+		frame.ParentFrame = INVALID_INDEX;
+		frame.ChildFrame = INVALID_INDEX;
+		frame.SiblingFrame = INVALID_INDEX;
+		frame.AnimationDataIndex = INVALID_INDEX;
+		Material material = {};
+
+		std::vector<std::uint8_t> file(sizeof(Header));
+		header.VertexStreamHeadersOffset = AppendArray(file, &vertexBuffer, 1);
+		header.IndexStreamHeadersOffset = AppendArray(file, &indexBuffer, 1);
+		header.MeshDataOffset = AppendArray(file, &mesh, 1);
+		header.SubsetDataOffset = AppendArray(file, subsets.data(), subsets.size());
+		header.FrameDataOffset = AppendArray(file, &frame, 1);
+		header.MaterialDataOffset = AppendArray(file, &material, 1);
+		mesh.SubsetOffset = AppendArray(file, subsetIndices.data(), subsetIndices.size());
+		mesh.FrameInfluenceOffset = file.size();
+		header.NonBufferDataSize = file.size() - sizeof(Header);
+
+		vertexBuffer.DataOffset = AppendArray(file, vertices.data(), vertices.size());
+		indexBuffer.DataOffset = AppendArray(file, indices.data(), indices.size());
+		header.BufferDataSize = file.size() - header.HeaderSize - header.NonBufferDataSize;
+
+		std::memcpy(file.data(), &header, sizeof(header));
+		std::memcpy(file.data() + header.VertexStreamHeadersOffset, &vertexBuffer, sizeof(vertexBuffer));
+		std::memcpy(file.data() + header.IndexStreamHeadersOffset, &indexBuffer, sizeof(indexBuffer));
+		std::memcpy(file.data() + header.MeshDataOffset, &mesh, sizeof(mesh));
+		return file;
+	}
+
+	// .sdkmesh_anim file of numTracks tracks swinging at different rates,
+	// every fourth one still, sampled at 30 keys per second
+	std::vector<std::uint8_t> MakeSdkMeshAnimation(std::uint32_t numTracks, std::uint32_t numKeys)
+	{
+		using namespace SdkMesh;
+
+		AnimationHeader header = {};
+		header.Version = FILE_VERSION;
+		header.NumFrames = numTracks;
+		header.NumAnimationKeys = numKeys;
+		header.AnimationFPS = 30;
+
+		std::vector<AnimationTrack> tracks(numTracks, AnimationTrack());
+		std::vector<AnimationKey> keys;
+		for (std::uint32_t iTrack = 0; iTrack < numTracks; iTrack++)
+		{
+			sprintf_s(tracks[iTrack].FrameName, "bone%u", iTrack);
+			tracks[iTrack].DataOffset = keys.size() * sizeof(AnimationKey);
+
+			float rate = iTrack % 4 == 0 ? 0.0f : 0.05f + 0.01f * (iTrack % 7);
+			for (std::uint32_t iKey = 0; iKey < numKeys; iKey++)
+			{
+				float angle = 0.5f * std::sin(rate * iKey);
+				AnimationKey key;
+				key.Translation = DirectX::XMFLOAT3(0.1f * (iTrack % 5), 0.0f, rate * iKey * 0.01f);
+				key.Orientation = DirectX::XMFLOAT4(std::sin(angle), 0.0f, 0.0f, std::cos(angle));
+				key.Scaling = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+				keys.push_back(key);
+			}
+		}
+
+		std::vector<std::uint8_t> file(sizeof(AnimationHeader));
+		AppendArray(file, keys.data(), keys.size());
+		header.AnimationDataOffset = AppendArray(file, tracks.data(), tracks.size());
+		header.AnimationDataSize = file.size() - sizeof(AnimationHeader);
+		std::memcpy(file.data(), &header, sizeof(header));
+		return file;
+	}
+
+	// .sdkmesh file of frames only, characters of 64 frames branching at
+	// random under a single root, named as the tracks of MakeSdkMeshAnimation
+	std::vector<std::uint8_t> MakeSdkMeshFrames(std::uint32_t numFrames)
+	{
+		using namespace SdkMesh;
+
+		const std::uint32_t CHARACTER_FRAMES = 64;
+
+		std::mt19937 random(1);
+		std::vector<Frame> frames(numFrames, Frame());
+		std::vector<std::uint32_t> lastChildren(numFrames, INVALID_INDEX);
+		for (std::uint32_t i = 0; i < numFrames; i++)
+		{
+			auto& frame = frames[i];
+			sprintf_s(frame.Name, "bone%u", i);
+			frame.Mesh = INVALID_INDEX;
+			frame.ParentFrame = INVALID_INDEX;
+			frame.ChildFrame = INVALID_INDEX;
+			frame.SiblingFrame = INVALID_INDEX;
+			frame.AnimationDataIndex = INVALID_INDEX;
+			DirectX::XMStoreFloat4x4(&frame.Matrix, DirectX::XMMatrixTranslation(0.0f, 0.1f, 0.01f * (i % 3)));
+			if (i == 0)
+			{
+				continue;
+			}
+
+			// characters hang from the root, their frames from earlier ones of the character
+			auto iCharacter = (i - 1) / CHARACTER_FRAMES * CHARACTER_FRAMES + 1;
+			frame.ParentFrame = i == iCharacter ? 0 : iCharacter + random() % (i - iCharacter);
+
+			auto& lastChild = lastChildren[frame.ParentFrame];
+			if (lastChild == INVALID_INDEX)
+			{
+				frames[frame.ParentFrame].ChildFrame = i;
+			}
+			else
+			{
+				frames[lastChild].SiblingFrame = i;
+			}
+			lastChild = i;
+		}
+
+		Header header = {};
+		header.Version = FILE_VERSION;
+		header.HeaderSize = sizeof(Header);
+		header.NumFrames = numFrames;
+
+		std::vector<std::uint8_t> file(sizeof(Header));
+		header.FrameDataOffset = AppendArray(file, frames.data(), frames.size());
+		header.NonBufferDataSize = file.size() - sizeof(Header);
+		std::memcpy(file.data(), &header, sizeof(header));
+		return file;
+	}
+
+	// world matrices as CDXUTSDKMesh::TransformFrame computes them
+	void TransformFrame(SdkMesh::Span<SdkMesh::Frame> frames, std::uint32_t iFrame,
+		const DirectX::XMMATRIX& parentWorld, std::vector<DirectX::XMFLOAT4X4>& worlds)
+	{
+		const auto& frame = frames[iFrame];
+		auto world = DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&frame.Matrix), parentWorld);
+		DirectX::XMStoreFloat4x4(&worlds[iFrame], world);
+
+		if (frame.SiblingFrame != SdkMesh::INVALID_INDEX)
+		{
+			TransformFrame(frames, frame.SiblingFrame, parentWorld, worlds);
+		}
+		if (frame.ChildFrame != SdkMesh::INVALID_INDEX)
+		{
+			TransformFrame(frames, frame.ChildFrame, world, worlds);
+		}
+	}
+
+	void Report(const std::wstring& name, double value)
+	{
+		OutputDebugStringW((name + L": " + std::to_wstring(value) + L"\n").c_str());
+		SetStatistic(name, value);
+	}
+}
+
+void RunObjectStorageBenchmark()
+{
+	const std::size_t NUM_OBJECTS[] = { 10000, 100000, 1000000 };
+
+	for (auto numObjects : NUM_OBJECTS)
+	{
+		std::vector<ObjectHandle> objects;
+		objects.reserve(numObjects);
+		for (std::size_t i = 0; i < numObjects; i++)
+		{
+			objects.push_back(MakeObjectHandle<CounterObject>());
+		}
+
+		std::unordered_set<ObjectHandle> hashSet;
+		SlotMap<ObjectHandle> slotMap;
+		std::vector<SlotHandle> handles;
+		handles.reserve(numObjects);
+		for (const auto& object : objects)
+		{
+			hashSet.insert(object);
+			handles.push_back(slotMap.Insert(object));
+		}
+
+		// churn a quarter of the objects, as spawning and despawning would
+		std::mt19937 random(numObjects);
+		for (std::size_t i = 0; i < numObjects / 4; i++)
+		{
+			auto index = random() % numObjects;
+			hashSet.erase(objects[index]);
+			hashSet.insert(objects[index]);
+			slotMap.Erase(handles[index]);
+			handles[index] = slotMap.Insert(objects[index]);
+		}
+
+		auto hashSetNanoseconds = MeasureNanoseconds(numObjects, [&]()
+		{
+			for (const auto& object : hashSet)
+			{
+				object->Update();
+			}
+		});
+
+		auto slotMapNanoseconds = MeasureNanoseconds(numObjects, [&]()
+		{
+			for (const auto& object : slotMap)
+			{
+				object->Update();
+			}
+		});
+
+		auto count = std::to_wstring(numObjects);
+		Report(L"Iterate " + count + L", unordered_set [ns/object]", hashSetNanoseconds);
+		Report(L"Iterate " + count + L", SlotMap [ns/object]", slotMapNanoseconds);
+	}
+}
+
+void RunObjectDispatchBenchmark()
+{
+	const std::size_t NUM_OBJECTS[] = { 1000, 10000, 100000 };
+
+	for (auto numObjects : NUM_OBJECTS)
+	{
+		auto virtualObjects = MakeInterleavedObjects<VirtualObject>(numObjects);
+		auto virtualNanoseconds = MeasureNanoseconds(numObjects, [&]()
+		{
+			for (const auto& object : virtualObjects)
+			{
+				object->Update();
+			}
+		});
+
+		// group by batch as ObjectList does when objects are added or removed
+		auto batchedObjects = MakeInterleavedObjects<TypeBatchedObject>(numObjects);
+		std::vector<const ObjectBatch*> batches;
+		std::vector<std::vector<Object*>> batchObjects;
+		for (const auto& object : batchedObjects)
+		{
+			auto pBatch = &object->GetBatch();
+			auto itr = std::find(batches.begin(), batches.end(), pBatch);
+			if (itr == batches.end())
+			{
+				batches.push_back(pBatch);
+				batchObjects.push_back(std::vector<Object*>());
+				itr = batches.end() - 1;
+			}
+			batchObjects[itr - batches.begin()].push_back(object.get());
+		}
+
+		auto batchedNanoseconds = MeasureNanoseconds(numObjects, [&]()
+		{
+			for (std::size_t i = 0; i < batches.size(); i++)
+			{
+				batches[i]->Update(batchObjects[i].data(), batchObjects[i].size());
+			}
+		});
+
+		auto count = std::to_wstring(numObjects);
+		Report(L"Update " + count + L", virtual [ns/object]", virtualNanoseconds);
+		Report(L"Update " + count + L", batched [ns/object]", batchedNanoseconds);
+	}
+}
+
+void RunObjectAllocationBenchmark()
+{
+	const std::size_t NUM_OBJECTS = 100000;
+
+	std::vector<ObjectHandle> objects;
+	objects.reserve(NUM_OBJECTS);
+
+	// spawn all, then destroy all; the pools return their chunks once empty,
+	// so every run allocates them again
+	auto heapNanoseconds = MeasureNanoseconds(NUM_OBJECTS, [&]()
+	{
+		for (std::size_t i = 0; i < NUM_OBJECTS; i++)
+		{
+			objects.push_back(ObjectHandle(new CounterObject()));
+		}
+		objects.clear();
+	});
+
+	auto pooledNanoseconds = MeasureNanoseconds(NUM_OBJECTS, [&]()
+	{
+		for (std::size_t i = 0; i < NUM_OBJECTS; i++)
+		{
+			objects.push_back(MakeObjectHandle<CounterObject>());
+		}
+		objects.clear();
+	});
+
+	FrameArena arena(NUM_OBJECTS * 128);
+	auto arenaNanoseconds = MeasureNanoseconds(NUM_OBJECTS, [&]()
+	{
+		for (std::size_t i = 0; i < NUM_OBJECTS; i++)
+		{
+			objects.push_back(MakeTransientObjectHandle<CounterObject>(arena));
+		}
+		objects.clear();
+		arena.Reset();
+	});
+
+	Report(L"Spawn/destroy 100000, new + shared_ptr [ns/object]", heapNanoseconds);
+	Report(L"Spawn/destroy 100000, pooled [ns/object]", pooledNanoseconds);
+	Report(L"Spawn/destroy 100000, frame arena [ns/object]", arenaNanoseconds);
+}
+
+void RunSceneLoadBenchmark()
+{
+	const std::size_t NUM_CLOTHS = 10000;
+	const std::size_t CREATE_BATCH_SIZE = 1000;
+
+	// cloths differing in placement and parameters, as in a sweep
+	std::ostringstream text;
+	text << "{\n\t\"defaults\": { \"pinnedRows\": [0], \"renderResolution\": 0 },\n\t\"cloths\": [\n";
+	for (std::size_t i = 0; i < NUM_CLOTHS; i++)
+	{
+		float x = 3.0f * (i % 100);
+		float z = 3.0f * (i / 100);
+		text << "\t\t{\n" <<
+			"\t\t\t\"resolution\": " << 16 + i % 4 * 16 << ",\n" <<
+			"\t\t\t\"corners\": [[" << x - 1 << ", 1, " << z << "], [" << x + 1 << ", 1, " << z <<
+			"], [" << x - 1 << ", -1, " << z << "], [" << x + 1 << ", -1, " << z << "]],\n" <<
+			"\t\t\t\"neighbour\": { \"stiffness\": " << 50000 + i << ", \"damping\": 30 },\n" <<
+			"\t\t\t\"bending\": { \"stiffness\": " << 400000 - i << ", \"damping\": 20.5 },\n" <<
+			"\t\t\t\"timeStep\": " << 0.0005 + 1e-7 * i << ",\n" <<
+			"\t\t\t\"colliders\": [{ \"shape\": \"sphere\", \"center\": [" << x << ", -0.5, " << z + 0.5 <<
+			"], \"radius\": 0.3 }]\n" <<
+			"\t\t}" << (i + 1 < NUM_CLOTHS ? ",\n" : "\n");
+	}
+	text << "\t]\n}\n";
+	auto scene = text.str();
+
+	auto nanoseconds = MeasureNanoseconds(NUM_CLOTHS, [&]()
+	{
+		TestCloth::ParseScene(scene.data(), scene.size());
+	});
+
+	auto parseMilliseconds = nanoseconds * NUM_CLOTHS * 1e-6;
+	Report(L"Parse scene 10000 cloths [ms]", parseMilliseconds);
+	Report(L"Parse scene 10000 cloths [MB/s]", scene.size() / (nanoseconds * NUM_CLOTHS * 1e-9) / (1024.0 * 1024.0));
+
+	// create the cloths as OnD3D11CreateDevice does, the first ones compiling
+	// the shaders. batches are released untimed to bound the GPU memory.
+	auto cloths = TestCloth::ParseScene(scene.data(), scene.size()).Cloths;
+	double createMilliseconds = 0.0;
+	std::vector<ObjectHandle> objects;
+	for (std::size_t begin = 0; begin < cloths.size(); begin += CREATE_BATCH_SIZE)
+	{
+		auto end = std::min(begin + CREATE_BATCH_SIZE, cloths.size());
+		CpuTimer timer;
+		for (auto i = begin; i < end; i++)
+		{
+			objects.push_back(TestCloth::CreateObject(cloths[i]));
+		}
+		createMilliseconds += timer.GetMilliseconds();
+		objects.clear();
+	}
+
+	Report(L"Create scene 10000 cloths [ms]", createMilliseconds);
+	Report(L"Load scene 10000 cloths [ms]", parseMilliseconds + createMilliseconds);
+}
+
+void RunSdkMeshValidationBenchmark()
+{
+	const std::uint32_t NUM_SUBSETS = 16;
+
+	for (std::uint32_t resolution : { 100u, 316u, 1000u })
+	{
+		auto file = MakeSdkMesh(resolution, NUM_SUBSETS);
+
+		// a single pass over the bytes, as copying or uploading the file takes at least
+		auto readNanoseconds = MeasureNanoseconds(file.size(), [&]()
+		{
+			std::uint64_t sum = 0;
+			auto pWords = reinterpret_cast<const std::uint64_t*>(file.data());
+			for (std::size_t i = 0; i < file.size() / sizeof(std::uint64_t); i++)
+			{
+				sum += pWords[i];
+			}
+			g_Checksum = sum;
+		});
+
+		auto validateNanoseconds = MeasureNanoseconds(file.size(), [&]()
+		{
+			SdkMesh::View(file.data(), file.size()).Validate();
+		});
+
+		auto count = std::to_wstring(resolution * resolution);
+		Report(L"Validate SDKmesh " + count + L" vertices [ms]", validateNanoseconds * file.size() * 1e-6);
+		Report(L"Validate SDKmesh " + count + L" vertices [MB/s]", 1e9 / validateNanoseconds / (1024.0 * 1024.0));
+		Report(L"Read SDKmesh " + count + L" vertices [MB/s]", 1e9 / readNanoseconds / (1024.0 * 1024.0));
+	}
+}
+
+void RunSdkMeshAnimationBenchmark()
+{
+	const std::uint32_t NUM_KEYS = 241;
+	const std::uint32_t NUM_SAMPLES = 600;
+	const double SAMPLE_INTERVAL = 1.0 / 60.0;
+
+	for (std::uint32_t numBones : { 100u, 1000u, 10000u })
+	{
+		auto file = MakeSdkMeshAnimation(numBones, NUM_KEYS);
+		SdkMesh::AnimationView view(file.data(), file.size());
+		SdkMesh::AnimationClip clip(view);
+		SdkMesh::RigidTransforms pose;
+
+		// frames played in order, looping every 8 seconds
+		SdkMesh::AnimationSampler sampler(clip);
+		auto advancingNanoseconds = MeasureNanoseconds(numBones * NUM_SAMPLES, [&]()
+		{
+			for (std::uint32_t i = 0; i < NUM_SAMPLES; i++)
+			{
+				sampler.Sample(i * SAMPLE_INTERVAL, pose);
+			}
+		});
+
+		std::mt19937 random(1);
+		std::uniform_real_distribution<double> times(0.0, 8.0);
+		std::vector<double> seeks(NUM_SAMPLES);
+		for (auto& time : seeks)
+		{
+			time = times(random);
+		}
+		auto seekingNanoseconds = MeasureNanoseconds(numBones * NUM_SAMPLES, [&]()
+		{
+			for (auto time : seeks)
+			{
+				sampler.Sample(time, pose);
+			}
+		});
+
+		// bone by bone from the keys in the file, as CDXUTSDKMesh::TransformFrame
+		// reads them, interpolated with DirectXMath
+		std::vector<DirectX::XMFLOAT4> translations(numBones);
+		std::vector<DirectX::XMFLOAT4> rotations(numBones);
+		auto perBoneNanoseconds = MeasureNanoseconds(numBones * NUM_SAMPLES, [&]()
+		{
+			for (std::uint32_t i = 0; i < NUM_SAMPLES; i++)
+			{
+				double position = std::fmod(i * SAMPLE_INTERVAL * 30.0, NUM_KEYS - 1.0);
+				auto iKey = static_cast<std::uint32_t>(position);
+				auto weight = static_cast<float>(position - iKey);
+				auto iNextKey = iKey + 1 < NUM_KEYS - 1 ? iKey + 1 : 0;
+
+				for (std::uint32_t iBone = 0; iBone < numBones; iBone++)
+				{
+					auto keys = view.GetKeys(iBone);
+					const auto& from = keys[1 + iKey];
+					const auto& to = keys[1 + iNextKey];
+					DirectX::XMStoreFloat4(&translations[iBone], DirectX::XMVectorLerp(
+						DirectX::XMLoadFloat3(&from.Translation), DirectX::XMLoadFloat3(&to.Translation), weight));
+					DirectX::XMStoreFloat4(&rotations[iBone], DirectX::XMQuaternionSlerp(
+						DirectX::XMQuaternionNormalize(DirectX::XMLoadFloat4(&from.Orientation)),
+						DirectX::XMQuaternionNormalize(DirectX::XMLoadFloat4(&to.Orientation)), weight));
+				}
+			}
+		});
+
+		auto count = std::to_wstring(numBones);
+		Report(L"Animation " + count + L" bones, keys kept [%]",
+			100.0 * clip.GetNumKeys() / (numBones * (NUM_KEYS - 1.0)));
+		Report(L"Animation " + count + L" bones, advancing [ns/bone]", advancingNanoseconds);
+		Report(L"Animation " + count + L" bones, seeking [ns/bone]", seekingNanoseconds);
+		Report(L"Animation " + count + L" bones, per bone [ns/bone]", perBoneNanoseconds);
+	}
+}
+
+void RunSdkMeshHierarchyBenchmark()
+{
+	// the values of the keys do not change the cost of the transforms
+	const std::uint32_t NUM_KEYS = 3;
+
+	ThreadPool pool;
+	for (std::uint32_t numFrames : { 1000u, 10000u, 100000u })
+	{
+		auto file = MakeSdkMeshFrames(numFrames);
+		SdkMesh::View view(file.data(), file.size());
+		view.Validate();
+
+		auto identity = DirectX::XMMatrixIdentity();
+		std::vector<DirectX::XMFLOAT4X4> worlds(numFrames);
+		auto recursiveNanoseconds = MeasureNanoseconds(numFrames, [&]()
+		{
+			TransformFrame(view.GetFrames(), 0, identity, worlds);
+		});
+
+		SdkMesh::FrameHierarchy hierarchy(view);
+		auto flattenedNanoseconds = MeasureNanoseconds(numFrames, [&]()
+		{
+			hierarchy.Transform(identity);
+		});
+		auto parallelNanoseconds = MeasureNanoseconds(numFrames, [&]()
+		{
+			hierarchy.Transform(identity, nullptr, &pool);
+		});
+
+		// every frame posed, as by the tracks of a character
+		auto animation = MakeSdkMeshAnimation(numFrames, NUM_KEYS);
+		SdkMesh::AnimationView animationView(animation.data(), animation.size());
+		SdkMesh::AnimationClip clip(animationView);
+		SdkMesh::AnimationSampler sampler(clip);
+		SdkMesh::RigidTransforms pose;
+		sampler.Sample(1.0, pose);
+		hierarchy.BindAnimation(clip);
+		auto animatedNanoseconds = MeasureNanoseconds(numFrames, [&]()
+		{
+			hierarchy.Transform(identity, &pose, &pool);
+		});
+
+		auto count = std::to_wstring(numFrames);
+		Report(L"Hierarchy " + count + L" frames, tasks", hierarchy.GetNumTasks());
+		Report(L"Hierarchy " + count + L" frames, recursive [ns/frame]", recursiveNanoseconds);
+		Report(L"Hierarchy " + count + L" frames, flattened [ns/frame]", flattenedNanoseconds);
+		Report(L"Hierarchy " + count + L" frames, parallel [ns/frame]", parallelNanoseconds);
+		Report(L"Hierarchy " + count + L" frames, animated parallel [ns/frame]", animatedNanoseconds);
+	}
+}
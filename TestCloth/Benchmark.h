@@ -0,0 +1,25 @@
+#pragma once
+
+// CPU microbenchmarks run on demand from the keyboard.
+// results are written to the debug output and shown on the HUD.
+
+// iteration cost of the ObjectList containers at 10k-1M objects
+void RunObjectStorageBenchmark();
+
+// per-object virtual dispatch against type-batched dispatch
+void RunObjectDispatchBenchmark();
+
+// spawn and destroy throughput of 100k objects for each allocation scheme
+void RunObjectAllocationBenchmark();
+
+// parse and creation time of a scene file declaring 10k cloths, see TestClothScene.h
+void RunSceneLoadBenchmark();
+
+// validation cost of SDKmesh files of 10k-1M vertices against reading them once
+void RunSdkMeshValidationBenchmark();
+
+// SDKmesh animation sampling throughput at 100-10k bones
+void RunSdkMeshAnimationBenchmark();
+
+// SDKmesh frame hierarchy transforms at 1k-100k frames, recursive against flattened
+void RunSdkMeshHierarchyBenchmark();
@@ -0,0 +1,144 @@
+#include "stdafx.h"
+#include "Culling.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+
+Frustum MakeFrustum(const XMMATRIX& view, const XMMATRIX& projection, float maxDistance)
+{
+	// planes from the columns of the row-vector view projection matrix
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, view * projection);
+
+	XMVECTOR column[4];
+	for (int i = 0; i < 4; i++)
+	{
+		column[i] = XMVectorSet(m.m[0][i], m.m[1][i], m.m[2][i], m.m[3][i]);
+	}
+
+	XMVECTOR planes[6] =
+	{
+		column[3] + column[0],
+		column[3] - column[0],
+		column[3] + column[1],
+		column[3] - column[1],
+		column[2],
+		column[3] - column[2],
+	};
+
+	Frustum frustum;
+	for (int i = 0; i < 6; i++)
+	{
+		XMStoreFloat4(&frustum.Planes[i], XMPlaneNormalize(planes[i]));
+	}
+
+	XMVECTOR determinant;
+	XMStoreFloat3(&frustum.Eye, XMMatrixInverse(&determinant, view).r[3]);
+	frustum.MaxDistance = maxDistance;
+
+	return frustum;
+}
+
+void BoundingBoxes::Clear()
+{
+	m_CenterX.clear();
+	m_CenterY.clear();
+	m_CenterZ.clear();
+	m_ExtentX.clear();
+	m_ExtentY.clear();
+	m_ExtentZ.clear();
+}
+
+void BoundingBoxes::Add(const XMFLOAT3& min, const XMFLOAT3& max)
+{
+	m_CenterX.push_back(0.5f * (min.x + max.x));
+	m_CenterY.push_back(0.5f * (min.y + max.y));
+	m_CenterZ.push_back(0.5f * (min.z + max.z));
+	m_ExtentX.push_back(0.5f * (max.x - min.x));
+	m_ExtentY.push_back(0.5f * (max.y - min.y));
+	m_ExtentZ.push_back(0.5f * (max.z - min.z));
+}
+
+void BoundingBoxes::Cull(const Frustum& frustum, std::vector<std::uint8_t>& visible) const
+{
+	auto numBoxes = Size();
+	visible.resize(numBoxes);
+
+	// splat every plane once; |normal| gives the projected extent of a box
+	XMVECTOR planeX[6], planeY[6], planeZ[6], planeW[6];
+	XMVECTOR absX[6], absY[6], absZ[6];
+	for (int i = 0; i < 6; i++)
+	{
+		auto plane = XMLoadFloat4(&frustum.Planes[i]);
+		planeX[i] = XMVectorSplatX(plane);
+		planeY[i] = XMVectorSplatY(plane);
+		planeZ[i] = XMVectorSplatZ(plane);
+		planeW[i] = XMVectorSplatW(plane);
+		absX[i] = XMVectorAbs(planeX[i]);
+		absY[i] = XMVectorAbs(planeY[i]);
+		absZ[i] = XMVectorAbs(planeZ[i]);
+	}
+
+	auto eye = XMLoadFloat3(&frustum.Eye);
+	auto eyeX = XMVectorSplatX(eye);
+	auto eyeY = XMVectorSplatY(eye);
+	auto eyeZ = XMVectorSplatZ(eye);
+	auto maxDistanceSq = XMVectorReplicate(frustum.MaxDistance * frustum.MaxDistance);
+	bool distanceCulling = frustum.MaxDistance > 0.0f;
+
+	// four boxes at a time; the tail is padded with copies of the last box
+	auto load = [numBoxes](const std::vector<float>& values, std::size_t i) -> XMVECTOR
+	{
+		if (i + 4 <= numBoxes)
+		{
+			return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&values[i]));
+		}
+
+		XMFLOAT4 padded(values[i],
+			values[std::min(i + 1, numBoxes - 1)],
+			values[std::min(i + 2, numBoxes - 1)],
+			values[std::min(i + 3, numBoxes - 1)]);
+		return XMLoadFloat4(&padded);
+	};
+
+	for (std::size_t i = 0; i < numBoxes; i += 4)
+	{
+		auto centerX = load(m_CenterX, i);
+		auto centerY = load(m_CenterY, i);
+		auto centerZ = load(m_CenterZ, i);
+		auto extentX = load(m_ExtentX, i);
+		auto extentY = load(m_ExtentY, i);
+		auto extentZ = load(m_ExtentZ, i);
+
+		// outside if the box is entirely behind any plane
+		auto outside = XMVectorFalseInt();
+		for (int p = 0; p < 6; p++)
+		{
+			auto distance = XMVectorMultiplyAdd(centerX, planeX[p],
+				XMVectorMultiplyAdd(centerY, planeY[p],
+				XMVectorMultiplyAdd(centerZ, planeZ[p], planeW[p])));
+			auto radius = XMVectorMultiplyAdd(extentX, absX[p],
+				XMVectorMultiplyAdd(extentY, absY[p], extentZ * absZ[p]));
+			outside = XMVectorOrInt(outside, XMVectorLess(distance + radius, XMVectorZero()));
+		}
+
+		// squared distance from the eye to the closest point of the box
+		if (distanceCulling)
+		{
+			auto dx = XMVectorMax(XMVectorAbs(centerX - eyeX) - extentX, XMVectorZero());
+			auto dy = XMVectorMax(XMVectorAbs(centerY - eyeY) - extentY, XMVectorZero());
+			auto dz = XMVectorMax(XMVectorAbs(centerZ - eyeZ) - extentZ, XMVectorZero());
+			auto distanceSq = XMVectorMultiplyAdd(dx, dx, XMVectorMultiplyAdd(dy, dy, dz * dz));
+			outside = XMVectorOrInt(outside, XMVectorGreater(distanceSq, maxDistanceSq));
+		}
+
+		XMUINT4 mask;
+		XMStoreUInt4(&mask, outside);
+		const std::uint32_t masks[4] = { mask.x, mask.y, mask.z, mask.w };
+		for (std::size_t lane = 0; lane < 4 && i + lane < numBoxes; lane++)
+		{
+			visible[i + lane] = masks[lane] == 0 ? 1 : 0;
+		}
+	}
+}
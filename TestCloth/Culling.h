@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// view frustum planes (pointing inside) and the eye position
+struct Frustum
+{
+	DirectX::XMFLOAT4 Planes[6];
+	DirectX::XMFLOAT3 Eye;
+
+	// boxes farther from the eye are culled (0 disables distance culling)
+	float MaxDistance;
+};
+
+Frustum MakeFrustum(const DirectX::XMMATRIX& view, const DirectX::XMMATRIX& projection,
+	float maxDistance);
+
+// axis-aligned bounding boxes in structure-of-arrays layout,
+// so that four boxes are tested at once
+class BoundingBoxes
+{
+public:
+	void Clear();
+	void Add(const DirectX::XMFLOAT3& min, const DirectX::XMFLOAT3& max);
+
+	std::size_t Size() const { return m_CenterX.size(); }
+
+	// visible[i] is set to 1 if box i intersects the frustum, 0 otherwise
+	void Cull(const Frustum& frustum, std::vector<std::uint8_t>& visible) const;
+
+private:
+	std::vector<float> m_CenterX, m_CenterY, m_CenterZ;
+	std::vector<float> m_ExtentX, m_ExtentY, m_ExtentZ;
+};
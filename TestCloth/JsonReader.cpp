@@ -0,0 +1,334 @@
+#include "stdafx.h"
+#include "JsonReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	// powers of ten exactly representable as double
+	const double POWERS_OF_TEN[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+		1e21, 1e22,
+	};
+	const int MAX_EXACT_POWER = 22;
+
+	// digits beyond are dropped from the mantissa, only their count is kept
+	const std::uint64_t MAX_MANTISSA = 100000000000000000ull;
+
+	bool IsDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	double ScaleByPowerOfTen(double value, int exponent)
+	{
+		while (exponent > MAX_EXACT_POWER)
+		{
+			value *= POWERS_OF_TEN[MAX_EXACT_POWER];
+			exponent -= MAX_EXACT_POWER;
+		}
+		while (exponent < -MAX_EXACT_POWER)
+		{
+			value /= POWERS_OF_TEN[MAX_EXACT_POWER];
+			exponent += MAX_EXACT_POWER;
+		}
+
+		return exponent >= 0 ? value * POWERS_OF_TEN[exponent] : value / POWERS_OF_TEN[-exponent];
+	}
+}
+
+bool JsonString::operator==(const char* pText) const
+{
+	return std::strlen(pText) == Length && std::memcmp(pBegin, pText, Length) == 0;
+}
+
+JsonReader::JsonReader(const char* pBegin, const char* pEnd)
+	: m_pBegin(pBegin)
+	, m_pPosition(pBegin)
+	, m_pEnd(pEnd)
+{
+}
+
+void JsonReader::BeginObject()
+{
+	Expect('{', "Expected an object");
+	m_First = true;
+}
+
+bool JsonReader::NextMember(JsonString& name)
+{
+	if (Peek() == '}')
+	{
+		m_pPosition++;
+		m_First = false;
+		return false;
+	}
+
+	if (!m_First)
+	{
+		Expect(',', "Expected ',' or '}'");
+	}
+	m_First = false;
+
+	name = ReadString();
+	Expect(':', "Expected ':'");
+	return true;
+}
+
+void JsonReader::BeginArray()
+{
+	Expect('[', "Expected an array");
+	m_First = true;
+}
+
+bool JsonReader::NextElement()
+{
+	if (Peek() == ']')
+	{
+		m_pPosition++;
+		m_First = false;
+		return false;
+	}
+
+	if (!m_First)
+	{
+		Expect(',', "Expected ',' or ']'");
+	}
+	m_First = false;
+	return true;
+}
+
+double JsonReader::ReadNumber()
+{
+	Peek();
+	auto p = m_pPosition;
+
+	bool negative = p != m_pEnd && *p == '-';
+	if (negative)
+	{
+		p++;
+	}
+	if (p == m_pEnd || !IsDigit(*p))
+	{
+		Fail("Expected a number");
+	}
+
+	std::uint64_t mantissa = 0;
+	int exponent = 0;
+	for (; p != m_pEnd && IsDigit(*p); p++)
+	{
+		if (mantissa < MAX_MANTISSA)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+		}
+		else
+		{
+			exponent++;
+		}
+	}
+
+	if (p != m_pEnd && *p == '.')
+	{
+		p++;
+		if (p == m_pEnd || !IsDigit(*p))
+		{
+			Fail("Expected digits after '.'");
+		}
+		for (; p != m_pEnd && IsDigit(*p); p++)
+		{
+			if (mantissa < MAX_MANTISSA)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				exponent--;
+			}
+		}
+	}
+
+	if (p != m_pEnd && (*p == 'e' || *p == 'E'))
+	{
+		p++;
+		bool negativeExponent = p != m_pEnd && *p == '-';
+		if (p != m_pEnd && (*p == '-' || *p == '+'))
+		{
+			p++;
+		}
+		if (p == m_pEnd || !IsDigit(*p))
+		{
+			Fail("Expected digits of the exponent");
+		}
+
+		int explicitExponent = 0;
+		for (; p != m_pEnd && IsDigit(*p); p++)
+		{
+			explicitExponent = std::min(explicitExponent * 10 + (*p - '0'), 100000);
+		}
+		exponent += negativeExponent ? -explicitExponent : explicitExponent;
+	}
+
+	m_pPosition = p;
+
+	auto value = mantissa == 0 ? 0.0 : ScaleByPowerOfTen(static_cast<double>(mantissa), exponent);
+	return negative ? -value : value;
+}
+
+float JsonReader::ReadFloat()
+{
+	return static_cast<float>(ReadNumber());
+}
+
+std::uint32_t JsonReader::ReadUint()
+{
+	auto value = ReadNumber();
+	if (value < 0.0 || value > 4294967295.0 || value != static_cast<double>(static_cast<std::uint32_t>(value)))
+	{
+		Fail("Expected an unsigned integer");
+	}
+	return static_cast<std::uint32_t>(value);
+}
+
+bool JsonReader::ReadBool()
+{
+	Peek();
+	auto remaining = static_cast<std::size_t>(m_pEnd - m_pPosition);
+	if (remaining >= 4 && std::strncmp(m_pPosition, "true", 4) == 0)
+	{
+		m_pPosition += 4;
+		return true;
+	}
+	if (remaining >= 5 && std::strncmp(m_pPosition, "false", 5) == 0)
+	{
+		m_pPosition += 5;
+		return false;
+	}
+
+	Fail("Expected true or false");
+	return false;
+}
+
+JsonString JsonReader::ReadString()
+{
+	Expect('"', "Expected a string");
+
+	JsonString string;
+	string.pBegin = m_pPosition;
+	for (;;)
+	{
+		if (m_pPosition == m_pEnd || *m_pPosition == '\n')
+		{
+			Fail("Unterminated string");
+		}
+
+		auto c = *m_pPosition++;
+		if (c == '"')
+		{
+			break;
+		}
+		if (c == '\\')
+		{
+			if (m_pPosition == m_pEnd)
+			{
+				Fail("Unterminated string");
+			}
+			m_pPosition++;
+		}
+	}
+
+	string.Length = static_cast<std::size_t>(m_pPosition - 1 - string.pBegin);
+	return string;
+}
+
+void JsonReader::SkipValue()
+{
+	switch (Peek())
+	{
+	case '{':
+	{
+		BeginObject();
+		JsonString name;
+		while (NextMember(name))
+		{
+			SkipValue();
+		}
+		break;
+	}
+
+	case '[':
+		BeginArray();
+		while (NextElement())
+		{
+			SkipValue();
+		}
+		break;
+
+	case '"':
+		ReadString();
+		break;
+
+	case 't':
+	case 'f':
+		ReadBool();
+		break;
+
+	case 'n':
+		if (m_pEnd - m_pPosition < 4 || std::strncmp(m_pPosition, "null", 4) != 0)
+		{
+			Fail("Expected a value");
+		}
+		m_pPosition += 4;
+		break;
+
+	default:
+		ReadNumber();
+		break;
+	}
+}
+
+void JsonReader::End()
+{
+	if (Peek() != 0)
+	{
+		Fail("Expected the end of the file");
+	}
+}
+
+void JsonReader::Fail(const char* pMessage) const
+{
+	auto line = 1 + std::count(m_pBegin, m_pPosition, '\n');
+	throw std::runtime_error(std::string(pMessage) + " in line " + std::to_string(line));
+}
+
+char JsonReader::Peek()
+{
+	while (m_pPosition != m_pEnd)
+	{
+		auto c = *m_pPosition;
+		if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+		{
+			m_pPosition++;
+		}
+		else if (c == '/' && m_pEnd - m_pPosition >= 2 && m_pPosition[1] == '/')
+		{
+			m_pPosition = std::find(m_pPosition, m_pEnd, '\n');
+		}
+		else
+		{
+			return c;
+		}
+	}
+
+	return 0;
+}
+
+void JsonReader::Expect(char c, const char* pMessage)
+{
+	if (Peek() != c)
+	{
+		Fail(pMessage);
+	}
+	m_pPosition++;
+}
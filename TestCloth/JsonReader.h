@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// characters of a string within the text read, without the quotes.
+// escape sequences are kept as written.
+struct JsonString
+{
+	const char* pBegin;
+	std::size_t Length;
+
+	bool operator==(const char* pText) const;
+	bool operator!=(const char* pText) const { return !(*this == pText); }
+};
+
+// pull parser over JSON text in memory, e.g. a mapped file. it neither
+// allocates nor copies, strings are returned as ranges of the text.
+// line comments starting with // are allowed where whitespace is.
+// errors throw std::runtime_error naming the line.
+//
+//	reader.BeginObject();
+//	JsonString name;
+//	while (reader.NextMember(name))
+//	{
+//		if (name == "count") count = reader.ReadUint();
+//		else reader.SkipValue();
+//	}
+class JsonReader
+{
+public:
+	JsonReader(const char* pBegin, const char* pEnd);
+
+	// after BeginObject(), NextMember() reads the name of every member, whose
+	// value is read next. it returns false after the closing brace.
+	void BeginObject();
+	bool NextMember(JsonString& name);
+
+	// after BeginArray(), NextElement() returns true before every element
+	// and false after the closing bracket
+	void BeginArray();
+	bool NextElement();
+
+	// correctly rounded for up to 15 significant digits and exponents
+	// up to 22, within a few units in the last place beyond
+	double ReadNumber();
+	float ReadFloat();
+	std::uint32_t ReadUint();
+	bool ReadBool();
+	JsonString ReadString();
+
+	// skip a value of any type
+	void SkipValue();
+
+	// expect nothing but whitespace to follow
+	void End();
+
+	// throw std::runtime_error with the message and the current line
+	void Fail(const char* pMessage) const;
+
+private:
+	// skip whitespace and comments, returns the next character or 0 at the end
+	char Peek();
+	void Expect(char c, const char* pMessage);
+
+	const char* m_pBegin;
+	const char* m_pPosition;
+	const char* m_pEnd;
+
+	// no comma is expected before the next member or element
+	bool m_First = true;
+};
@@ -6,9 +6,16 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 //--------------------------------------------------------------------------------------
 #include "stdafx.h"
+#include "Benchmark.h"
 #include "ObjectList.h"
+#include "SdkMeshLoader.h"
 #include "TestClothObject.h"
+#include "TestClothScene.h"
+#include "Profiler.h"
+#include <algorithm>
 #include <memory>
+#include <stdexcept>
+#include <vector>
 
 #pragma warning( disable : 4100 )
 
@@ -18,12 +25,43 @@ using namespace DirectX;
 namespace
 {
 	ObjectList* g_pObjectList = nullptr;
+
+	// update the next frame on a worker thread while rendering the last one
+	bool g_PipelinedUpdate = false;
+
+	// cloths created at startup, if the file is in the working directory
+	const wchar_t* const SCENE_FILE = L"TestCloth.scene";
+
+	// meshes of the scene, loaded in the background
+	SdkMeshLoader* g_pMeshLoader = nullptr;
+	std::vector<std::shared_ptr<SdkMesh::File>> g_Meshes;
+	CpuTimer g_MeshLoadTimer;
+	double g_MaxMeshLoadMilliseconds = 0.0;
+
+	// cloth saved and restored by the S and L keys, the first of the scene
+	TestCloth::Desc g_ClothDesc;
+	ObjectHandle g_pCloth;
+	const wchar_t* const CLOTH_SNAPSHOT_FILE = L"TestCloth.snapshot";
+
+	// cloth recorded while R is toggled on
+	bool g_Recording = false;
+	const wchar_t* const CLOTH_CACHE_FILE = L"TestCloth.cache";
+
+	// cache played back while C is toggled on, seeked by the arrow keys
+	bool g_Playback = false;
+	const double PLAYBACK_SEEK_STEPS = 120.0;
+
+	// meshes exported while E is toggled on
+	bool g_Exporting = false;
+	const wchar_t* const CLOTH_EXPORT_PREFIX = L"TestClothExport";
 	CModelViewerCamera g_Camera;
 	CDXUTDialogResourceManager g_DialogResManager;
 	std::unique_ptr<CDXUTTextHelper> g_pTextHelper = nullptr;
 
-	class TestObject : public Object
+	class TestObject : public BatchedObject<TestObject>
 	{
+		friend class BatchedObject<TestObject>;
+
 	private:
 		void UpdateImpl() override
 		{
@@ -77,13 +115,59 @@ HRESULT CALLBACK OnD3D11CreateDevice(ID3D11Device* pd3dDevice, const DXGI_SURFAC
 	g_pTextHelper.reset(new CDXUTTextHelper(pd3dDevice, DXUTGetD3D11DeviceContext(),
 		&g_DialogResManager, 16));
 
-	TestCloth::Desc testClothDesc;
+	TestCloth::Scene scene;
+	if (GetFileAttributesW(SCENE_FILE) != INVALID_FILE_ATTRIBUTES)
+	{
+		try
+		{
+			CpuTimer timer;
+			scene = TestCloth::LoadScene(SCENE_FILE);
+			SetStatistic(L"Scene load [ms]", timer.GetMilliseconds());
+		}
+		catch (const std::runtime_error& e)
+		{
+			OutputDebugStringA(e.what());
+			OutputDebugStringA("\n");
+		}
+	}
+
+	// loads queued for a previous device would complete among the new ones
+	g_pMeshLoader->Cancel();
+	g_Meshes.clear();
+	g_MaxMeshLoadMilliseconds = 0.0;
+	g_MeshLoadTimer.Restart();
+	for (const auto& fileName : scene.Meshes)
+	{
+		g_pMeshLoader->Load(fileName);
+	}
+
+	// without a scene, a single cloth hanging from its top row
+	if (scene.Cloths.empty())
+	{
+		TestCloth::Desc testClothDesc;
+		testClothDesc.Attachments.push_back(TestCloth::MakeRowAttachment(0));
+		testClothDesc.Levels.push_back(TestCloth::LevelOfDetail{ 128, 0.6f });
+		testClothDesc.Levels.push_back(TestCloth::LevelOfDetail{ 64, 0.3f });
+		testClothDesc.Levels.push_back(TestCloth::LevelOfDetail{ 32, 0.0f });
+		testClothDesc.RenderResolution = 256;
+		scene.Cloths.push_back(testClothDesc);
+	}
 
 	// initialize object list
 	g_pObjectList->AddObject(MakeObjectHandle<TestObject>());
 
-	auto pObj = TestCloth::CreateObject(testClothDesc);
-	g_pObjectList->AddObject(pObj);
+	CpuTimer timer;
+	for (const auto& desc : scene.Cloths)
+	{
+		auto pCloth = TestCloth::CreateObject(desc);
+		g_pObjectList->AddObject(pCloth);
+		if (!g_pCloth)
+		{
+			g_ClothDesc = desc;
+			g_pCloth = pCloth;
+		}
+	}
+	SetStatistic(L"Scene create [ms]", timer.GetMilliseconds());
 
 	return S_OK;
 }
@@ -103,12 +187,62 @@ HRESULT CALLBACK OnD3D11ResizedSwapChain(ID3D11Device* pd3dDevice, IDXGISwapChai
 }
 
 
+//--------------------------------------------------------------------------------------
+// Take over meshes loaded since the last frame
+//--------------------------------------------------------------------------------------
+void PollMeshes()
+{
+	std::vector<SdkMeshLoader::Result> results;
+	if (g_pMeshLoader->Poll(results) == 0)
+	{
+		return;
+	}
+
+	for (const auto& result : results)
+	{
+		if (!result.pFile)
+		{
+			OutputDebugStringW((result.FileName + L": ").c_str());
+			OutputDebugStringA((result.Error + "\n").c_str());
+			continue;
+		}
+
+		auto milliseconds = result.MapMilliseconds + result.ValidateMilliseconds;
+		OutputDebugStringW((result.FileName + L": waited " + std::to_wstring(result.WaitMilliseconds) +
+			L" ms, mapped " + std::to_wstring(result.MapMilliseconds) +
+			L" ms, validated " + std::to_wstring(result.ValidateMilliseconds) + L" ms\n").c_str());
+
+		g_Meshes.push_back(result.pFile);
+		g_MaxMeshLoadMilliseconds = std::max(g_MaxMeshLoadMilliseconds, milliseconds);
+	}
+
+	SetStatistic(L"Meshes loaded", static_cast<double>(g_Meshes.size()));
+	SetStatistic(L"Mesh load, slowest file [ms]", g_MaxMeshLoadMilliseconds);
+	if (!g_pMeshLoader->IsLoading())
+	{
+		SetStatistic(L"Mesh load, all files [ms]", g_MeshLoadTimer.GetMilliseconds());
+	}
+}
+
+
 //--------------------------------------------------------------------------------------
 // Handle updates to the scene.  This is called regardless of which D3D API is used
 //--------------------------------------------------------------------------------------
 void CALLBACK OnFrameMove(double fTime, float fElapsedTime, void* pUserContext)
 {
-	g_pObjectList->Update();
+	PollMeshes();
+
+	if (g_PipelinedUpdate)
+	{
+		// take over the state updated during the last frame, and start the next
+		g_pObjectList->EndUpdate();
+		g_pObjectList->Publish();
+		g_pObjectList->BeginUpdate(fElapsedTime);
+	}
+	else
+	{
+		g_pObjectList->Update(fElapsedTime);
+	}
 }
 
 
@@ -124,6 +258,8 @@ void CALLBACK OnD3D11FrameRender(ID3D11Device* pd3dDevice, ID3D11DeviceContext*
 	auto pDSV = DXUTGetD3D11DepthStencilView();
 	pd3dImmediateContext->ClearDepthStencilView(pDSV, D3D11_CLEAR_DEPTH, 1.0, 0);
 
+	// skip objects outside the view frustum
+	g_pObjectList->Cull(g_Camera.GetViewMatrix(), g_Camera.GetProjMatrix(), 0.0f);
 	g_pObjectList->Render();
 
 	DXUT_BeginPerfEvent(DXUT_PERFEVENTCOLOR, L"HUD / Stats");
@@ -131,6 +267,25 @@ void CALLBACK OnD3D11FrameRender(ID3D11Device* pd3dDevice, ID3D11DeviceContext*
 	g_pTextHelper->SetInsertionPos(0, 0);
 	g_pTextHelper->DrawTextLine(DXUTGetFrameStats());
 	g_pTextHelper->DrawFormattedTextLine(L"%.2f fps", DXUTGetFPS());
+	g_pTextHelper->DrawTextLine(g_PipelinedUpdate ?
+		L"Pipelined update (P to toggle)" : L"Serial update (P to toggle)");
+	if (g_Recording)
+	{
+		g_pTextHelper->DrawTextLine(L"Recording cache (R to stop)");
+	}
+	if (g_Playback)
+	{
+		g_pTextHelper->DrawTextLine(L"Playing cache (C to stop, left/right to seek)");
+	}
+	if (g_Exporting)
+	{
+		g_pTextHelper->DrawTextLine(L"Exporting meshes (E to stop)");
+	}
+	for (const auto& statistic : GetStatistics())
+	{
+		g_pTextHelper->DrawFormattedTextLine(L"%s: %.3f",
+			statistic.first.c_str(), statistic.second);
+	}
 	g_pTextHelper->End();
 	DXUT_EndPerfEvent();
 }
@@ -150,6 +305,7 @@ void CALLBACK OnD3D11ReleasingSwapChain(void* pUserContext)
 //--------------------------------------------------------------------------------------
 void CALLBACK OnD3D11DestroyDevice(void* pUserContext)
 {
+	g_pObjectList->EndUpdate();
 	g_DialogResManager.OnD3D11DestroyDevice();
 }
 
@@ -168,6 +324,168 @@ LRESULT CALLBACK MsgProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam, boo
 //--------------------------------------------------------------------------------------
 void CALLBACK OnKeyboard(UINT nChar, bool bKeyDown, bool bAltDown, void* pUserContext)
 {
+	if (!bKeyDown)
+	{
+		return;
+	}
+
+	switch (nChar)
+	{
+	case 'A':
+		RunObjectAllocationBenchmark();
+		break;
+
+	case 'B':
+		RunObjectStorageBenchmark();
+		break;
+
+	case 'D':
+		RunObjectDispatchBenchmark();
+		break;
+
+	case 'H':
+		RunSdkMeshHierarchyBenchmark();
+		break;
+
+	case 'K':
+		RunSdkMeshAnimationBenchmark();
+		break;
+
+	case 'M':
+		RunSdkMeshValidationBenchmark();
+		break;
+
+	case 'N':
+		RunSceneLoadBenchmark();
+		break;
+
+	case 'P':
+		if (g_PipelinedUpdate)
+		{
+			g_pObjectList->EndUpdate();
+			g_pObjectList->Publish();
+		}
+		g_PipelinedUpdate = !g_PipelinedUpdate;
+		break;
+
+	case 'S':
+		try
+		{
+			TestCloth::SaveSnapshot(g_pCloth, CLOTH_SNAPSHOT_FILE);
+		}
+		catch (const std::runtime_error& e)
+		{
+			OutputDebugStringA(e.what());
+			OutputDebugStringA("\n");
+		}
+		break;
+
+	case 'R':
+		try
+		{
+			// stopping ends the recording even if its last frames fail
+			if (g_Recording)
+			{
+				g_Recording = false;
+				TestCloth::StopRecording(g_pCloth);
+			}
+			else
+			{
+				TestCloth::StartRecording(g_pCloth, CLOTH_CACHE_FILE);
+				g_Recording = true;
+			}
+		}
+		catch (const std::runtime_error& e)
+		{
+			OutputDebugStringA(e.what());
+			OutputDebugStringA("\n");
+		}
+		break;
+
+	case 'C':
+		try
+		{
+			if (g_Playback)
+			{
+				TestCloth::StopPlayback(g_pCloth);
+			}
+			else
+			{
+				// the cache is only complete once recording stops
+				if (g_Recording)
+				{
+					g_Recording = false;
+					TestCloth::StopRecording(g_pCloth);
+				}
+				TestCloth::StartPlayback(g_pCloth, CLOTH_CACHE_FILE);
+			}
+			g_Playback = !g_Playback;
+		}
+		catch (const std::runtime_error& e)
+		{
+			OutputDebugStringA(e.what());
+			OutputDebugStringA("\n");
+		}
+		break;
+
+	case 'E':
+		try
+		{
+			// stopping ends the export even if its last frames fail
+			if (g_Exporting)
+			{
+				g_Exporting = false;
+				TestCloth::StopExport(g_pCloth);
+			}
+			else
+			{
+				TestCloth::StartExport(g_pCloth, CLOTH_EXPORT_PREFIX);
+				g_Exporting = true;
+			}
+		}
+		catch (const std::runtime_error& e)
+		{
+			OutputDebugStringA(e.what());
+			OutputDebugStringA("\n");
+		}
+		break;
+
+	case VK_LEFT:
+	case VK_RIGHT:
+		if (g_Playback)
+		{
+			TestCloth::SeekPlayback(g_pCloth,
+				nChar == VK_LEFT ? -PLAYBACK_SEEK_STEPS : PLAYBACK_SEEK_STEPS);
+		}
+		break;
+
+	case 'L':
+		try
+		{
+			// swapped in by the object list, so the update thread may keep running
+			auto pCloth = TestCloth::CreateObject(g_ClothDesc, CLOTH_SNAPSHOT_FILE);
+			if (g_Recording)
+			{
+				g_Recording = false;
+				TestCloth::StopRecording(g_pCloth);
+			}
+			if (g_Exporting)
+			{
+				g_Exporting = false;
+				TestCloth::StopExport(g_pCloth);
+			}
+			g_Playback = false;
+			g_pObjectList->RemoveObject(g_pCloth);
+			g_pObjectList->AddObject(pCloth);
+			g_pCloth = pCloth;
+		}
+		catch (const std::runtime_error& e)
+		{
+			OutputDebugStringA(e.what());
+			OutputDebugStringA("\n");
+		}
+		break;
+	}
 }
 
 
@@ -202,6 +520,9 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
 	objectList.Initialize();
 	g_pObjectList = &objectList;
 
+	SdkMeshLoader meshLoader;
+	g_pMeshLoader = &meshLoader;
+
 	// DXUT will create and use the best device
 	// that is available on the system depending on which D3D callbacks are set below
 
@@ -0,0 +1,198 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+// built without the precompiled header, so that the file does not depend on DXUT
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::wstring& fileName)
+{
+	HANDLE file = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("Failed to open file");
+	}
+	m_File = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_File, &size))
+	{
+		CloseHandle(m_File);
+		throw std::runtime_error("Failed to get file size");
+	}
+	m_Size = static_cast<std::size_t>(size.QuadPart);
+
+	// empty files cannot be mapped, and have nothing to map anyway
+	if (m_Size == 0)
+	{
+		return;
+	}
+
+	m_Mapping = CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_Mapping)
+	{
+		CloseHandle(m_File);
+		throw std::runtime_error("Failed to map file");
+	}
+
+	m_pData = static_cast<const std::uint8_t*>(
+		MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_pData)
+	{
+		CloseHandle(m_Mapping);
+		CloseHandle(m_File);
+		throw std::runtime_error("Failed to map view of file");
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_pData)
+	{
+		UnmapViewOfFile(m_pData);
+	}
+	if (m_Mapping)
+	{
+		CloseHandle(m_Mapping);
+	}
+	CloseHandle(m_File);
+}
+
+void WriteWholeFile(const std::wstring& fileName, const void* pData, std::size_t size)
+{
+	if (size > MAXDWORD)
+	{
+		throw std::runtime_error("File too large for a single write");
+	}
+
+	HANDLE file = CreateFileW(fileName.c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("Failed to create file");
+	}
+
+	DWORD written;
+	BOOL succeeded = WriteFile(file, pData, static_cast<DWORD>(size), &written, nullptr);
+	CloseHandle(file);
+
+	if (!succeeded || written != size)
+	{
+		throw std::runtime_error("Failed to write file");
+	}
+}
+
+#else
+
+namespace
+{
+	// file names are UTF-8 outside Windows
+	std::string ToUtf8(const std::wstring& text)
+	{
+		std::string utf8;
+		utf8.reserve(text.size());
+		for (auto c : text)
+		{
+			auto code = static_cast<std::uint32_t>(c);
+			if (code < 0x80)
+			{
+				utf8 += static_cast<char>(code);
+			}
+			else if (code < 0x800)
+			{
+				utf8 += static_cast<char>(0xc0 | code >> 6);
+				utf8 += static_cast<char>(0x80 | (code & 0x3f));
+			}
+			else if (code < 0x10000)
+			{
+				utf8 += static_cast<char>(0xe0 | code >> 12);
+				utf8 += static_cast<char>(0x80 | (code >> 6 & 0x3f));
+				utf8 += static_cast<char>(0x80 | (code & 0x3f));
+			}
+			else
+			{
+				utf8 += static_cast<char>(0xf0 | code >> 18);
+				utf8 += static_cast<char>(0x80 | (code >> 12 & 0x3f));
+				utf8 += static_cast<char>(0x80 | (code >> 6 & 0x3f));
+				utf8 += static_cast<char>(0x80 | (code & 0x3f));
+			}
+		}
+		return utf8;
+	}
+}
+
+MappedFile::MappedFile(const std::wstring& fileName)
+{
+	int file = open(ToUtf8(fileName).c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		throw std::runtime_error("Failed to open file");
+	}
+
+	struct stat status;
+	if (fstat(file, &status) != 0)
+	{
+		close(file);
+		throw std::runtime_error("Failed to get file size");
+	}
+	m_Size = static_cast<std::size_t>(status.st_size);
+
+	// empty files cannot be mapped, and have nothing to map anyway
+	if (m_Size == 0)
+	{
+		close(file);
+		return;
+	}
+
+	// the mapping keeps the file open by itself
+	void* pData = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (pData == MAP_FAILED)
+	{
+		throw std::runtime_error("Failed to map file");
+	}
+	m_pData = static_cast<const std::uint8_t*>(pData);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_pData)
+	{
+		munmap(const_cast<std::uint8_t*>(m_pData), m_Size);
+	}
+}
+
+void WriteWholeFile(const std::wstring& fileName, const void* pData, std::size_t size)
+{
+	int file = open(ToUtf8(fileName).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (file < 0)
+	{
+		throw std::runtime_error("Failed to create file");
+	}
+
+	auto written = write(file, pData, size);
+	bool closed = close(file) == 0;
+
+	if (written < 0 || static_cast<std::size_t>(written) != size || !closed)
+	{
+		throw std::runtime_error("Failed to write file");
+	}
+}
+
+#endif
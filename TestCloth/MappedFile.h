@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// read-only view of a whole file, paged in on access
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::wstring& fileName);
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	const std::uint8_t* GetData() const { return m_pData; }
+	std::size_t GetSize() const { return m_Size; }
+
+private:
+#ifdef _WIN32
+	// HANDLEs, kept opaque so that the header does not need windows.h
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+#endif
+	const std::uint8_t* m_pData = nullptr;
+	std::size_t m_Size = 0;
+};
+
+// write data to a new file with a single write
+void WriteWholeFile(const std::wstring& fileName, const void* pData, std::size_t size);
@@ -1,54 +1,665 @@
 #include "stdafx.h"
 #include "ObjectList.h"
+#include "Culling.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
 
-#include <unordered_set>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace
+{
+	// batch of objects which are not batched by type
+	void UpdateEach(Object* const* ppObjects, std::size_t numObjects)
+	{
+		for (std::size_t i = 0; i < numObjects; i++)
+		{
+			ppObjects[i]->Update();
+		}
+	}
+
+	void PublishEach(Object* const* ppObjects, std::size_t numObjects)
+	{
+		for (std::size_t i = 0; i < numObjects; i++)
+		{
+			ppObjects[i]->Publish();
+		}
+	}
+
+	void RenderEach(const Object* const* ppObjects, std::size_t numObjects)
+	{
+		for (std::size_t i = 0; i < numObjects; i++)
+		{
+			ppObjects[i]->Render();
+		}
+	}
+
+	const ObjectBatch g_DefaultBatch = { &UpdateEach, &PublishEach, &RenderEach };
+
+	// tasks per thread a batch is split into at most, unless conflicts split it further
+	const std::size_t CHUNKS_PER_THREAD = 4;
+
+	const std::size_t NO_CHUNK = ~static_cast<std::size_t>(0);
+}
 
 void Object::Update()
 {
 	UpdateImpl();
 }
 
+void Object::Publish()
+{
+	PublishImpl();
+}
+
+void Object::Interpolate(float alpha)
+{
+	InterpolateImpl(alpha);
+}
+
 void Object::Render() const
 {
 	RenderImpl();
 }
 
+void Object::DeclareAccess(ObjectAccess& access) const
+{
+	DeclareAccessImpl(access);
+}
+
+bool Object::GetBounds(ObjectBounds& bounds) const
+{
+	return GetBoundsImpl(bounds);
+}
+
+UpdateSchedule Object::GetSchedule() const
+{
+	return GetScheduleImpl();
+}
+
+const ObjectBatch& Object::GetBatch() const
+{
+	return GetBatchImpl();
+}
+
+const ObjectBatch& Object::GetBatchImpl() const
+{
+	return g_DefaultBatch;
+}
+
 class ObjectList::Impl
 {
 public:
-	void Update()
+	Impl() : m_PendingCommands(nullptr)
 	{
-		for (auto& object : m_Objects)
+	}
+
+	~Impl()
+	{
+		if (m_UpdateThread.joinable())
 		{
-			object->Update();
+			{
+				std::unique_lock<std::mutex> lock(m_UpdateMutex);
+				m_UpdateDone.wait(lock, [this]() { return !m_Updating; });
+				m_Quit = true;
+			}
+			m_UpdateRequested.notify_one();
+			m_UpdateThread.join();
 		}
+
+		DeleteCommands(TakePendingCommands());
+	}
+
+	void Update(float elapsedTime)
+	{
+		Synchronize(elapsedTime);
+
+		m_TaskGraph.Run(m_ThreadPool);
+		Publish();
+	}
+
+	void BeginUpdate(float elapsedTime)
+	{
+		Synchronize(elapsedTime);
+
+		if (!m_UpdateThread.joinable())
+		{
+			m_UpdateThread = std::thread(&Impl::UpdateThreadMain, this);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_UpdateMutex);
+			m_Updating = true;
+		}
+		m_UpdateRequested.notify_one();
+	}
+
+	void EndUpdate()
+	{
+		std::exception_ptr exception;
+		{
+			std::unique_lock<std::mutex> lock(m_UpdateMutex);
+			m_UpdateDone.wait(lock, [this]() { return !m_Updating; });
+			std::swap(exception, m_UpdateException);
+		}
+
+		if (exception)
+		{
+			std::rethrow_exception(exception);
+		}
+	}
+
+	void Publish()
+	{
+		for (auto& batch : m_Batches)
+		{
+			batch.Functions->Publish(batch.Scheduled.data(), batch.Scheduled.size());
+			batch.Scheduled.clear();
+
+			for (auto pEntry : batch.Entries)
+			{
+				auto& entry = *pEntry;
+				if (entry.Scheduled)
+				{
+					entry.PublishInterval = entry.SincePublish;
+					entry.SincePublish = 0.0f;
+					entry.Scheduled = false;
+				}
+
+				// show the state published last at the end of its interval
+				if (entry.Schedule.Rate > 0.0f)
+				{
+					entry.Object->Interpolate(entry.PublishInterval > 0.0f ?
+						std::min(1.0f, entry.SincePublish / entry.PublishInterval) : 1.0f);
+				}
+			}
+		}
+	}
+
+	void SetUpdateBudget(float milliseconds)
+	{
+		m_UpdateBudget = milliseconds;
 	}
 
 	void Render() const
 	{
-		for (const auto& object : m_Objects)
+		for (const auto& batch : m_Batches)
 		{
-			object->Render();
+			batch.Functions->Render(batch.Visible.data(), batch.Visible.size());
 		}
 	}
 
+	void Cull(const DirectX::XMMATRIX& view, const DirectX::XMMATRIX& projection,
+		float maxDistance)
+	{
+		// gather bounded objects, then test them four at a time
+		m_CullBoxes.Clear();
+		for (const auto& batch : m_Batches)
+		{
+			for (auto pEntry : batch.Entries)
+			{
+				ObjectBounds bounds;
+				pEntry->Bounded = pEntry->Object->GetBounds(bounds);
+				if (pEntry->Bounded)
+				{
+					m_CullBoxes.Add(bounds.Min, bounds.Max);
+				}
+			}
+		}
+
+		m_CullBoxes.Cull(MakeFrustum(view, projection, maxDistance), m_CullVisible);
+
+		std::size_t iBox = 0;
+		std::uint32_t numCulled = 0;
+		for (auto& batch : m_Batches)
+		{
+			batch.Visible.clear();
+			for (auto pEntry : batch.Entries)
+			{
+				pEntry->Culled = pEntry->Bounded && !m_CullVisible[iBox++];
+				if (pEntry->Culled)
+				{
+					numCulled++;
+				}
+				else
+				{
+					batch.Visible.push_back(pEntry->Object.get());
+				}
+			}
+		}
+
+		SetStatistic(L"Culled objects", numCulled);
+	}
+
+	void SetCulledUpdateRate(float rate)
+	{
+		m_CulledUpdateRate = rate;
+	}
+
 	void AddObject(ObjectHandle object)
 	{
-		m_Objects.insert(object);
+		PushCommand(std::move(object), true);
 	}
 
 	void RemoveObject(ObjectHandle object)
 	{
-		auto itr = m_Objects.find(object);
-		if (itr != m_Objects.end())
+		PushCommand(std::move(object), false);
+	}
+
+private:
+	// add or remove request, pushed onto a lock-free list
+	struct Command
+	{
+		ObjectHandle Object;
+		bool Add;
+		Command* pNext;
+	};
+
+	static void DeleteCommands(Command* pCommand)
+	{
+		while (pCommand)
 		{
-			m_Objects.erase(itr);
+			auto pNext = pCommand->pNext;
+			delete pCommand;
+			pCommand = pNext;
 		}
 	}
 
-private:
-	// object container
-	std::unordered_set<ObjectHandle> m_Objects;
+	void PushCommand(ObjectHandle object, bool add)
+	{
+		auto pCommand = new Command;
+		pCommand->Object = std::move(object);
+		pCommand->Add = add;
+
+		pCommand->pNext = m_PendingCommands.load(std::memory_order_relaxed);
+		while (!m_PendingCommands.compare_exchange_weak(pCommand->pNext, pCommand,
+			std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	// detach all the pending commands in the order they were pushed
+	Command* TakePendingCommands()
+	{
+		auto pCommand = m_PendingCommands.exchange(nullptr, std::memory_order_acquire);
+
+		Command* pReversed = nullptr;
+		while (pCommand)
+		{
+			auto pNext = pCommand->pNext;
+			pCommand->pNext = pReversed;
+			pReversed = pCommand;
+			pCommand = pNext;
+		}
+
+		return pReversed;
+	}
+
+	// sync point: apply pending commands while no update is running
+	void Synchronize(float elapsedTime)
+	{
+		auto pCommands = TakePendingCommands();
+		for (auto pCommand = pCommands; pCommand; pCommand = pCommand->pNext)
+		{
+			auto& id = GetListId(*pCommand->Object);
+			auto pEntry = m_Objects.Find(id);
+			bool contained = pEntry && pEntry->Object == pCommand->Object;
+
+			if (pCommand->Add && !contained)
+			{
+				Entry entry;
+				entry.Batch = &pCommand->Object->GetBatch();
+				entry.Object = pCommand->Object;
+
+				id = m_Objects.Insert(std::move(entry));
+				m_BatchesDirty = true;
+			}
+			else if (!pCommand->Add && contained)
+			{
+				m_Objects.Erase(id);
+				id = ObjectId();
+				m_BatchesDirty = true;
+			}
+		}
+		DeleteCommands(pCommands);
+
+		if (m_BatchesDirty)
+		{
+			BuildBatches();
+		}
+
+		Schedule(elapsedTime);
+	}
+
+	// choose the objects updated this frame
+	void Schedule(float elapsedTime)
+	{
+		float cost = 0.0f;
+		m_DueEntries.clear();
+
+		for (auto& batch : m_Batches)
+		{
+			batch.Scheduled.clear();
+
+			for (auto pEntry : batch.Entries)
+			{
+				auto& entry = *pEntry;
+				entry.Schedule = entry.Object->GetSchedule();
+				entry.Owed += elapsedTime;
+				entry.SincePublish += elapsedTime;
+
+				// culled objects need not be updated every frame
+				entry.Rate = entry.Schedule.Rate;
+				if (entry.Culled && entry.Rate <= 0.0f)
+				{
+					entry.Rate = m_CulledUpdateRate;
+				}
+
+				entry.Scheduled = entry.Rate <= 0.0f;
+				if (entry.Scheduled)
+				{
+					entry.Owed = 0.0f;
+					cost += entry.Schedule.Cost;
+				}
+				else if (entry.Owed * entry.Rate >= 1.0f)
+				{
+					m_DueEntries.push_back(pEntry);
+				}
+			}
+		}
+
+		// the most urgent object always runs, so that no object starves
+		std::sort(m_DueEntries.begin(), m_DueEntries.end(), [](const Entry* a, const Entry* b)
+		{
+			return a->Schedule.Priority * a->Owed * a->Rate >
+				b->Schedule.Priority * b->Owed * b->Rate;
+		});
+
+		std::uint32_t numDeferred = 0;
+		for (std::size_t i = 0; i < m_DueEntries.size(); i++)
+		{
+			auto& entry = *m_DueEntries[i];
+			if (i > 0 && m_UpdateBudget > 0.0f && cost + entry.Schedule.Cost > m_UpdateBudget)
+			{
+				numDeferred++;
+				continue;
+			}
+
+			entry.Scheduled = true;
+			cost += entry.Schedule.Cost;
+
+			// catch up at most one period late updates
+			float period = 1.0f / entry.Rate;
+			entry.Owed = std::min(entry.Owed - period, period);
+		}
+
+		for (auto& batch : m_Batches)
+		{
+			for (auto pEntry : batch.Entries)
+			{
+				if (pEntry->Scheduled)
+				{
+					batch.Scheduled.push_back(pEntry->Object.get());
+				}
+			}
+		}
+
+		for (auto& chunk : m_Chunks)
+		{
+			chunk.Scheduled.clear();
+			for (auto pEntry : chunk.Entries)
+			{
+				if (pEntry->Scheduled)
+				{
+					chunk.Scheduled.push_back(pEntry->Object.get());
+				}
+			}
+		}
+
+		SetStatistic(L"Scheduled update cost [ms]", cost);
+		SetStatistic(L"Deferred updates", numDeferred);
+	}
+
+	// runs the task graph whenever BeginUpdate() is called
+	void UpdateThreadMain()
+	{
+		std::unique_lock<std::mutex> lock(m_UpdateMutex);
+
+		for (;;)
+		{
+			m_UpdateRequested.wait(lock, [this]() { return m_Updating || m_Quit; });
+			if (m_Quit)
+			{
+				return;
+			}
+
+			lock.unlock();
+			std::exception_ptr exception;
+			try
+			{
+				m_TaskGraph.Run(m_ThreadPool);
+			}
+			catch (...)
+			{
+				exception = std::current_exception();
+			}
+			lock.lock();
+
+			m_UpdateException = exception;
+			m_Updating = false;
+			m_UpdateDone.notify_all();
+		}
+	}
+
+	// group objects by batch in the order of addition, and split each batch
+	// into chunks, one task each. an object joins the open chunk of its batch
+	// unless the chunk is full or the object has to wait for a chunk opened
+	// later, so that conflicting objects still update in the order they were
+	// added. a chunk waits for the last writer of every resource its objects
+	// access, and writers also wait for the readers since then.
+	void BuildBatches()
+	{
+		// the slot map keeps the order of addition
+		std::vector<Entry*> entries;
+		entries.reserve(m_Objects.Size());
+		for (auto& entry : m_Objects)
+		{
+			entries.push_back(&entry);
+		}
+
+		m_Batches.clear();
+		std::unordered_map<const ObjectBatch*, std::size_t> batchIndices;
+		for (auto pEntry : entries)
+		{
+			auto itr = batchIndices.find(pEntry->Batch);
+			if (itr == batchIndices.end())
+			{
+				itr = batchIndices.emplace(pEntry->Batch, m_Batches.size()).first;
+				m_Batches.push_back(Batch());
+				m_Batches.back().Functions = pEntry->Batch;
+			}
+
+			m_Batches[itr->second].Entries.push_back(pEntry);
+			m_Batches[itr->second].Visible.push_back(pEntry->Object.get());
+		}
+
+		// a few chunks per thread and batch, enough to balance the load
+		// without making a task of every small object
+		std::size_t numChunksPerBatch = m_ThreadPool.GetNumThreads() * CHUNKS_PER_THREAD;
+		std::vector<std::size_t> chunkSizes(m_Batches.size());
+		std::vector<std::size_t> openChunks(m_Batches.size(), NO_CHUNK);
+		for (std::size_t i = 0; i < m_Batches.size(); i++)
+		{
+			chunkSizes[i] = (m_Batches[i].Entries.size() + numChunksPerBatch - 1) / numChunksPerBatch;
+		}
+
+		struct ResourceState
+		{
+			std::size_t LastWriter = NO_CHUNK;
+			std::vector<std::size_t> Readers;
+		};
+		std::unordered_map<const void*, ResourceState> resources;
+
+		m_Chunks.clear();
+		std::vector<std::pair<std::size_t, std::size_t>> dependencies;
+		std::vector<std::size_t> waitsFor;
+		for (auto pEntry : entries)
+		{
+			ObjectAccess access;
+			pEntry->Object->DeclareAccess(access);
+
+			waitsFor.clear();
+			for (auto resource : access.Reads)
+			{
+				auto& state = resources[resource];
+				if (state.LastWriter != NO_CHUNK)
+				{
+					waitsFor.push_back(state.LastWriter);
+				}
+			}
+			for (auto resource : access.Writes)
+			{
+				auto& state = resources[resource];
+				if (state.LastWriter != NO_CHUNK)
+				{
+					waitsFor.push_back(state.LastWriter);
+				}
+				waitsFor.insert(waitsFor.end(), state.Readers.begin(), state.Readers.end());
+			}
+
+			auto iBatch = batchIndices[pEntry->Batch];
+			auto& iChunk = openChunks[iBatch];
+			if (iChunk == NO_CHUNK || m_Chunks[iChunk].Entries.size() >= chunkSizes[iBatch] ||
+				std::any_of(waitsFor.begin(), waitsFor.end(), [&](std::size_t i) { return i > iChunk; }))
+			{
+				iChunk = m_Chunks.size();
+				m_Chunks.push_back(Chunk());
+				m_Chunks.back().Functions = pEntry->Batch;
+			}
+			m_Chunks[iChunk].Entries.push_back(pEntry);
+
+			for (auto i : waitsFor)
+			{
+				if (i != iChunk)
+				{
+					dependencies.push_back(std::make_pair(i, iChunk));
+				}
+			}
+
+			for (auto resource : access.Reads)
+			{
+				auto& readers = resources[resource].Readers;
+				if (readers.empty() || readers.back() != iChunk)
+				{
+					readers.push_back(iChunk);
+				}
+			}
+			for (auto resource : access.Writes)
+			{
+				auto& state = resources[resource];
+				state.LastWriter = iChunk;
+				state.Readers.clear();
+			}
+		}
+
+		// chunks only wait for chunks opened before them, so task ids follow
+		m_TaskGraph.Clear();
+		for (const auto& chunk : m_Chunks)
+		{
+			auto pChunk = &chunk;
+			m_TaskGraph.AddTask([pChunk]()
+			{
+				pChunk->Functions->Update(pChunk->Scheduled.data(), pChunk->Scheduled.size());
+			});
+		}
+
+		std::sort(dependencies.begin(), dependencies.end());
+		dependencies.erase(std::unique(dependencies.begin(), dependencies.end()), dependencies.end());
+		for (const auto& dependency : dependencies)
+		{
+			m_TaskGraph.AddDependency(static_cast<TaskGraph::TaskId>(dependency.first),
+				static_cast<TaskGraph::TaskId>(dependency.second));
+		}
+
+		m_BatchesDirty = false;
+	}
+
+	struct Entry
+	{
+		ObjectHandle Object;
+		const ObjectBatch* Batch;
+
+		UpdateSchedule Schedule;
+		bool Scheduled = false;
+
+		// scheduled update rate, reduced while culled
+		float Rate = 0.0f;
+
+		// whether the object had bounds and was outside them at the last Cull()
+		bool Bounded = false;
+		bool Culled = false;
+
+		// time since the last update, and the last two publishes
+		float Owed = 0.0f;
+		float SincePublish = 0.0f;
+		float PublishInterval = 0.0f;
+	};
+
+	// objects of the same type, published and rendered with a single call
+	struct Batch
+	{
+		const ObjectBatch* Functions;
+		std::vector<Entry*> Entries;
+
+		// objects updated this frame
+		std::vector<Object*> Scheduled;
+
+		// objects rendered this frame
+		std::vector<Object*> Visible;
+	};
+
+	// objects of a batch updated by one task with a single call
+	struct Chunk
+	{
+		const ObjectBatch* Functions;
+		std::vector<Entry*> Entries;
+
+		// objects updated this frame
+		std::vector<Object*> Scheduled;
+	};
+
+	// object container, iterated contiguously
+	SlotMap<Entry> m_Objects;
+	std::atomic<Command*> m_PendingCommands;
+
+	// rebuilt when objects are added or removed
+	std::vector<Batch> m_Batches;
+	std::vector<Chunk> m_Chunks;
+	std::vector<Entry*> m_DueEntries;
+	float m_UpdateBudget = 0.0f;
+
+	BoundingBoxes m_CullBoxes;
+	std::vector<std::uint8_t> m_CullVisible;
+	float m_CulledUpdateRate = 0.0f;
+	TaskGraph m_TaskGraph;
+	bool m_BatchesDirty = true;
+
+	ThreadPool m_ThreadPool;
+
+	// pipelined update, guarded by m_UpdateMutex
+	std::thread m_UpdateThread;
+	std::mutex m_UpdateMutex;
+	std::condition_variable m_UpdateRequested;
+	std::condition_variable m_UpdateDone;
+	bool m_Updating = false;
+	bool m_Quit = false;
+	std::exception_ptr m_UpdateException;
 };
 
 ObjectList::~ObjectList()
@@ -62,9 +673,29 @@ void ObjectList::Initialize()
 	m_pImpl = new Impl;
 }
 
-void ObjectList::Update()
+void ObjectList::Update(float elapsedTime)
+{
+	m_pImpl->Update(elapsedTime);
+}
+
+void ObjectList::BeginUpdate(float elapsedTime)
+{
+	m_pImpl->BeginUpdate(elapsedTime);
+}
+
+void ObjectList::EndUpdate()
+{
+	m_pImpl->EndUpdate();
+}
+
+void ObjectList::Publish()
+{
+	m_pImpl->Publish();
+}
+
+void ObjectList::SetUpdateBudget(float milliseconds)
 {
-	m_pImpl->Update();
+	m_pImpl->SetUpdateBudget(milliseconds);
 }
 
 void ObjectList::Render() const
@@ -72,12 +703,23 @@ void ObjectList::Render() const
 	m_pImpl->Render();
 }
 
+void ObjectList::Cull(const DirectX::XMMATRIX& view, const DirectX::XMMATRIX& projection,
+	float maxDistance)
+{
+	m_pImpl->Cull(view, projection, maxDistance);
+}
+
+void ObjectList::SetCulledUpdateRate(float rate)
+{
+	m_pImpl->SetCulledUpdateRate(rate);
+}
+
 void ObjectList::AddObject(ObjectHandle object)
 {
-	m_pImpl->AddObject(object);
+	m_pImpl->AddObject(std::move(object));
 }
 
 void ObjectList::RemoveObject(ObjectHandle object)
 {
-	m_pImpl->RemoveObject(object);
+	m_pImpl->RemoveObject(std::move(object));
 }
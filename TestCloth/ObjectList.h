@@ -1,35 +1,203 @@
 #pragma once
 
+#include "ObjectPool.h"
+#include "SlotMap.h"
+
+#include <cstddef>
 #include <string>
 #include <memory>
+#include <utility>
+#include <vector>
+
+class Object;
+
+// identifies an object added to an ObjectList
+typedef SlotHandle ObjectId;
+
+// resources accessed by Object::Update(), used to schedule updates in parallel
+struct ObjectAccess
+{
+	// any address identifying a resource, e.g. the data itself
+	std::vector<const void*> Reads;
+	std::vector<const void*> Writes;
+};
+
+// axis-aligned bounds in world space
+struct ObjectBounds
+{
+	DirectX::XMFLOAT3 Min;
+	DirectX::XMFLOAT3 Max;
+};
+
+// how often an object wants to be updated, and what an update costs
+struct UpdateSchedule
+{
+	// desired updates per second (0 updates every frame)
+	float Rate = 0.0f;
+
+	// estimated time of one update in milliseconds, including the GPU
+	// work it submits when that dominates
+	float Cost = 0.0f;
+
+	// preference among objects due for an update when over budget
+	float Priority = 1.0f;
+};
+
+// updates and renders many objects of one concrete type with a single call
+struct ObjectBatch
+{
+	void(*Update)(Object* const* ppObjects, std::size_t numObjects);
+	void(*Publish)(Object* const* ppObjects, std::size_t numObjects);
+	void(*Render)(const Object* const* ppObjects, std::size_t numObjects);
+};
 
 class Object
 {
 public:
 	virtual ~Object() {}
 
-	// update object by one frame
+	// update object by one frame.
+	// may run on a worker thread while the last published state is rendered,
+	// so it must not modify anything Render() reads.
 	void Update();
 
+	// hand the state computed by the last Update() over to Render().
+	// called on the rendering thread while no update is running.
+	void Publish();
+
+	// blend the last two published states for rendering (0 is the older one).
+	// called every frame for objects updating at a reduced rate.
+	void Interpolate(float alpha);
+
 	// render current frame
 	void Render() const;
 
+	// declare resources accessed by Update().
+	// objects without conflicting accesses may be updated concurrently,
+	// the others are updated in the order they were added.
+	void DeclareAccess(ObjectAccess& access) const;
+
+	// bounds of what Render() draws, queried every frame when culling.
+	// returns false if the object has no bounds and is never culled.
+	bool GetBounds(ObjectBounds& bounds) const;
+
+	// desired update rate and cost, queried every frame at the sync point
+	UpdateSchedule GetSchedule() const;
+
+	// functions used by ObjectList to update and render objects of this type.
+	// objects returning the same batch are dispatched together.
+	const ObjectBatch& GetBatch() const;
+
 protected:
 	// implementation of Update(), which is overridden in subclass
 	virtual void UpdateImpl() {}
 
+	// implementation of Publish(), which is overridden in subclass
+	virtual void PublishImpl() {}
+
+	// implementation of Interpolate(), which is overridden in subclass
+	virtual void InterpolateImpl(float) {}
+
 	// implementation of Render(), which is overridden in subclass
 	virtual void RenderImpl() const {}
+
+	// implementation of GetBounds(), which is overridden in subclass
+	virtual bool GetBoundsImpl(ObjectBounds&) const { return false; }
+
+	// implementation of GetSchedule(), which is overridden in subclass
+	virtual UpdateSchedule GetScheduleImpl() const { return UpdateSchedule(); }
+
+	// implementation of DeclareAccess(), which is overridden in subclass.
+	// objects declaring nothing must be safe to update from any thread.
+	virtual void DeclareAccessImpl(ObjectAccess&) const {}
+
+	// implementation of GetBatch(), which is overridden by BatchedObject.
+	// the default batch calls Update() and Render() of every object.
+	virtual const ObjectBatch& GetBatchImpl() const;
+
+private:
+	friend class ObjectList;
+
+	// slot in the ObjectList this object was added to
+	ObjectId m_ListId;
+};
+
+// base class of objects dispatched in a tight loop over all objects of
+// ObjectType, calling UpdateImpl(), PublishImpl() and RenderImpl()
+// without virtual calls.
+// ObjectType must not be derived further, and has to befriend
+// BatchedObject<ObjectType> if these functions are private.
+template <typename ObjectType>
+class BatchedObject : public Object
+{
+protected:
+	const ObjectBatch& GetBatchImpl() const override
+	{
+		return s_Batch;
+	}
+
+private:
+	static void UpdateBatch(Object* const* ppObjects, std::size_t numObjects)
+	{
+		for (std::size_t i = 0; i < numObjects; i++)
+		{
+			static_cast<ObjectType*>(ppObjects[i])->ObjectType::UpdateImpl();
+		}
+	}
+
+	static void PublishBatch(Object* const* ppObjects, std::size_t numObjects)
+	{
+		for (std::size_t i = 0; i < numObjects; i++)
+		{
+			static_cast<ObjectType*>(ppObjects[i])->ObjectType::PublishImpl();
+		}
+	}
+
+	static void RenderBatch(const Object* const* ppObjects, std::size_t numObjects)
+	{
+		for (std::size_t i = 0; i < numObjects; i++)
+		{
+			static_cast<const ObjectType*>(ppObjects[i])->ObjectType::RenderImpl();
+		}
+	}
+
+	static const ObjectBatch s_Batch;
+};
+
+template <typename ObjectType>
+const ObjectBatch BatchedObject<ObjectType>::s_Batch =
+{
+	&BatchedObject<ObjectType>::UpdateBatch,
+	&BatchedObject<ObjectType>::PublishBatch,
+	&BatchedObject<ObjectType>::RenderBatch,
 };
 
 // ObjectHandle for Object
 typedef std::shared_ptr<Object> ObjectHandle;
 
+// make object of ObjectType, forwarding the constructor arguments.
+// the object and its reference counts share one block from a pool per type.
+template <typename ObjectType, typename ... VArg>
+std::shared_ptr<ObjectType> MakeObject(VArg&& ... arg)
+{
+	return std::allocate_shared<ObjectType>(PoolAllocator<ObjectType>(),
+		std::forward<VArg>(arg)...);
+}
+
 // make object handle whose type is ObjectType
 template <typename ObjectType, typename ... VArg>
-ObjectHandle MakeObjectHandle(VArg ... arg)
+ObjectHandle MakeObjectHandle(VArg&& ... arg)
+{
+	return MakeObject<ObjectType>(std::forward<VArg>(arg)...);
+}
+
+// make object handle whose type is ObjectType in a frame arena.
+// all the handles must be released before the arena is reset.
+template <typename ObjectType, typename ... VArg>
+ObjectHandle MakeTransientObjectHandle(FrameArena& arena, VArg&& ... arg)
 {
-	return ObjectHandle(new ObjectType(arg...));
+	return std::allocate_shared<ObjectType>(ArenaAllocator<ObjectType>(arena),
+		std::forward<VArg>(arg)...);
 }
 
 // object list
@@ -42,19 +210,62 @@ public:
 
 	void Initialize();
 
-	// call Update() of all the added objects
-	void Update();
+	// objects are added and removed at a sync point at the beginning of
+	// Update() and BeginUpdate(), in the order AddObject() and RemoveObject()
+	// were called.
+
+	// objects updating every frame are always updated. the others are
+	// updated when due, most overdue first, as long as the budget allows.
+
+	// update the scheduled objects and publish them. the objects of a type
+	// are split into chunks, each updated by one call of the batch on a
+	// thread pool. chunks without conflicting accesses run concurrently,
+	// conflicting objects are updated in the order they were added.
+	void Update(float elapsedTime);
 
-	// call Render() of all the added objects
+	// pipelined update: start updating the scheduled objects on a worker
+	// thread and return, so that the published state can be rendered meanwhile.
+	void BeginUpdate(float elapsedTime);
+
+	// wait for the update started by BeginUpdate(), if any
+	void EndUpdate();
+
+	// call Publish() of the objects updated last, after EndUpdate(),
+	// and Interpolate() of the objects updating at a reduced rate
+	void Publish();
+
+	// time per frame for the updates, in milliseconds, as estimated by the
+	// UpdateSchedule::Cost of the objects updated (0 is unlimited)
+	void SetUpdateBudget(float milliseconds);
+
+	// render the objects visible at the last Cull(), one batch per type
 	void Render() const;
 
-	// add object to this object list
+	// find the objects whose bounds intersect the view frustum
+	// and are closer than maxDistance (0 disables distance culling)
+	void Cull(const DirectX::XMMATRIX& view, const DirectX::XMMATRIX& projection,
+		float maxDistance);
+
+	// update rate of objects updating every frame while they are culled
+	// (0 keeps updating them every frame)
+	void SetCulledUpdateRate(float rate);
+
+	// add object to this object list at the next sync point.
+	// lock-free, may be called from any thread, including from Update().
+	// an object can be added to only one object list.
 	void AddObject(ObjectHandle object);
 
-	// remove object from this object list
+	// remove object from this object list at the next sync point.
+	// lock-free, may be called from any thread, including from Update().
+	// objects which are not in this list are ignored.
 	void RemoveObject(ObjectHandle object);
 
 private:
+	static ObjectId& GetListId(Object& object)
+	{
+		return object.m_ListId;
+	}
+
 	class Impl;
 	Impl* m_pImpl = nullptr;
 };
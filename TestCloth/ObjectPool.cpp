@@ -0,0 +1,256 @@
+#include "stdafx.h"
+#include "ObjectPool.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+	const std::size_t CHUNK_SIZE = 64 * 1024;
+
+	std::size_t AlignUp(std::size_t value, std::size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// pools created by GetObjectPool(), with the pointers they are stored in
+	struct PoolRegistry
+	{
+		std::mutex Mutex;
+		std::vector<std::pair<std::atomic<FixedSizePool*>*, FixedSizePool*>> Pools;
+	};
+
+	// constructed by the first ObjectPoolLifetime and destroyed by the last.
+	// both are plain data, initialized before any constructor runs.
+	int g_NumPoolLifetimes;
+	std::aligned_storage<sizeof(PoolRegistry), std::alignment_of<PoolRegistry>::value>::type g_PoolRegistry;
+
+	PoolRegistry& GetPoolRegistry()
+	{
+		return *reinterpret_cast<PoolRegistry*>(&g_PoolRegistry);
+	}
+}
+
+FixedSizePool::FixedSizePool(std::size_t blockSize, std::size_t alignment)
+	: m_Alignment(std::max(alignment, std::alignment_of<FreeBlock>::value))
+{
+	m_BlockSize = AlignUp(std::max(blockSize, sizeof(FreeBlock)), m_Alignment);
+	m_NumBlocksPerChunk = std::max<std::size_t>(1, CHUNK_SIZE / m_BlockSize);
+}
+
+FixedSizePool::~FixedSizePool()
+{
+	for (auto pChunk : m_Chunks)
+	{
+		::operator delete(pChunk);
+	}
+}
+
+void* FixedSizePool::Allocate()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto pChunk = m_pAvailable ? m_pAvailable : AllocateChunk();
+	if (pChunk == m_pSpare)
+	{
+		m_pSpare = nullptr;
+	}
+
+	auto pBlock = pChunk->pFreeList;
+	pChunk->pFreeList = pBlock->pNext;
+	pChunk->NumUsed++;
+	if (!pChunk->pFreeList)
+	{
+		UnlinkAvailable(pChunk);
+	}
+	return pBlock;
+}
+
+void FixedSizePool::Free(void* p)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto pChunk = FindChunk(p);
+	if (!pChunk->pFreeList)
+	{
+		LinkAvailable(pChunk);
+	}
+
+	auto pBlock = static_cast<FreeBlock*>(p);
+	pBlock->pNext = pChunk->pFreeList;
+	pChunk->pFreeList = pBlock;
+	pChunk->NumUsed--;
+
+	if (pChunk->NumUsed == 0)
+	{
+		if (m_pSpare)
+		{
+			FreeChunk(pChunk);
+		}
+		else
+		{
+			m_pSpare = pChunk;
+		}
+	}
+}
+
+FixedSizePool::Chunk* FixedSizePool::AllocateChunk()
+{
+	// operator new aligns for the header, the blocks are aligned after it
+	auto size = sizeof(Chunk) + m_Alignment - 1 + m_NumBlocksPerChunk * m_BlockSize;
+	auto pChunk = static_cast<Chunk*>(::operator new(size));
+
+	auto itr = std::upper_bound(m_Chunks.begin(), m_Chunks.end(), pChunk, std::less<Chunk*>());
+	try
+	{
+		m_Chunks.insert(itr, pChunk);
+	}
+	catch (...)
+	{
+		::operator delete(pChunk);
+		throw;
+	}
+
+	auto address = reinterpret_cast<std::uintptr_t>(pChunk + 1);
+	pChunk->pBlocks = reinterpret_cast<std::uint8_t*>(AlignUp(address, m_Alignment));
+	pChunk->pFreeList = nullptr;
+	pChunk->NumUsed = 0;
+
+	// thread the blocks in address order
+	for (auto i = m_NumBlocksPerChunk; i > 0; i--)
+	{
+		auto pBlock = reinterpret_cast<FreeBlock*>(pChunk->pBlocks + (i - 1) * m_BlockSize);
+		pBlock->pNext = pChunk->pFreeList;
+		pChunk->pFreeList = pBlock;
+	}
+
+	LinkAvailable(pChunk);
+	return pChunk;
+}
+
+void FixedSizePool::FreeChunk(Chunk* pChunk)
+{
+	UnlinkAvailable(pChunk);
+	m_Chunks.erase(std::lower_bound(m_Chunks.begin(), m_Chunks.end(), pChunk, std::less<Chunk*>()));
+	::operator delete(pChunk);
+}
+
+FixedSizePool::Chunk* FixedSizePool::FindChunk(void* p) const
+{
+	// last chunk starting before p
+	auto itr = std::upper_bound(m_Chunks.begin(), m_Chunks.end(), static_cast<Chunk*>(p), std::less<Chunk*>());
+	return *(itr - 1);
+}
+
+void FixedSizePool::LinkAvailable(Chunk* pChunk)
+{
+	pChunk->pPrevAvailable = nullptr;
+	pChunk->pNextAvailable = m_pAvailable;
+	if (m_pAvailable)
+	{
+		m_pAvailable->pPrevAvailable = pChunk;
+	}
+	m_pAvailable = pChunk;
+}
+
+void FixedSizePool::UnlinkAvailable(Chunk* pChunk)
+{
+	if (pChunk->pPrevAvailable)
+	{
+		pChunk->pPrevAvailable->pNextAvailable = pChunk->pNextAvailable;
+	}
+	else
+	{
+		m_pAvailable = pChunk->pNextAvailable;
+	}
+	if (pChunk->pNextAvailable)
+	{
+		pChunk->pNextAvailable->pPrevAvailable = pChunk->pPrevAvailable;
+	}
+}
+
+ObjectPoolLifetime::ObjectPoolLifetime()
+{
+	if (g_NumPoolLifetimes++ == 0)
+	{
+		new (&g_PoolRegistry) PoolRegistry();
+	}
+}
+
+ObjectPoolLifetime::~ObjectPoolLifetime()
+{
+	if (--g_NumPoolLifetimes == 0)
+	{
+		auto& registry = GetPoolRegistry();
+		for (const auto& pool : registry.Pools)
+		{
+			pool.first->store(nullptr);
+			delete pool.second;
+		}
+		registry.~PoolRegistry();
+	}
+}
+
+FixedSizePool& GetObjectPool(std::atomic<FixedSizePool*>& pool,
+	std::size_t blockSize, std::size_t alignment)
+{
+	auto& registry = GetPoolRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	// another thread may have created it meanwhile
+	auto pPool = pool.load(std::memory_order_relaxed);
+	if (!pPool)
+	{
+		std::unique_ptr<FixedSizePool> pNewPool(new FixedSizePool(blockSize, alignment));
+		registry.Pools.push_back(std::make_pair(&pool, pNewPool.get()));
+		pPool = pNewPool.release();
+		pool.store(pPool, std::memory_order_release);
+	}
+	return *pPool;
+}
+
+FrameArena::FrameArena(std::size_t capacity)
+	: m_Capacity(capacity), m_Offset(0), m_NumAllocations(0)
+{
+	m_pMemory = static_cast<std::uint8_t*>(_aligned_malloc(capacity, 64));
+	if (!m_pMemory)
+	{
+		throw std::bad_alloc();
+	}
+}
+
+FrameArena::~FrameArena()
+{
+	_aligned_free(m_pMemory);
+}
+
+void* FrameArena::Allocate(std::size_t size, std::size_t alignment)
+{
+	// reserve enough to align within the reservation, without a CAS loop
+	auto offset = m_Offset.fetch_add(size + alignment - 1, std::memory_order_relaxed);
+	auto aligned = AlignUp(offset, alignment);
+	if (aligned + size > m_Capacity)
+	{
+		throw std::bad_alloc();
+	}
+
+	m_NumAllocations.fetch_add(1, std::memory_order_relaxed);
+	return m_pMemory + aligned;
+}
+
+void FrameArena::Free(void*)
+{
+	m_NumAllocations.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void FrameArena::Reset()
+{
+	if (m_NumAllocations.load() != 0)
+	{
+		throw std::runtime_error("FrameArena reset while objects are alive");
+	}
+	m_Offset.store(0);
+}
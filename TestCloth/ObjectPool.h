@@ -0,0 +1,208 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// free lists of fixed-size blocks carved from large chunks.
+// a chunk is returned to the heap once all its blocks are free, except for
+// one empty chunk kept so that alternating allocations do not thrash.
+class FixedSizePool
+{
+public:
+	FixedSizePool(std::size_t blockSize, std::size_t alignment);
+	FixedSizePool(const FixedSizePool&) = delete;
+	FixedSizePool& operator=(const FixedSizePool&) = delete;
+	~FixedSizePool();
+
+	void* Allocate();
+	void Free(void* p);
+
+private:
+	struct FreeBlock
+	{
+		FreeBlock* pNext;
+	};
+
+	// header at the beginning of every chunk, followed by its blocks
+	struct Chunk
+	{
+		std::uint8_t* pBlocks;
+		FreeBlock* pFreeList;
+		std::size_t NumUsed;
+
+		// list of the chunks with free blocks
+		Chunk* pPrevAvailable;
+		Chunk* pNextAvailable;
+	};
+
+	Chunk* AllocateChunk();
+	void FreeChunk(Chunk* pChunk);
+	Chunk* FindChunk(void* p) const;
+	void LinkAvailable(Chunk* pChunk);
+	void UnlinkAvailable(Chunk* pChunk);
+
+	std::mutex m_Mutex;
+
+	// all chunks, sorted by address
+	std::vector<Chunk*> m_Chunks;
+	Chunk* m_pAvailable = nullptr;
+	Chunk* m_pSpare = nullptr;
+
+	std::size_t m_BlockSize;
+	std::size_t m_Alignment;
+	std::size_t m_NumBlocksPerChunk;
+};
+
+// pool of blocks of blockSize bytes, created on first use and stored in
+// pool. the pools are kept until the static objects of every file
+// including this header are destroyed, so objects may be freed at any time
+// before that, including by the destructors of static objects.
+FixedSizePool& GetObjectPool(std::atomic<FixedSizePool*>& pool,
+	std::size_t blockSize, std::size_t alignment);
+
+// constructed before and destroyed after the static objects of every file
+// including this header, as std::ios_base::Init, it owns the pools of
+// GetObjectPool(). static initialization order is not defined across files,
+// and VS2013 has no thread-safe function-local statics to avoid that.
+class ObjectPoolLifetime
+{
+public:
+	ObjectPoolLifetime();
+	ObjectPoolLifetime(const ObjectPoolLifetime&) = delete;
+	ObjectPoolLifetime& operator=(const ObjectPoolLifetime&) = delete;
+	~ObjectPoolLifetime();
+};
+
+namespace
+{
+	ObjectPoolLifetime g_ObjectPoolLifetime;
+}
+
+// allocator taking single objects of type T from a pool of its own.
+// allocate_shared rebinds it to the block holding object and reference
+// counts together, so each object type gets a segregated free list.
+template <typename T>
+class PoolAllocator
+{
+public:
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind
+	{
+		typedef PoolAllocator<U> other;
+	};
+
+	PoolAllocator() {}
+
+	template <typename U>
+	PoolAllocator(const PoolAllocator<U>&) {}
+
+	T* allocate(std::size_t n)
+	{
+		if (n != 1)
+		{
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		}
+		return static_cast<T*>(GetPool().Allocate());
+	}
+
+	void deallocate(T* p, std::size_t n)
+	{
+		if (n != 1)
+		{
+			::operator delete(p);
+			return;
+		}
+		GetPool().Free(p);
+	}
+
+	template <typename U>
+	bool operator==(const PoolAllocator<U>&) const { return true; }
+
+	template <typename U>
+	bool operator!=(const PoolAllocator<U>&) const { return false; }
+
+private:
+	static FixedSizePool& GetPool()
+	{
+		auto pPool = s_pPool.load(std::memory_order_acquire);
+		return pPool ? *pPool : GetObjectPool(s_pPool, sizeof(T), std::alignment_of<T>::value);
+	}
+
+	// trivially constructed, so it is zero-initialized before any
+	// constructor runs that could allocate
+	static std::atomic<FixedSizePool*> s_pPool;
+};
+
+template <typename T>
+std::atomic<FixedSizePool*> PoolAllocator<T>::s_pPool;
+
+// bump allocator for objects living at most one frame.
+// allocation is lock-free; Reset() requires all the objects to be freed.
+class FrameArena
+{
+public:
+	explicit FrameArena(std::size_t capacity);
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+	~FrameArena();
+
+	// throws std::bad_alloc if the arena is full
+	void* Allocate(std::size_t size, std::size_t alignment);
+	void Free(void* p);
+
+	// reuse the whole arena, typically at the beginning of a frame
+	void Reset();
+
+private:
+	std::uint8_t* m_pMemory;
+	std::size_t m_Capacity;
+	std::atomic<std::size_t> m_Offset;
+	std::atomic<std::uint32_t> m_NumAllocations;
+};
+
+// allocator taking memory from a FrameArena
+template <typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind
+	{
+		typedef ArenaAllocator<U> other;
+	};
+
+	explicit ArenaAllocator(FrameArena& arena) : m_pArena(&arena) {}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : m_pArena(other.GetArena()) {}
+
+	T* allocate(std::size_t n)
+	{
+		return static_cast<T*>(m_pArena->Allocate(n * sizeof(T), std::alignment_of<T>::value));
+	}
+
+	void deallocate(T* p, std::size_t)
+	{
+		m_pArena->Free(p);
+	}
+
+	FrameArena* GetArena() const { return m_pArena; }
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return m_pArena == other.GetArena(); }
+
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return m_pArena != other.GetArena(); }
+
+private:
+	FrameArena* m_pArena;
+};
@@ -0,0 +1,119 @@
+#include "stdafx.h"
+#include "Profiler.h"
+
+#include <mutex>
+
+namespace
+{
+	std::map<std::wstring, double> g_Statistics;
+	std::mutex g_StatisticsMutex;
+
+	ComPtr<ID3D11Query> CreateQuery(D3D11_QUERY type)
+	{
+		D3D11_QUERY_DESC queryDesc;
+		ZeroMemory(&queryDesc, sizeof(queryDesc));
+		queryDesc.Query = type;
+
+		ID3D11Query* pQuery;
+		if (FAILED(DXUTGetD3D11Device()->CreateQuery(&queryDesc, &pQuery)))
+		{
+			throw std::runtime_error("Failed to create query");
+		}
+
+		return ComPtr<ID3D11Query>(pQuery, false);
+	}
+}
+
+void GpuTimer::Begin()
+{
+	auto& queries = m_Queries[m_iCurrent];
+
+	// skip this frame if the oldest measurement is still in flight
+	if (queries.Pending && !Resolve(queries))
+	{
+		return;
+	}
+
+	if (!queries.Disjoint)
+	{
+		queries.Disjoint = CreateQuery(D3D11_QUERY_TIMESTAMP_DISJOINT);
+		queries.Begin = CreateQuery(D3D11_QUERY_TIMESTAMP);
+		queries.End = CreateQuery(D3D11_QUERY_TIMESTAMP);
+	}
+
+	auto pCTX = DXUTGetD3D11DeviceContext();
+	pCTX->Begin(queries.Disjoint.get());
+	pCTX->End(queries.Begin.get());
+	m_Measuring = true;
+}
+
+void GpuTimer::End()
+{
+	if (!m_Measuring)
+	{
+		return;
+	}
+
+	auto& queries = m_Queries[m_iCurrent];
+	auto pCTX = DXUTGetD3D11DeviceContext();
+	pCTX->End(queries.End.get());
+	pCTX->End(queries.Disjoint.get());
+	queries.Pending = true;
+
+	m_Measuring = false;
+	m_iCurrent = (m_iCurrent + 1) % NUM_FRAMES_IN_FLIGHT;
+}
+
+bool GpuTimer::Resolve(Queries& queries)
+{
+	auto pCTX = DXUTGetD3D11DeviceContext();
+
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+	UINT64 begin, end;
+	if (pCTX->GetData(queries.Disjoint.get(), &disjoint, sizeof(disjoint),
+		D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+		pCTX->GetData(queries.Begin.get(), &begin, sizeof(begin),
+		D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+		pCTX->GetData(queries.End.get(), &end, sizeof(end),
+		D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+	{
+		return false;
+	}
+
+	queries.Pending = false;
+	if (!disjoint.Disjoint)
+	{
+		double milliseconds = 1000.0 * (end - begin) / disjoint.Frequency;
+		m_Milliseconds = m_Milliseconds == 0.0 ? milliseconds :
+			m_Milliseconds * 0.9 + milliseconds * 0.1;
+	}
+
+	return true;
+}
+
+void CpuTimer::Restart()
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	m_Start = counter.QuadPart;
+}
+
+double CpuTimer::GetMilliseconds() const
+{
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return 1000.0 * (counter.QuadPart - m_Start) / frequency.QuadPart;
+}
+
+void SetStatistic(const std::wstring& name, double value)
+{
+	std::lock_guard<std::mutex> lock(g_StatisticsMutex);
+	g_Statistics[name] = value;
+}
+
+std::map<std::wstring, double> GetStatistics()
+{
+	std::lock_guard<std::mutex> lock(g_StatisticsMutex);
+	return g_Statistics;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// measures GPU time between Begin() and End() with timestamp queries.
+// results are read back a few frames later without stalling the GPU.
+class GpuTimer
+{
+public:
+	GpuTimer() = default;
+	GpuTimer(const GpuTimer&) = delete;
+	GpuTimer& operator=(const GpuTimer&) = delete;
+
+	void Begin();
+	void End();
+
+	// smoothed duration in milliseconds (0 until the first result arrives)
+	double GetMilliseconds() const { return m_Milliseconds; }
+
+private:
+	static const std::uint32_t NUM_FRAMES_IN_FLIGHT = 4;
+
+	struct Queries
+	{
+		ComPtr<ID3D11Query> Disjoint;
+		ComPtr<ID3D11Query> Begin;
+		ComPtr<ID3D11Query> End;
+		bool Pending = false;
+	};
+
+	bool Resolve(Queries& queries);
+
+	Queries m_Queries[NUM_FRAMES_IN_FLIGHT];
+	std::uint32_t m_iCurrent = 0;
+	bool m_Measuring = false;
+	double m_Milliseconds = 0.0;
+};
+
+// measures CPU time with the performance counter
+class CpuTimer
+{
+public:
+	CpuTimer() { Restart(); }
+
+	void Restart();
+
+	// elapsed time since construction or the last Restart()
+	double GetMilliseconds() const;
+
+private:
+	std::int64_t m_Start;
+};
+
+// named statistics shown on the HUD, may be set from any thread
+void SetStatistic(const std::wstring& name, double value);
+std::map<std::wstring, double> GetStatistics();
@@ -0,0 +1,421 @@
+#include "SdkMeshAnimation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	using namespace SdkMesh;
+
+	// keys dropped in a row at most, which bounds the cost of dropping them
+	const std::uint32_t MAX_DROPPED_KEYS = 16;
+
+	// keys a cursor steps over before searching instead
+	const std::uint32_t MAX_CURSOR_STEPS = 4;
+
+	// transforms slerped per block of stack arrays
+	const std::size_t SLERP_BLOCK_SIZE = 256;
+
+	// coefficients of the polynomial slerp of D. Eberly, "A Fast and Accurate
+	// Algorithm for Computing SLERP", with the last term corrected for
+	// truncating the series after 8 terms
+	const float SLERP_CORRECTION = 1.90110745351730037f;
+	const float SLERP_U[8] =
+	{
+		1.0f / (1 * 3), 1.0f / (2 * 5), 1.0f / (3 * 7), 1.0f / (4 * 9),
+		1.0f / (5 * 11), 1.0f / (6 * 13), 1.0f / (7 * 15), SLERP_CORRECTION / (8 * 17),
+	};
+	const float SLERP_V[8] =
+	{
+		1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9,
+		5.0f / 11, 6.0f / 13, 7.0f / 15, SLERP_CORRECTION * 8 / 17,
+	};
+
+	// sin(t * angle) / (t * sin(angle)) for squared = t * t, written out for the
+	// compiler to vectorize the loops calling it
+	inline float SlerpSeries(float squared, float cosineMinusOne)
+	{
+		float b0 = (SLERP_U[0] * squared - SLERP_V[0]) * cosineMinusOne;
+		float b1 = (SLERP_U[1] * squared - SLERP_V[1]) * cosineMinusOne;
+		float b2 = (SLERP_U[2] * squared - SLERP_V[2]) * cosineMinusOne;
+		float b3 = (SLERP_U[3] * squared - SLERP_V[3]) * cosineMinusOne;
+		float b4 = (SLERP_U[4] * squared - SLERP_V[4]) * cosineMinusOne;
+		float b5 = (SLERP_U[5] * squared - SLERP_V[5]) * cosineMinusOne;
+		float b6 = (SLERP_U[6] * squared - SLERP_V[6]) * cosineMinusOne;
+		float b7 = (SLERP_U[7] * squared - SLERP_V[7]) * cosineMinusOne;
+		return 1.0f + b0 * (1.0f + b1 * (1.0f + b2 * (1.0f + b3 *
+			(1.0f + b4 * (1.0f + b5 * (1.0f + b6 * (1.0f + b7)))))));
+	}
+
+	// array of count elements at offset, written not to overflow on any value
+	template <typename T>
+	Span<T> GetArray(const std::uint8_t* pData, std::size_t size,
+		std::uint64_t offset, std::uint64_t count, const char* pName)
+	{
+		if (offset > size || count > (size - offset) / sizeof(T))
+		{
+			throw std::runtime_error(std::string("SDKmesh animation ") + pName + " exceed the file");
+		}
+		if (!IsAligned<T>(pData + offset))
+		{
+			throw std::runtime_error(std::string("SDKmesh animation ") + pName + " are misaligned");
+		}
+		return Span<T>(reinterpret_cast<const T*>(pData + offset), static_cast<std::size_t>(count));
+	}
+
+	void Lerp(const float* pFrom, const float* pTo, const float* pWeights, float* pResult, std::size_t size)
+	{
+		for (std::size_t i = 0; i < size; i++)
+		{
+			pResult[i] = pFrom[i] + (pTo[i] - pFrom[i]) * pWeights[i];
+		}
+	}
+
+	// result = from * fromWeights + to * toWeights
+	void Blend(const float* pFrom, const float* pTo, const float* pFromWeights, const float* pToWeights,
+		float* pResult, std::size_t size)
+	{
+		for (std::size_t i = 0; i < size; i++)
+		{
+			pResult[i] = pFrom[i] * pFromWeights[i] + pTo[i] * pToWeights[i];
+		}
+	}
+
+	// result[i] = from[i] interpolated towards to[i] by weights[i]: translations
+	// linearly, rotations spherically along the shorter arc. the weights of
+	// slerp are polynomials of the cosine rather than sines of the angle, so
+	// that the loops over the arrays have no calls or branches and vectorize.
+	// rotations stay within 1e-6 of exact slerp. the weights are computed in
+	// blocks on the stack, which no array of the transforms can alias, and
+	// every loop writes a single array, keeping the checks for overlapping
+	// arrays few enough for compilers to still vectorize.
+	void Interpolate(const RigidTransforms& from, const RigidTransforms& to, const float* pWeights,
+		RigidTransforms& result, std::size_t size)
+	{
+		Lerp(from.TranslationX.data(), to.TranslationX.data(), pWeights, result.TranslationX.data(), size);
+		Lerp(from.TranslationY.data(), to.TranslationY.data(), pWeights, result.TranslationY.data(), size);
+		Lerp(from.TranslationZ.data(), to.TranslationZ.data(), pWeights, result.TranslationZ.data(), size);
+
+		const float* pFromX = from.RotationX.data();
+		const float* pFromY = from.RotationY.data();
+		const float* pFromZ = from.RotationZ.data();
+		const float* pFromW = from.RotationW.data();
+		const float* pToX = to.RotationX.data();
+		const float* pToY = to.RotationY.data();
+		const float* pToZ = to.RotationZ.data();
+		const float* pToW = to.RotationW.data();
+
+		for (std::size_t start = 0; start < size; start += SLERP_BLOCK_SIZE)
+		{
+			std::size_t blockSize = std::min(size - start, SLERP_BLOCK_SIZE);
+			float fromWeights[SLERP_BLOCK_SIZE];
+			float toWeights[SLERP_BLOCK_SIZE];
+
+			for (std::size_t j = 0; j < blockSize; j++)
+			{
+				std::size_t i = start + j;
+				float t = pWeights[i];
+				float cosine = pFromX[i] * pToX[i] + pFromY[i] * pToY[i] + pFromZ[i] * pToZ[i] + pFromW[i] * pToW[i];
+				float sign = cosine < 0.0f ? -1.0f : 1.0f;
+				float cosineMinusOne = cosine * sign - 1.0f;
+
+				float s = 1.0f - t;
+				toWeights[j] = t * SlerpSeries(t * t, cosineMinusOne) * sign;
+				fromWeights[j] = s * SlerpSeries(s * s, cosineMinusOne);
+			}
+
+			Blend(pFromX + start, pToX + start, fromWeights, toWeights, result.RotationX.data() + start, blockSize);
+			Blend(pFromY + start, pToY + start, fromWeights, toWeights, result.RotationY.data() + start, blockSize);
+			Blend(pFromZ + start, pToZ + start, fromWeights, toWeights, result.RotationZ.data() + start, blockSize);
+			Blend(pFromW + start, pToW + start, fromWeights, toWeights, result.RotationW.data() + start, blockSize);
+		}
+	}
+
+	void CopyTransform(const RigidTransforms& source, std::size_t iSource,
+		RigidTransforms& destination, std::size_t iDestination)
+	{
+		destination.TranslationX[iDestination] = source.TranslationX[iSource];
+		destination.TranslationY[iDestination] = source.TranslationY[iSource];
+		destination.TranslationZ[iDestination] = source.TranslationZ[iSource];
+		destination.RotationX[iDestination] = source.RotationX[iSource];
+		destination.RotationY[iDestination] = source.RotationY[iSource];
+		destination.RotationZ[iDestination] = source.RotationZ[iSource];
+		destination.RotationW[iDestination] = source.RotationW[iSource];
+	}
+
+	// keys of a track, with rotations normalized as CDXUTSDKMesh::TransformFrame does
+	void LoadKeys(Span<AnimationKey> keys, RigidTransforms& transforms)
+	{
+		transforms.Resize(keys.GetSize());
+		for (std::size_t i = 0; i < keys.GetSize(); i++)
+		{
+			const auto& key = keys[i];
+			transforms.TranslationX[i] = key.Translation.x;
+			transforms.TranslationY[i] = key.Translation.y;
+			transforms.TranslationZ[i] = key.Translation.z;
+
+			const auto& q = key.Orientation;
+			float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+			bool identity = !(length > 0.0f);
+			transforms.RotationX[i] = identity ? 0.0f : q.x / length;
+			transforms.RotationY[i] = identity ? 0.0f : q.y / length;
+			transforms.RotationZ[i] = identity ? 0.0f : q.z / length;
+			transforms.RotationW[i] = identity ? 1.0f : q.w / length;
+		}
+	}
+
+	// keys kept of a track, such that interpolating between them reproduces
+	// the dropped ones within tolerance. the first and the last are kept.
+	class KeyReducer
+	{
+	public:
+		KeyReducer()
+		{
+			m_From.Resize(MAX_DROPPED_KEYS);
+			m_To.Resize(MAX_DROPPED_KEYS);
+			m_Interpolated.Resize(MAX_DROPPED_KEYS);
+			m_Weights.resize(MAX_DROPPED_KEYS);
+		}
+
+		void Reduce(const RigidTransforms& keys, float tolerance, std::vector<std::uint32_t>& kept)
+		{
+			kept.clear();
+			kept.push_back(0);
+
+			std::uint32_t numKeys = static_cast<std::uint32_t>(keys.GetSize());
+			std::uint32_t from = 0;
+			for (std::uint32_t to = 2; to < numKeys; to++)
+			{
+				if (to - from > MAX_DROPPED_KEYS + 1 || !Reproduces(keys, from, to, tolerance))
+				{
+					from = to - 1;
+					kept.push_back(from);
+				}
+			}
+
+			if (numKeys > 1)
+			{
+				kept.push_back(numKeys - 1);
+			}
+		}
+
+	private:
+		// whether the keys between from and to are within tolerance of interpolating them
+		bool Reproduces(const RigidTransforms& keys, std::uint32_t from, std::uint32_t to, float tolerance)
+		{
+			std::uint32_t numBetween = to - from - 1;
+			for (std::uint32_t i = 0; i < numBetween; i++)
+			{
+				CopyTransform(keys, from, m_From, i);
+				CopyTransform(keys, to, m_To, i);
+				m_Weights[i] = static_cast<float>(i + 1) / static_cast<float>(to - from);
+			}
+			Interpolate(m_From, m_To, m_Weights.data(), m_Interpolated, numBetween);
+
+			for (std::uint32_t i = 0; i < numBetween; i++)
+			{
+				std::uint32_t iKey = from + 1 + i;
+				float cosine = m_Interpolated.RotationX[i] * keys.RotationX[iKey] +
+					m_Interpolated.RotationY[i] * keys.RotationY[iKey] +
+					m_Interpolated.RotationZ[i] * keys.RotationZ[iKey] +
+					m_Interpolated.RotationW[i] * keys.RotationW[iKey];
+				float sign = cosine < 0.0f ? -1.0f : 1.0f;
+
+				float error = std::max(std::max(
+					std::fabs(m_Interpolated.TranslationX[i] - keys.TranslationX[iKey]),
+					std::fabs(m_Interpolated.TranslationY[i] - keys.TranslationY[iKey])),
+					std::fabs(m_Interpolated.TranslationZ[i] - keys.TranslationZ[iKey]));
+				error = std::max(error, std::fabs(m_Interpolated.RotationX[i] - keys.RotationX[iKey] * sign));
+				error = std::max(error, std::fabs(m_Interpolated.RotationY[i] - keys.RotationY[iKey] * sign));
+				error = std::max(error, std::fabs(m_Interpolated.RotationZ[i] - keys.RotationZ[iKey] * sign));
+				error = std::max(error, std::fabs(m_Interpolated.RotationW[i] - keys.RotationW[iKey] * sign));
+				if (!(error <= tolerance))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		RigidTransforms m_From;
+		RigidTransforms m_To;
+		RigidTransforms m_Interpolated;
+		std::vector<float> m_Weights;
+	};
+}
+
+namespace SdkMesh
+{
+	AnimationView::AnimationView(const void* pData, std::size_t size)
+		: m_pData(static_cast<const std::uint8_t*>(pData))
+	{
+		if (size < sizeof(AnimationHeader))
+		{
+			throw std::runtime_error("SDKmesh animation file is too small for its header");
+		}
+		if (!IsAligned<AnimationHeader>(m_pData))
+		{
+			throw std::runtime_error("SDKmesh animation file is misaligned");
+		}
+		m_pHeader = reinterpret_cast<const AnimationHeader*>(m_pData);
+
+		const auto& header = *m_pHeader;
+		if (header.IsBigEndian)
+		{
+			throw std::runtime_error("Big endian SDKmesh animation files are not supported");
+		}
+
+		m_Tracks = GetArray<AnimationTrack>(m_pData, size, header.AnimationDataOffset, header.NumFrames, "tracks");
+		for (const auto& track : m_Tracks)
+		{
+			if (!std::memchr(track.FrameName, '\0', sizeof(track.FrameName)))
+			{
+				throw std::runtime_error("SDKmesh animation frame name is not terminated");
+			}
+			if (track.DataOffset > size)
+			{
+				throw std::runtime_error("SDKmesh animation keys exceed the file");
+			}
+			GetArray<AnimationKey>(m_pData, size, sizeof(AnimationHeader) + track.DataOffset,
+				header.NumAnimationKeys, "keys");
+		}
+	}
+
+	Span<AnimationKey> AnimationView::GetKeys(std::uint32_t iTrack) const
+	{
+		if (iTrack >= m_Tracks.GetSize())
+		{
+			throw std::runtime_error("SDKmesh animation track index out of range");
+		}
+		return Span<AnimationKey>(reinterpret_cast<const AnimationKey*>(
+			m_pData + sizeof(AnimationHeader) + m_Tracks[iTrack].DataOffset), m_pHeader->NumAnimationKeys);
+	}
+
+	AnimationFile::AnimationFile(const std::wstring& fileName)
+		: m_File(fileName)
+		, m_View(m_File.GetData(), m_File.GetSize())
+	{
+	}
+
+	void RigidTransforms::Resize(std::size_t size)
+	{
+		TranslationX.resize(size);
+		TranslationY.resize(size);
+		TranslationZ.resize(size);
+		RotationX.resize(size);
+		RotationY.resize(size);
+		RotationZ.resize(size);
+		RotationW.resize(size, 1.0f);
+	}
+
+	AnimationClip::AnimationClip(const AnimationView& view, float tolerance)
+	{
+		const auto& header = view.GetHeader();
+		auto tracks = view.GetTracks();
+		if (header.NumAnimationKeys == 0 && !tracks.IsEmpty())
+		{
+			throw std::runtime_error("SDKmesh animation has no keys");
+		}
+
+		// the bind pose is only played if it is the only key
+		std::uint32_t iFirstKey = header.NumAnimationKeys > 1 ? 1 : 0;
+		m_LoopKeys = static_cast<float>(std::max(header.NumAnimationKeys, 2u) - 1);
+		m_KeysPerSecond = header.AnimationFPS;
+
+		KeyReducer reducer;
+		RigidTransforms keys;
+		std::vector<std::uint32_t> kept;
+		m_TrackStarts.push_back(0);
+		for (std::uint32_t iTrack = 0; iTrack < tracks.GetSize(); iTrack++)
+		{
+			auto allKeys = view.GetKeys(iTrack);
+			LoadKeys(Span<AnimationKey>(allKeys.GetData() + iFirstKey, allKeys.GetSize() - iFirstKey), keys);
+			reducer.Reduce(keys, tolerance, kept);
+
+			auto iStart = m_KeyTimes.size();
+			m_KeyTimes.resize(iStart + kept.size());
+			m_Keys.Resize(iStart + kept.size());
+			for (std::size_t i = 0; i < kept.size(); i++)
+			{
+				m_KeyTimes[iStart + i] = static_cast<float>(kept[i]);
+				CopyTransform(keys, kept[i], m_Keys, iStart + i);
+			}
+
+			m_TrackNames.push_back(tracks[iTrack].FrameName);
+			m_TrackStarts.push_back(static_cast<std::uint32_t>(m_KeyTimes.size()));
+		}
+	}
+
+	std::uint32_t AnimationClip::FindTrack(const char* pFrameName) const
+	{
+		for (std::uint32_t i = 0; i < m_TrackNames.size(); i++)
+		{
+			if (m_TrackNames[i] == pFrameName)
+			{
+				return i;
+			}
+		}
+
+		return INVALID_INDEX;
+	}
+
+	AnimationSampler::AnimationSampler(const AnimationClip& clip)
+		: m_pClip(&clip)
+		, m_Cursors(clip.m_TrackStarts.begin(), clip.m_TrackStarts.end() - 1)
+	{
+		m_From.Resize(clip.GetNumTracks());
+		m_To.Resize(clip.GetNumTracks());
+		m_Weights.resize(clip.GetNumTracks());
+	}
+
+	void AnimationSampler::Sample(double time, RigidTransforms& pose)
+	{
+		const auto& clip = *m_pClip;
+		auto numTracks = clip.GetNumTracks();
+		const float* pTimes = clip.m_KeyTimes.data();
+
+		// position in keys within the loop, for the key found at the truncated
+		// position by CDXUTSDKMesh::GetAnimationKeyFromTime
+		auto position = static_cast<float>(std::fmod(time * clip.m_KeysPerSecond, clip.m_LoopKeys));
+		if (position < 0.0f)
+		{
+			position += clip.m_LoopKeys;
+		}
+		bool forward = position >= m_LastPosition;
+		m_LastPosition = position;
+
+		for (std::uint32_t iTrack = 0; iTrack < numTracks; iTrack++)
+		{
+			auto first = clip.m_TrackStarts[iTrack];
+			auto last = clip.m_TrackStarts[iTrack + 1] - 1;
+
+			// the last key at or before the position
+			auto cursor = m_Cursors[iTrack];
+			for (std::uint32_t step = 0; forward && step < MAX_CURSOR_STEPS &&
+				cursor < last && pTimes[cursor + 1] <= position; step++)
+			{
+				cursor++;
+			}
+			if (!forward || (cursor < last && pTimes[cursor + 1] <= position))
+			{
+				cursor = static_cast<std::uint32_t>(
+					std::upper_bound(pTimes + first, pTimes + last + 1, position) - pTimes) - 1;
+				m_NumSearches++;
+			}
+			m_Cursors[iTrack] = cursor;
+
+			// from the last key, the loop continues to the first
+			auto next = cursor < last ? cursor + 1 : first;
+			auto nextTime = cursor < last ? pTimes[cursor + 1] : clip.m_LoopKeys;
+			m_Weights[iTrack] = (position - pTimes[cursor]) / (nextTime - pTimes[cursor]);
+			CopyTransform(clip.m_Keys, cursor, m_From, iTrack);
+			CopyTransform(clip.m_Keys, next, m_To, iTrack);
+		}
+
+		pose.Resize(numTracks);
+		Interpolate(m_From, m_To, m_Weights.data(), pose, numTracks);
+	}
+}
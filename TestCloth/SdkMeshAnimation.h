@@ -0,0 +1,155 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "SdkMeshView.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// .sdkmesh_anim files, keyframes of the frames of an SDKmesh sampled at a
+// fixed rate. key 0 is the bind pose, keys 1 to NumAnimationKeys - 1 loop.
+namespace SdkMesh
+{
+#pragma pack(push, 8)
+
+	struct AnimationHeader
+	{
+		std::uint32_t Version;
+		std::uint8_t IsBigEndian;
+		std::uint32_t FrameTransformType;
+		std::uint32_t NumFrames;
+		std::uint32_t NumAnimationKeys;
+		std::uint32_t AnimationFPS;
+		std::uint64_t AnimationDataSize;
+		std::uint64_t AnimationDataOffset;
+	};
+
+	struct AnimationKey
+	{
+		DirectX::XMFLOAT3 Translation;
+		DirectX::XMFLOAT4 Orientation;
+		DirectX::XMFLOAT3 Scaling;
+	};
+
+	// keys of the frame of the same name, DataOffset is from the end of the header
+	struct AnimationTrack
+	{
+		char FrameName[MAX_NAME];
+		std::uint64_t DataOffset;
+	};
+
+#pragma pack(pop)
+
+	static_assert(sizeof(AnimationHeader) == 40, "SDKmesh animation header size mismatch");
+	static_assert(sizeof(AnimationKey) == 40, "SDKmesh animation key size mismatch");
+	static_assert(sizeof(AnimationTrack) == 112, "SDKmesh animation track size mismatch");
+
+	// animation file in memory, which has to outlive the view. the header,
+	// the tracks and the ranges of their keys are checked on construction,
+	// errors throw std::runtime_error.
+	class AnimationView
+	{
+	public:
+		AnimationView(const void* pData, std::size_t size);
+
+		const AnimationHeader& GetHeader() const { return *m_pHeader; }
+		Span<AnimationTrack> GetTracks() const { return m_Tracks; }
+
+		// NumAnimationKeys keys of a track
+		Span<AnimationKey> GetKeys(std::uint32_t iTrack) const;
+
+	private:
+		const std::uint8_t* m_pData;
+		const AnimationHeader* m_pHeader;
+		Span<AnimationTrack> m_Tracks;
+	};
+
+	// mapped animation file
+	class AnimationFile
+	{
+	public:
+		explicit AnimationFile(const std::wstring& fileName);
+
+		const AnimationView& GetView() const { return m_View; }
+
+	private:
+		MappedFile m_File;
+		AnimationView m_View;
+	};
+
+	// translations and rotations (unit quaternions) as structure of arrays
+	struct RigidTransforms
+	{
+		std::vector<float> TranslationX;
+		std::vector<float> TranslationY;
+		std::vector<float> TranslationZ;
+		std::vector<float> RotationX;
+		std::vector<float> RotationY;
+		std::vector<float> RotationZ;
+		std::vector<float> RotationW;
+
+		void Resize(std::size_t size);
+		std::size_t GetSize() const { return TranslationX.size(); }
+	};
+
+	// animation converted for sampling. keys reproduced by interpolating
+	// their neighbours within tolerance are dropped, so that constant and
+	// linear stretches cost nothing, and the rest is stored as structure of
+	// arrays. scaling is ignored, as CDXUTSDKMesh::TransformFrame does.
+	class AnimationClip
+	{
+	public:
+		explicit AnimationClip(const AnimationView& view, float tolerance = 1e-5f);
+
+		std::uint32_t GetNumTracks() const { return static_cast<std::uint32_t>(m_TrackNames.size()); }
+		std::size_t GetNumKeys() const { return m_KeyTimes.size(); }
+
+		// track animating the named frame, INVALID_INDEX if there is none
+		std::uint32_t FindTrack(const char* pFrameName) const;
+		const std::string& GetTrackName(std::uint32_t iTrack) const { return m_TrackNames[iTrack]; }
+
+	private:
+		friend class AnimationSampler;
+
+		// the keys of a track are [m_TrackStarts[i], m_TrackStarts[i + 1]),
+		// their times count keys from the start of the loop
+		std::vector<std::string> m_TrackNames;
+		std::vector<std::uint32_t> m_TrackStarts;
+		std::vector<float> m_KeyTimes;
+		RigidTransforms m_Keys;
+
+		double m_KeysPerSecond;
+		float m_LoopKeys;
+	};
+
+	// samples a clip into a pose with a rotation and translation per track.
+	// every track keeps a cursor on its current key, so that sampling time
+	// moving forward only steps to the next keys; going back, e.g. on seeks
+	// and loops, or far ahead searches the keys instead. tracks are
+	// interpolated in one batch over the arrays of the pose.
+	class AnimationSampler
+	{
+	public:
+		explicit AnimationSampler(const AnimationClip& clip);
+
+		// pose at a time in seconds, looping as
+		// CDXUTSDKMesh::GetAnimationKeyFromTime, but interpolated
+		void Sample(double time, RigidTransforms& pose);
+
+		// tracks whose key was searched rather than stepped to
+		std::uint64_t GetNumSearches() const { return m_NumSearches; }
+
+	private:
+		const AnimationClip* m_pClip;
+		std::vector<std::uint32_t> m_Cursors;
+		float m_LastPosition = 0.0f;
+		std::uint64_t m_NumSearches = 0;
+
+		// keys interpolated per track, gathered before the batch
+		RigidTransforms m_From;
+		RigidTransforms m_To;
+		std::vector<float> m_Weights;
+	};
+}
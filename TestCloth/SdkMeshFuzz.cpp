@@ -0,0 +1,33 @@
+// libFuzzer harness for SdkMesh::View::Validate(), not part of the project build.
+// the portable SdkMesh files compile outside Windows, with the DirectXMath
+// headers on the include path, e.g.
+//   clang++ -std=c++11 -g -O1 -fsanitize=fuzzer,address,undefined -I<DirectXMath>/Inc
+//     SdkMeshFuzz.cpp SdkMeshView.cpp MappedFile.cpp -o SdkMeshFuzz
+//   ./SdkMeshFuzz corpus/
+#include "SdkMeshView.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* pData, std::size_t size)
+{
+	// files are read into aligned memory, the view rejects anything else
+	std::vector<std::uint64_t> buffer((size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+	if (size > 0)
+	{
+		std::memcpy(buffer.data(), pData, size);
+	}
+
+	try
+	{
+		SdkMesh::View view(buffer.data(), size);
+		view.Validate();
+	}
+	catch (const std::runtime_error&)
+	{
+	}
+	return 0;
+}
@@ -0,0 +1,220 @@
+#include "SdkMeshHierarchy.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+using namespace DirectX;
+
+namespace SdkMesh
+{
+	FrameHierarchy::FrameHierarchy(const View& view, std::uint32_t maxTaskFrames)
+	{
+		auto frames = view.GetFrames();
+		auto numFrames = static_cast<std::uint32_t>(frames.GetSize());
+		maxTaskFrames = std::max(maxTaskFrames, 1u);
+
+		// frames no other frame links to start the trees, each linked frame
+		// has to be reached through exactly one link
+		std::vector<bool> linked(numFrames);
+		for (const auto& frame : frames)
+		{
+			for (auto link : { frame.ChildFrame, frame.SiblingFrame })
+			{
+				if (link != INVALID_INDEX)
+				{
+					if (link >= numFrames || linked[link])
+					{
+						throw std::runtime_error("SDKmesh frames do not form a forest");
+					}
+					linked[link] = true;
+				}
+			}
+		}
+
+		// depth first, so that every subtree is a range starting at its frame.
+		// siblings share the parent of the frame linking them, as in TransformFrame
+		std::vector<std::uint32_t> preorder;
+		std::vector<std::uint32_t> parents;
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> stack;
+		for (auto iFrame = numFrames; iFrame-- > 0;)
+		{
+			if (!linked[iFrame])
+			{
+				stack.push_back(std::make_pair(iFrame, INVALID_INDEX));
+			}
+		}
+		while (!stack.empty())
+		{
+			auto iFrame = stack.back().first;
+			auto parent = stack.back().second;
+			stack.pop_back();
+
+			auto position = static_cast<std::uint32_t>(preorder.size());
+			preorder.push_back(iFrame);
+			parents.push_back(parent);
+
+			const auto& frame = frames[iFrame];
+			if (frame.SiblingFrame != INVALID_INDEX)
+			{
+				stack.push_back(std::make_pair(frame.SiblingFrame, parent));
+			}
+			if (frame.ChildFrame != INVALID_INDEX)
+			{
+				stack.push_back(std::make_pair(frame.ChildFrame, position));
+			}
+		}
+
+		// frames on cycles are never reached
+		if (preorder.size() != numFrames)
+		{
+			throw std::runtime_error("SDKmesh frames do not form a forest");
+		}
+
+		std::vector<std::uint32_t> subtreeSizes(numFrames, 1);
+		for (auto i = numFrames; i-- > 0;)
+		{
+			if (parents[i] != INVALID_INDEX)
+			{
+				subtreeSizes[parents[i]] += subtreeSizes[i];
+			}
+		}
+
+		// frames with too large subtrees are shared, the largest subtrees below
+		// them are packed into tasks in order
+		std::vector<std::uint32_t> order;
+		order.reserve(numFrames);
+		for (std::uint32_t i = 0; i < numFrames; i++)
+		{
+			if (subtreeSizes[i] > maxTaskFrames)
+			{
+				order.push_back(i);
+			}
+		}
+		m_NumSharedFrames = static_cast<std::uint32_t>(order.size());
+
+		for (std::uint32_t i = 0; i < numFrames; i++)
+		{
+			bool isTaskRoot = subtreeSizes[i] <= maxTaskFrames &&
+				(parents[i] == INVALID_INDEX || subtreeSizes[parents[i]] > maxTaskFrames);
+			if (!isTaskRoot)
+			{
+				continue;
+			}
+
+			auto begin = static_cast<std::uint32_t>(order.size());
+			if (m_Tasks.empty() || m_Tasks.back().End - m_Tasks.back().Begin + subtreeSizes[i] > maxTaskFrames)
+			{
+				Task task = { begin, begin };
+				m_Tasks.push_back(task);
+			}
+			for (auto j = i; j < i + subtreeSizes[i]; j++)
+			{
+				order.push_back(j);
+			}
+			m_Tasks.back().End = static_cast<std::uint32_t>(order.size());
+		}
+
+		std::vector<std::uint32_t> positions(numFrames);
+		for (std::uint32_t i = 0; i < numFrames; i++)
+		{
+			positions[order[i]] = i;
+		}
+
+		m_Parents.resize(numFrames);
+		m_Names.resize(numFrames);
+		m_Locals.resize(numFrames);
+		m_Tracks.assign(numFrames, INVALID_INDEX);
+		m_Worlds.resize(numFrames);
+		m_Positions.resize(numFrames);
+		for (std::uint32_t i = 0; i < numFrames; i++)
+		{
+			auto iFrame = preorder[order[i]];
+			auto parent = parents[order[i]];
+			m_Parents[i] = parent == INVALID_INDEX ? INVALID_INDEX : positions[parent];
+			m_Names[i].assign(frames[iFrame].Name, strnlen(frames[iFrame].Name, MAX_NAME));
+			m_Locals[i] = frames[iFrame].Matrix;
+			m_Positions[iFrame] = i;
+		}
+	}
+
+	void FrameHierarchy::BindAnimation(const AnimationClip& clip)
+	{
+		// tracks animate the first frame of their name, as CDXUTSDKMesh::FindFrame finds
+		std::unordered_map<std::string, std::uint32_t> positions;
+		for (auto position : m_Positions)
+		{
+			positions.insert(std::make_pair(m_Names[position], position));
+		}
+
+		std::fill(m_Tracks.begin(), m_Tracks.end(), INVALID_INDEX);
+		m_NumTracks = clip.GetNumTracks();
+		for (std::uint32_t iTrack = 0; iTrack < m_NumTracks; iTrack++)
+		{
+			auto found = positions.find(clip.GetTrackName(iTrack));
+			if (found != positions.end())
+			{
+				m_Tracks[found->second] = iTrack;
+			}
+		}
+	}
+
+	void FrameHierarchy::Transform(const XMMATRIX& world, const RigidTransforms* pPose, ThreadPool* pPool)
+	{
+		if (pPose && pPose->GetSize() != m_NumTracks)
+		{
+			throw std::runtime_error("Pose does not match the animation bound to the SDKmesh frames");
+		}
+
+		TransformFrames(0, m_NumSharedFrames, world, pPose);
+
+		auto numTasks = GetNumTasks();
+		if (!pPool || numTasks < 2)
+		{
+			for (const auto& task : m_Tasks)
+			{
+				TransformFrames(task.Begin, task.End, world, pPose);
+			}
+			return;
+		}
+
+		std::atomic<std::uint32_t> nextTask(0);
+		pPool->Dispatch([&](std::uint32_t)
+		{
+			for (auto iTask = nextTask++; iTask < numTasks; iTask = nextTask++)
+			{
+				TransformFrames(m_Tasks[iTask].Begin, m_Tasks[iTask].End, world, pPose);
+			}
+		});
+	}
+
+	void FrameHierarchy::TransformFrames(std::uint32_t begin, std::uint32_t end,
+		const XMMATRIX& world, const RigidTransforms* pPose)
+	{
+		for (auto i = begin; i < end; i++)
+		{
+			// rotation followed by translation, scaling ignored as in TransformFrame
+			XMMATRIX local;
+			auto iTrack = pPose ? m_Tracks[i] : INVALID_INDEX;
+			if (iTrack != INVALID_INDEX)
+			{
+				local = XMMatrixRotationQuaternion(XMVectorSet(pPose->RotationX[iTrack],
+					pPose->RotationY[iTrack], pPose->RotationZ[iTrack], pPose->RotationW[iTrack]));
+				local.r[3] = XMVectorSet(pPose->TranslationX[iTrack],
+					pPose->TranslationY[iTrack], pPose->TranslationZ[iTrack], 1.0f);
+			}
+			else
+			{
+				local = XMLoadFloat4x4(&m_Locals[i]);
+			}
+
+			auto parent = m_Parents[i];
+			XMMATRIX parentWorld = parent == INVALID_INDEX ? world : XMLoadFloat4x4(&m_Worlds[parent]);
+			XMStoreFloat4x4(&m_Worlds[i], XMMatrixMultiply(local, parentWorld));
+		}
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "SdkMeshAnimation.h"
+#include "SdkMeshView.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+namespace SdkMesh
+{
+	// frames of an SDKmesh flattened so that parents come before their
+	// children, with world matrices computed as CDXUTSDKMesh::TransformFrame
+	// does, but in linear passes over arrays rather than recursing over the
+	// child and sibling links. subtrees of at most maxTaskFrames frames are
+	// independent of each other once the frames above them are done, they
+	// are placed after those frames and transformed in parallel.
+	class FrameHierarchy
+	{
+	public:
+		// throws std::runtime_error if the links of the frames do not form a
+		// forest, which View::Validate() guarantees
+		explicit FrameHierarchy(const View& view, std::uint32_t maxTaskFrames = 256);
+
+		std::uint32_t GetNumFrames() const { return static_cast<std::uint32_t>(m_Parents.size()); }
+
+		// groups of subtrees transformed in parallel
+		std::uint32_t GetNumTasks() const { return static_cast<std::uint32_t>(m_Tasks.size()); }
+
+		// take the local transforms of frames from the tracks of the same
+		// name in the poses sampled from clip, replacing the previous clip
+		void BindAnimation(const AnimationClip& clip);
+
+		// world matrices of all frames under world. frames are posed by
+		// their tracks in pPose, sampled from the bound clip, frames without
+		// a track or a null pPose keep their matrix from the file. tasks run
+		// on pPool, or on the calling thread if it is null.
+		void Transform(const DirectX::XMMATRIX& world, const RigidTransforms* pPose = nullptr,
+			ThreadPool* pPool = nullptr);
+
+		// world matrix of a frame of the file, as of the last Transform()
+		const DirectX::XMFLOAT4X4& GetWorld(std::uint32_t iFrame) const
+		{
+			return m_Worlds[m_Positions[iFrame]];
+		}
+
+	private:
+		// frames [Begin, End) of the arrays below
+		struct Task
+		{
+			std::uint32_t Begin;
+			std::uint32_t End;
+		};
+
+		void TransformFrames(std::uint32_t begin, std::uint32_t end,
+			const DirectX::XMMATRIX& world, const RigidTransforms* pPose);
+
+		// per frame in parent before child order, parents are positions in
+		// the same arrays or INVALID_INDEX for the frames at the top
+		std::vector<std::uint32_t> m_Parents;
+		std::vector<std::string> m_Names;
+		std::vector<DirectX::XMFLOAT4X4> m_Locals;
+		std::vector<std::uint32_t> m_Tracks;
+		std::vector<DirectX::XMFLOAT4X4> m_Worlds;
+
+		// position of every frame of the file
+		std::vector<std::uint32_t> m_Positions;
+
+		// frames above the subtrees, transformed before the tasks
+		std::uint32_t m_NumSharedFrames = 0;
+		std::vector<Task> m_Tasks;
+		std::uint32_t m_NumTracks = 0;
+	};
+}
@@ -0,0 +1,92 @@
+#include "stdafx.h"
+#include "SdkMeshLoader.h"
+
+#include <exception>
+
+SdkMeshLoader::SdkMeshLoader(std::uint32_t numThreads)
+	: m_Requests(numThreads, [this](Request& request) { LoadFile(request); })
+{
+}
+
+SdkMeshLoader::~SdkMeshLoader()
+{
+	Cancel();
+	m_Requests.Cancel();
+}
+
+void SdkMeshLoader::Load(const std::wstring& fileName)
+{
+	Request request;
+	request.FileName = fileName;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		request.Generation = m_Generation;
+		m_NumOutstanding++;
+	}
+	m_Requests.Push(request);
+}
+
+void SdkMeshLoader::Cancel()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Generation++;
+	m_Results.clear();
+	m_NumOutstanding = 0;
+}
+
+std::size_t SdkMeshLoader::Poll(std::vector<Result>& results)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	auto numResults = m_Results.size();
+	results.insert(results.end(), m_Results.begin(), m_Results.end());
+	m_Results.clear();
+	m_NumOutstanding -= static_cast<std::uint32_t>(numResults);
+
+	return numResults;
+}
+
+std::uint32_t SdkMeshLoader::GetNumOutstanding() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_NumOutstanding;
+}
+
+void SdkMeshLoader::LoadFile(const Request& request)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (request.Generation != m_Generation)
+		{
+			return;
+		}
+	}
+
+	Result result;
+	result.FileName = request.FileName;
+	result.WaitMilliseconds = request.Queued.GetMilliseconds();
+
+	// mapping only reads the size, validation faults in every page
+	try
+	{
+		CpuTimer timer;
+		std::shared_ptr<SdkMesh::File> pFile(new SdkMesh::File(request.FileName, false));
+		result.MapMilliseconds = timer.GetMilliseconds();
+
+		timer.Restart();
+		pFile->GetView().Validate();
+		result.ValidateMilliseconds = timer.GetMilliseconds();
+
+		result.pFile = pFile;
+	}
+	catch (const std::exception& e)
+	{
+		result.Error = e.what();
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (request.Generation == m_Generation)
+	{
+		m_Results.push_back(result);
+	}
+}
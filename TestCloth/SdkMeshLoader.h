@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Profiler.h"
+#include "SdkMeshView.h"
+#include "WorkQueue.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// SDKmesh files mapped and validated on a pool of I/O threads, so that many
+// files are read at once and none of them on the main thread. completed
+// files are queued until Poll(), typically called once a frame.
+class SdkMeshLoader
+{
+public:
+	struct Result
+	{
+		std::wstring FileName;
+
+		// validated file, null if loading failed
+		std::shared_ptr<SdkMesh::File> pFile;
+		std::string Error;
+
+		// time queued until a thread took the file, mapping it and reading
+		// it through validation
+		double WaitMilliseconds = 0.0;
+		double MapMilliseconds = 0.0;
+		double ValidateMilliseconds = 0.0;
+	};
+
+	// a few threads keep a disk busy, more mostly wait on it
+	static const std::uint32_t DEFAULT_NUM_THREADS = 4;
+
+	explicit SdkMeshLoader(std::uint32_t numThreads = DEFAULT_NUM_THREADS);
+	SdkMeshLoader(const SdkMeshLoader&) = delete;
+	SdkMeshLoader& operator=(const SdkMeshLoader&) = delete;
+
+	// files still queued are dropped, files being loaded are waited for
+	~SdkMeshLoader();
+
+	// queue a file, loaded in the order of the calls as threads become free
+	void Load(const std::wstring& fileName);
+
+	// forget the files queued so far. those still waiting are skipped, the
+	// results of those being loaded are dropped instead of polled.
+	void Cancel();
+
+	// append the results of the files completed since the last call,
+	// returns their number
+	std::size_t Poll(std::vector<Result>& results);
+
+	// files loaded or waiting to be polled
+	std::uint32_t GetNumOutstanding() const;
+	bool IsLoading() const { return GetNumOutstanding() > 0; }
+
+private:
+	struct Request
+	{
+		std::wstring FileName;
+		CpuTimer Queued;
+
+		// value of m_Generation when queued, stale after Cancel()
+		std::uint32_t Generation;
+	};
+
+	void LoadFile(const Request& request);
+
+	// guarded by m_Mutex
+	mutable std::mutex m_Mutex;
+	std::vector<Result> m_Results;
+	std::uint32_t m_NumOutstanding = 0;
+	std::uint32_t m_Generation = 0;
+
+	// last, so that the threads stop before the results go
+	WorkQueue<Request> m_Requests;
+};
@@ -0,0 +1,439 @@
+#include "SdkMeshView.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	using namespace SdkMesh;
+
+	// indices a subset draws, which have to stay below Bound
+	struct IndexRange
+	{
+		std::uint32_t Buffer;
+		std::uint64_t Start;
+		std::uint64_t End;
+		std::uint64_t Bound;
+
+		bool operator<(const IndexRange& other) const
+		{
+			return Buffer != other.Buffer ? Buffer < other.Buffer : Start < other.Start;
+		}
+	};
+
+	template <std::size_t N>
+	void CheckName(const char (&name)[N], const char* pElement)
+	{
+		if (std::find(name, name + N, '\0') == name + N)
+		{
+			throw std::runtime_error(std::string("SDKmesh ") + pElement + " name is not terminated");
+		}
+	}
+
+	// check the indices of the ranges of one buffer, sorted by start. every
+	// index is read once against the smallest bound of the ranges covering it,
+	// so that overlapping subsets cost no more than disjoint ones.
+	template <typename T>
+	void CheckIndices(Span<T> indices, const IndexRange* pRange, const IndexRange* pEnd)
+	{
+		// bounds and ends of the ranges covering the current index, smallest bound on top
+		typedef std::pair<std::uint64_t, std::uint64_t> Cover;
+		std::priority_queue<Cover, std::vector<Cover>, std::greater<Cover>> covers;
+
+		std::uint64_t i = 0;
+		for (;;)
+		{
+			if (covers.empty())
+			{
+				if (pRange == pEnd)
+				{
+					break;
+				}
+				i = std::max(i, pRange->Start);
+			}
+
+			for (; pRange != pEnd && pRange->Start <= i; pRange++)
+			{
+				if (pRange->End > i)
+				{
+					covers.push(Cover(pRange->Bound, pRange->End));
+				}
+			}
+
+			// ranges ended below the top are dropped once they come up
+			while (!covers.empty() && covers.top().second <= i)
+			{
+				covers.pop();
+			}
+			if (covers.empty())
+			{
+				continue;
+			}
+
+			// the smallest bound holds until its range ends or another one starts
+			auto bound = covers.top().first;
+			auto end = pRange != pEnd ? std::min(covers.top().second, pRange->Start) : covers.top().second;
+			for (; i < end; i++)
+			{
+				if (indices[static_cast<std::size_t>(i)] >= bound)
+				{
+					throw std::runtime_error("SDKmesh index exceeds the vertices of its subset");
+				}
+			}
+		}
+	}
+}
+
+namespace SdkMesh
+{
+	View::View(const void* pData, std::size_t size)
+		: m_pData(static_cast<const std::uint8_t*>(pData))
+		, m_Size(size)
+	{
+		if (size < sizeof(Header))
+		{
+			throw std::runtime_error("SDKmesh file is too small for its header");
+		}
+		if (!IsAligned<Header>(m_pData))
+		{
+			throw std::runtime_error("SDKmesh file is misaligned");
+		}
+		m_pHeader = reinterpret_cast<const Header*>(m_pData);
+
+		const auto& header = *m_pHeader;
+		if (header.Version != FILE_VERSION)
+		{
+			throw std::runtime_error("Unsupported SDKmesh version " + std::to_string(header.Version));
+		}
+		if (header.IsBigEndian)
+		{
+			throw std::runtime_error("Big endian SDKmesh files are not supported");
+		}
+
+		m_VertexBuffers = GetArray<VertexBufferHeader>(
+			header.VertexStreamHeadersOffset, header.NumVertexBuffers, "vertex buffer headers");
+		m_IndexBuffers = GetArray<IndexBufferHeader>(
+			header.IndexStreamHeadersOffset, header.NumIndexBuffers, "index buffer headers");
+		m_Meshes = GetArray<Mesh>(header.MeshDataOffset, header.NumMeshes, "meshes");
+		m_Subsets = GetArray<Subset>(header.SubsetDataOffset, header.NumTotalSubsets, "subsets");
+		m_Frames = GetArray<Frame>(header.FrameDataOffset, header.NumFrames, "frames");
+		m_Materials = GetArray<Material>(header.MaterialDataOffset, header.NumMaterials, "materials");
+	}
+
+	void View::Validate() const
+	{
+		const auto& header = *m_pHeader;
+		if (header.HeaderSize < sizeof(Header) || header.HeaderSize > m_Size ||
+			header.NonBufferDataSize > m_Size - header.HeaderSize ||
+			header.BufferDataSize > m_Size - header.HeaderSize - header.NonBufferDataSize)
+		{
+			throw std::runtime_error("SDKmesh data sizes exceed the file");
+		}
+
+		for (std::uint32_t i = 0; i < m_VertexBuffers.GetSize(); i++)
+		{
+			const auto& buffer = m_VertexBuffers[i];
+			GetVertexData(i);
+			if (buffer.NumVertices > 0 &&
+				(buffer.StrideBytes == 0 || buffer.NumVertices > buffer.SizeBytes / buffer.StrideBytes))
+			{
+				throw std::runtime_error("SDKmesh vertices exceed their buffer");
+			}
+
+			// the declaration ends with stream 0xff
+			for (const auto& element : buffer.Decl)
+			{
+				if (element.Stream == 0xff)
+				{
+					break;
+				}
+				if (element.Offset >= buffer.StrideBytes)
+				{
+					throw std::runtime_error("SDKmesh vertex element exceeds the stride");
+				}
+			}
+		}
+
+		for (std::uint32_t i = 0; i < m_IndexBuffers.GetSize(); i++)
+		{
+			const auto& buffer = m_IndexBuffers[i];
+			GetIndexData(i);
+			if (buffer.IndexType != INDEX_16BIT && buffer.IndexType != INDEX_32BIT)
+			{
+				throw std::runtime_error("Unknown SDKmesh index type");
+			}
+			std::uint64_t indexSize = buffer.IndexType == INDEX_16BIT ? 2 : 4;
+			if (buffer.NumIndices > buffer.SizeBytes / indexSize)
+			{
+				throw std::runtime_error("SDKmesh indices exceed their buffer");
+			}
+		}
+
+		// meshes walk their subset and frame influence arrays, which may not
+		// overlap, so that walking all of them is linear in the size of the file
+		std::vector<std::pair<std::uint64_t, std::uint64_t>> meshArrays;
+		for (const auto& mesh : m_Meshes)
+		{
+			if (mesh.NumSubsets > 0)
+			{
+				GetMeshSubsets(mesh);
+				meshArrays.push_back(std::make_pair(mesh.SubsetOffset,
+					mesh.SubsetOffset + mesh.NumSubsets * sizeof(std::uint32_t)));
+			}
+			if (mesh.NumFrameInfluences > 0)
+			{
+				GetFrameInfluences(mesh);
+				meshArrays.push_back(std::make_pair(mesh.FrameInfluenceOffset,
+					mesh.FrameInfluenceOffset + mesh.NumFrameInfluences * sizeof(std::uint32_t)));
+			}
+		}
+		std::sort(meshArrays.begin(), meshArrays.end());
+		for (std::size_t i = 1; i < meshArrays.size(); i++)
+		{
+			if (meshArrays[i].first < meshArrays[i - 1].second)
+			{
+				throw std::runtime_error("SDKmesh meshes share subset or frame influence arrays");
+			}
+		}
+
+		std::vector<IndexRange> indexRanges;
+		for (const auto& mesh : m_Meshes)
+		{
+			CheckName(mesh.Name, "mesh");
+			if (mesh.NumVertexBuffers > MAX_VERTEX_STREAMS)
+			{
+				throw std::runtime_error("Too many SDKmesh vertex streams");
+			}
+
+			// vertices every stream of the mesh has
+			std::uint64_t numVertices = mesh.NumVertexBuffers > 0 ? UINT64_MAX : 0;
+			for (std::uint32_t i = 0; i < mesh.NumVertexBuffers; i++)
+			{
+				if (mesh.VertexBuffers[i] >= m_VertexBuffers.GetSize())
+				{
+					throw std::runtime_error("SDKmesh vertex buffer index out of range");
+				}
+				numVertices = std::min(numVertices, m_VertexBuffers[mesh.VertexBuffers[i]].NumVertices);
+			}
+
+			auto subsets = GetMeshSubsets(mesh);
+			if (!subsets.IsEmpty() && mesh.IndexBuffer >= m_IndexBuffers.GetSize())
+			{
+				throw std::runtime_error("SDKmesh index buffer index out of range");
+			}
+
+			for (auto iSubset : subsets)
+			{
+				if (iSubset >= m_Subsets.GetSize())
+				{
+					throw std::runtime_error("SDKmesh subset index out of range");
+				}
+
+				const auto& subset = m_Subsets[iSubset];
+				if (subset.PrimitiveType > PRIMITIVE_TRIANGLE_PATCH_LIST)
+				{
+					throw std::runtime_error("Unknown SDKmesh primitive type");
+				}
+				if (subset.MaterialID >= m_Materials.GetSize())
+				{
+					throw std::runtime_error("SDKmesh material index out of range");
+				}
+				if (subset.IndexStart > m_IndexBuffers[mesh.IndexBuffer].NumIndices ||
+					subset.IndexCount > m_IndexBuffers[mesh.IndexBuffer].NumIndices - subset.IndexStart)
+				{
+					throw std::runtime_error("SDKmesh subset exceeds its indices");
+				}
+				if (subset.VertexStart > numVertices || subset.VertexCount > numVertices - subset.VertexStart)
+				{
+					throw std::runtime_error("SDKmesh subset exceeds its vertices");
+				}
+
+				// indices are relative to the first vertex of the subset
+				IndexRange range = { mesh.IndexBuffer, subset.IndexStart,
+					subset.IndexStart + subset.IndexCount, numVertices - subset.VertexStart };
+				indexRanges.push_back(range);
+			}
+
+			for (auto iFrame : GetFrameInfluences(mesh))
+			{
+				if (iFrame >= m_Frames.GetSize())
+				{
+					throw std::runtime_error("SDKmesh frame influence out of range");
+				}
+			}
+		}
+
+		for (const auto& subset : m_Subsets)
+		{
+			CheckName(subset.Name, "subset");
+		}
+
+		std::sort(indexRanges.begin(), indexRanges.end());
+		for (auto pRange = indexRanges.data(), pEnd = pRange + indexRanges.size(); pRange != pEnd;)
+		{
+			auto pBufferEnd = pRange;
+			while (pBufferEnd != pEnd && pBufferEnd->Buffer == pRange->Buffer)
+			{
+				pBufferEnd++;
+			}
+
+			if (m_IndexBuffers[pRange->Buffer].IndexType == INDEX_16BIT)
+			{
+				CheckIndices(GetIndices16(pRange->Buffer), pRange, pBufferEnd);
+			}
+			else
+			{
+				CheckIndices(GetIndices32(pRange->Buffer), pRange, pBufferEnd);
+			}
+			pRange = pBufferEnd;
+		}
+
+		// a frame is the child or the next sibling of one frame at most
+		std::vector<std::uint8_t> linked(m_Frames.GetSize(), 0);
+		for (const auto& frame : m_Frames)
+		{
+			CheckName(frame.Name, "frame");
+			if (frame.Mesh != INVALID_INDEX && frame.Mesh >= m_Meshes.GetSize())
+			{
+				throw std::runtime_error("SDKmesh frame mesh out of range");
+			}
+
+			for (auto iLinked : { frame.ParentFrame, frame.ChildFrame, frame.SiblingFrame })
+			{
+				if (iLinked != INVALID_INDEX && iLinked >= m_Frames.GetSize())
+				{
+					throw std::runtime_error("SDKmesh frame index out of range");
+				}
+			}
+			for (auto iLinked : { frame.ChildFrame, frame.SiblingFrame })
+			{
+				if (iLinked != INVALID_INDEX && linked[iLinked]++)
+				{
+					throw std::runtime_error("SDKmesh frame is linked more than once");
+				}
+			}
+		}
+
+		// frames not reached from an unlinked one are on a cycle
+		std::vector<std::uint32_t> pending;
+		std::size_t numReached = 0;
+		for (std::uint32_t i = 0; i < m_Frames.GetSize(); i++)
+		{
+			if (linked[i])
+			{
+				continue;
+			}
+
+			pending.push_back(i);
+			while (!pending.empty())
+			{
+				const auto& frame = m_Frames[pending.back()];
+				pending.pop_back();
+				numReached++;
+				if (frame.ChildFrame != INVALID_INDEX)
+				{
+					pending.push_back(frame.ChildFrame);
+				}
+				if (frame.SiblingFrame != INVALID_INDEX)
+				{
+					pending.push_back(frame.SiblingFrame);
+				}
+			}
+		}
+		if (numReached != m_Frames.GetSize())
+		{
+			throw std::runtime_error("SDKmesh frames form a cycle");
+		}
+
+		for (const auto& material : m_Materials)
+		{
+			CheckName(material.Name, "material");
+			CheckName(material.MaterialInstancePath, "material instance");
+			CheckName(material.DiffuseTexture, "diffuse texture");
+			CheckName(material.NormalTexture, "normal texture");
+			CheckName(material.SpecularTexture, "specular texture");
+		}
+	}
+
+	Span<std::uint32_t> View::GetMeshSubsets(const Mesh& mesh) const
+	{
+		return GetArray<std::uint32_t>(mesh.SubsetOffset, mesh.NumSubsets, "mesh subsets");
+	}
+
+	Span<std::uint32_t> View::GetFrameInfluences(const Mesh& mesh) const
+	{
+		return GetArray<std::uint32_t>(mesh.FrameInfluenceOffset, mesh.NumFrameInfluences, "frame influences");
+	}
+
+	Span<std::uint8_t> View::GetVertexData(std::uint32_t iBuffer) const
+	{
+		if (iBuffer >= m_VertexBuffers.GetSize())
+		{
+			throw std::runtime_error("SDKmesh vertex buffer index out of range");
+		}
+		const auto& buffer = m_VertexBuffers[iBuffer];
+		return GetArray<std::uint8_t>(buffer.DataOffset, buffer.SizeBytes, "vertex data");
+	}
+
+	Span<std::uint8_t> View::GetIndexData(std::uint32_t iBuffer) const
+	{
+		if (iBuffer >= m_IndexBuffers.GetSize())
+		{
+			throw std::runtime_error("SDKmesh index buffer index out of range");
+		}
+		const auto& buffer = m_IndexBuffers[iBuffer];
+		return GetArray<std::uint8_t>(buffer.DataOffset, buffer.SizeBytes, "index data");
+	}
+
+	Span<std::uint16_t> View::GetIndices16(std::uint32_t iBuffer) const
+	{
+		auto data = GetIndexData(iBuffer);
+		if (m_IndexBuffers[iBuffer].IndexType != INDEX_16BIT)
+		{
+			return Span<std::uint16_t>();
+		}
+		return GetArray<std::uint16_t>(m_IndexBuffers[iBuffer].DataOffset,
+			data.GetSize() / sizeof(std::uint16_t), "indices");
+	}
+
+	Span<std::uint32_t> View::GetIndices32(std::uint32_t iBuffer) const
+	{
+		auto data = GetIndexData(iBuffer);
+		if (m_IndexBuffers[iBuffer].IndexType != INDEX_32BIT)
+		{
+			return Span<std::uint32_t>();
+		}
+		return GetArray<std::uint32_t>(m_IndexBuffers[iBuffer].DataOffset,
+			data.GetSize() / sizeof(std::uint32_t), "indices");
+	}
+
+	template <typename T>
+	Span<T> View::GetArray(std::uint64_t offset, std::uint64_t count, const char* pName) const
+	{
+		// written not to overflow on offsets and counts of any value
+		if (offset > m_Size || count > (m_Size - offset) / sizeof(T))
+		{
+			throw std::runtime_error(std::string("SDKmesh ") + pName + " exceed the file");
+		}
+		if (!IsAligned<T>(m_pData + offset))
+		{
+			throw std::runtime_error(std::string("SDKmesh ") + pName + " are misaligned");
+		}
+		return Span<T>(reinterpret_cast<const T*>(m_pData + offset), static_cast<std::size_t>(count));
+	}
+
+	File::File(const std::wstring& fileName, bool validate)
+		: m_File(fileName)
+		, m_View(m_File.GetData(), m_File.GetSize())
+	{
+		if (validate)
+		{
+			m_View.Validate();
+		}
+	}
+}
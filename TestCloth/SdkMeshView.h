@@ -0,0 +1,263 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+// .sdkmesh files read in place, without a device. the layout is the one of
+// DXUT's Optional/SDKmesh.h, declared again without Direct3D types so that
+// tools outside Windows can read the files too.
+namespace SdkMesh
+{
+	const std::uint32_t FILE_VERSION = 101;
+	const std::uint32_t MAX_VERTEX_ELEMENTS = 32;
+	const std::uint32_t MAX_VERTEX_STREAMS = 16;
+	const std::uint32_t MAX_NAME = 100;
+	const std::uint32_t MAX_PATH_NAME = 260;
+	const std::uint32_t INVALID_INDEX = 0xffffffff;
+
+	enum IndexType
+	{
+		INDEX_16BIT = 0,
+		INDEX_32BIT,
+	};
+
+	enum PrimitiveType
+	{
+		PRIMITIVE_TRIANGLE_LIST = 0,
+		PRIMITIVE_TRIANGLE_STRIP,
+		PRIMITIVE_LINE_LIST,
+		PRIMITIVE_LINE_STRIP,
+		PRIMITIVE_POINT_LIST,
+		PRIMITIVE_TRIANGLE_LIST_ADJ,
+		PRIMITIVE_TRIANGLE_STRIP_ADJ,
+		PRIMITIVE_LINE_LIST_ADJ,
+		PRIMITIVE_LINE_STRIP_ADJ,
+		PRIMITIVE_QUAD_PATCH_LIST,
+		PRIMITIVE_TRIANGLE_PATCH_LIST,
+	};
+
+	// offsets are from the start of the file, pointers of DXUT's unions are
+	// never stored
+#pragma pack(push, 8)
+
+	struct Header
+	{
+		std::uint32_t Version;
+		std::uint8_t IsBigEndian;
+		std::uint64_t HeaderSize;
+		std::uint64_t NonBufferDataSize;
+		std::uint64_t BufferDataSize;
+
+		std::uint32_t NumVertexBuffers;
+		std::uint32_t NumIndexBuffers;
+		std::uint32_t NumMeshes;
+		std::uint32_t NumTotalSubsets;
+		std::uint32_t NumFrames;
+		std::uint32_t NumMaterials;
+
+		std::uint64_t VertexStreamHeadersOffset;
+		std::uint64_t IndexStreamHeadersOffset;
+		std::uint64_t MeshDataOffset;
+		std::uint64_t SubsetDataOffset;
+		std::uint64_t FrameDataOffset;
+		std::uint64_t MaterialDataOffset;
+	};
+
+	// D3DVERTEXELEMENT9
+	struct VertexElement
+	{
+		std::uint16_t Stream;
+		std::uint16_t Offset;
+		std::uint8_t Type;
+		std::uint8_t Method;
+		std::uint8_t Usage;
+		std::uint8_t UsageIndex;
+	};
+
+	struct VertexBufferHeader
+	{
+		std::uint64_t NumVertices;
+		std::uint64_t SizeBytes;
+		std::uint64_t StrideBytes;
+		VertexElement Decl[MAX_VERTEX_ELEMENTS];
+		std::uint64_t DataOffset;
+	};
+
+	struct IndexBufferHeader
+	{
+		std::uint64_t NumIndices;
+		std::uint64_t SizeBytes;
+		std::uint32_t IndexType;
+		std::uint64_t DataOffset;
+	};
+
+	struct Mesh
+	{
+		char Name[MAX_NAME];
+		std::uint8_t NumVertexBuffers;
+		std::uint32_t VertexBuffers[MAX_VERTEX_STREAMS];
+		std::uint32_t IndexBuffer;
+		std::uint32_t NumSubsets;
+		std::uint32_t NumFrameInfluences;
+
+		DirectX::XMFLOAT3 BoundingBoxCenter;
+		DirectX::XMFLOAT3 BoundingBoxExtents;
+
+		std::uint64_t SubsetOffset;
+		std::uint64_t FrameInfluenceOffset;
+	};
+
+	struct Subset
+	{
+		char Name[MAX_NAME];
+		std::uint32_t MaterialID;
+		std::uint32_t PrimitiveType;
+		std::uint64_t IndexStart;
+		std::uint64_t IndexCount;
+		std::uint64_t VertexStart;
+		std::uint64_t VertexCount;
+	};
+
+	struct Frame
+	{
+		char Name[MAX_NAME];
+		std::uint32_t Mesh;
+		std::uint32_t ParentFrame;
+		std::uint32_t ChildFrame;
+		std::uint32_t SiblingFrame;
+		DirectX::XMFLOAT4X4 Matrix;
+		std::uint32_t AnimationDataIndex;
+	};
+
+	struct Material
+	{
+		char Name[MAX_NAME];
+		char MaterialInstancePath[MAX_PATH_NAME];
+		char DiffuseTexture[MAX_PATH_NAME];
+		char NormalTexture[MAX_PATH_NAME];
+		char SpecularTexture[MAX_PATH_NAME];
+
+		DirectX::XMFLOAT4 Diffuse;
+		DirectX::XMFLOAT4 Ambient;
+		DirectX::XMFLOAT4 Specular;
+		DirectX::XMFLOAT4 Emissive;
+		float Power;
+
+		// textures and views created by DXUT
+		std::uint64_t Resources[6];
+	};
+
+#pragma pack(pop)
+
+	static_assert(sizeof(Header) == 104, "SDKmesh header size mismatch");
+	static_assert(sizeof(VertexBufferHeader) == 288, "SDKmesh vertex buffer header size mismatch");
+	static_assert(sizeof(IndexBufferHeader) == 32, "SDKmesh index buffer header size mismatch");
+	static_assert(sizeof(Mesh) == 224, "SDKmesh mesh size mismatch");
+	static_assert(sizeof(Subset) == 144, "SDKmesh subset size mismatch");
+	static_assert(sizeof(Frame) == 184, "SDKmesh frame size mismatch");
+	static_assert(sizeof(Material) == 1256, "SDKmesh material size mismatch");
+
+	// whether data at p can be read as a T, the arrays of the structures
+	// above are only as aligned as the file puts them
+	template <typename T>
+	bool IsAligned(const void* p)
+	{
+		return reinterpret_cast<std::uintptr_t>(p) % std::alignment_of<T>::value == 0;
+	}
+
+	// elements of an array within the file
+	template <typename T>
+	class Span
+	{
+	public:
+		Span() = default;
+		Span(const T* pData, std::size_t size) : m_pData(pData), m_Size(size) {}
+
+		const T* GetData() const { return m_pData; }
+		std::size_t GetSize() const { return m_Size; }
+		bool IsEmpty() const { return m_Size == 0; }
+
+		const T& operator[](std::size_t i) const { return m_pData[i]; }
+		const T* begin() const { return m_pData; }
+		const T* end() const { return m_pData + m_Size; }
+
+	private:
+		const T* m_pData = nullptr;
+		std::size_t m_Size = 0;
+	};
+
+	// meshes of a file in memory, which has to outlive the view. nothing is
+	// copied: only the header and the ranges of its arrays are checked on
+	// construction, data referenced by the elements is checked as it is
+	// accessed. errors throw std::runtime_error.
+	class View
+	{
+	public:
+		View(const void* pData, std::size_t size);
+
+		// check every offset, count and index in time linear in the size of
+		// the file. once it returns, everything the elements reference lies
+		// within the file, indices of buffers, meshes, subsets, frames,
+		// materials and vertices are in range, names are terminated and the
+		// child and sibling links of the frames form a forest.
+		void Validate() const;
+
+		const Header& GetHeader() const { return *m_pHeader; }
+
+		Span<VertexBufferHeader> GetVertexBuffers() const { return m_VertexBuffers; }
+		Span<IndexBufferHeader> GetIndexBuffers() const { return m_IndexBuffers; }
+		Span<Mesh> GetMeshes() const { return m_Meshes; }
+		Span<Subset> GetSubsets() const { return m_Subsets; }
+		Span<Frame> GetFrames() const { return m_Frames; }
+		Span<Material> GetMaterials() const { return m_Materials; }
+
+		// indices into GetSubsets() and GetFrames()
+		Span<std::uint32_t> GetMeshSubsets(const Mesh& mesh) const;
+		Span<std::uint32_t> GetFrameInfluences(const Mesh& mesh) const;
+
+		// bytes of a buffer
+		Span<std::uint8_t> GetVertexData(std::uint32_t iBuffer) const;
+		Span<std::uint8_t> GetIndexData(std::uint32_t iBuffer) const;
+
+		// indices of a buffer of the given type, empty for the other type
+		Span<std::uint16_t> GetIndices16(std::uint32_t iBuffer) const;
+		Span<std::uint32_t> GetIndices32(std::uint32_t iBuffer) const;
+
+	private:
+		// array of count elements at offset, throws if it leaves the file
+		template <typename T>
+		Span<T> GetArray(std::uint64_t offset, std::uint64_t count, const char* pName) const;
+
+		const std::uint8_t* m_pData;
+		std::size_t m_Size;
+
+		const Header* m_pHeader;
+		Span<VertexBufferHeader> m_VertexBuffers;
+		Span<IndexBufferHeader> m_IndexBuffers;
+		Span<Mesh> m_Meshes;
+		Span<Subset> m_Subsets;
+		Span<Frame> m_Frames;
+		Span<Material> m_Materials;
+	};
+
+	// mapped file viewed as meshes, paged in as the data is touched.
+	// validation reads the whole file, but never lets a malformed one through.
+	class File
+	{
+	public:
+		explicit File(const std::wstring& fileName, bool validate = true);
+
+		const View& GetView() const { return m_View; }
+		std::size_t GetSize() const { return m_File.GetSize(); }
+
+	private:
+		MappedFile m_File;
+		View m_View;
+	};
+}
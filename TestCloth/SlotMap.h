@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// handle to a value in a SlotMap. it stays valid until the value is erased;
+// stale handles are detected by comparing generations, even after reuse.
+struct SlotHandle
+{
+	std::uint32_t Index = 0xffffffff;
+	std::uint32_t Generation = 0;
+
+	bool operator==(const SlotHandle& other) const
+	{
+		return Index == other.Index && Generation == other.Generation;
+	}
+
+	bool operator!=(const SlotHandle& other) const
+	{
+		return !(*this == other);
+	}
+};
+
+// values stored contiguously and addressed by generational handles,
+// iterated in the order they were inserted. insertion and erasure are
+// amortized O(1): erasure leaves a tombstone, and the tombstones are
+// compacted in one pass keeping the order, before the next iteration or
+// once they are half of the values. T must be default constructible.
+template <typename T>
+class SlotMap
+{
+public:
+	static const std::uint32_t INVALID_INDEX = 0xffffffff;
+
+	typedef SlotHandle Handle;
+
+	typedef typename std::vector<T>::iterator iterator;
+	typedef typename std::vector<T>::const_iterator const_iterator;
+
+	Handle Insert(T value)
+	{
+		std::uint32_t iSlot;
+		if (m_FreeHead != INVALID_INDEX)
+		{
+			iSlot = m_FreeHead;
+			m_FreeHead = m_Slots[iSlot].DenseIndex;
+		}
+		else
+		{
+			iSlot = static_cast<std::uint32_t>(m_Slots.size());
+			m_Slots.push_back(Slot());
+		}
+
+		auto& slot = m_Slots[iSlot];
+		slot.DenseIndex = static_cast<std::uint32_t>(m_Values.size());
+
+		m_Values.push_back(std::move(value));
+		m_DenseToSlot.push_back(iSlot);
+
+		Handle handle;
+		handle.Index = iSlot;
+		handle.Generation = slot.Generation;
+		return handle;
+	}
+
+	// returns false if the handle is stale
+	bool Erase(Handle handle)
+	{
+		if (!Contains(handle))
+		{
+			return false;
+		}
+
+		// release the value now, its place is compacted later
+		auto& slot = m_Slots[handle.Index];
+		m_Values[slot.DenseIndex] = T();
+		m_DenseToSlot[slot.DenseIndex] = INVALID_INDEX;
+		m_NumErased++;
+
+		// invalidate outstanding handles (free slots never match a live generation)
+		// and push the slot onto the free list
+		slot.Generation++;
+		slot.DenseIndex = m_FreeHead;
+		m_FreeHead = handle.Index;
+
+		if (m_NumErased * 2 > m_Values.size())
+		{
+			Compact();
+		}
+		return true;
+	}
+
+	bool Contains(Handle handle) const
+	{
+		return handle.Index < m_Slots.size() &&
+			m_Slots[handle.Index].Generation == handle.Generation;
+	}
+
+	// returns nullptr if the handle is stale
+	T* Find(Handle handle)
+	{
+		return Contains(handle) ? &m_Values[m_Slots[handle.Index].DenseIndex] : nullptr;
+	}
+
+	const T* Find(Handle handle) const
+	{
+		return Contains(handle) ? &m_Values[m_Slots[handle.Index].DenseIndex] : nullptr;
+	}
+
+	void Clear()
+	{
+		for (std::uint32_t iDense = 0; iDense < m_DenseToSlot.size(); iDense++)
+		{
+			auto iSlot = m_DenseToSlot[iDense];
+			if (iSlot == INVALID_INDEX)
+			{
+				continue;
+			}
+			m_Slots[iSlot].Generation++;
+			m_Slots[iSlot].DenseIndex = m_FreeHead;
+			m_FreeHead = iSlot;
+		}
+		m_Values.clear();
+		m_DenseToSlot.clear();
+		m_NumErased = 0;
+	}
+
+	void Reserve(std::size_t capacity)
+	{
+		m_Values.reserve(capacity);
+		m_DenseToSlot.reserve(capacity);
+		m_Slots.reserve(capacity);
+	}
+
+	std::size_t Size() const { return m_Values.size() - m_NumErased; }
+	bool Empty() const { return Size() == 0; }
+
+	// iteration compacts the tombstones first, so a const SlotMap must not
+	// be iterated on several threads at once after an erasure
+	iterator begin() { Compact(); return m_Values.begin(); }
+	iterator end() { Compact(); return m_Values.end(); }
+	const_iterator begin() const { Compact(); return m_Values.begin(); }
+	const_iterator end() const { Compact(); return m_Values.end(); }
+
+private:
+	// move the values after tombstones down, keeping their order
+	void Compact() const
+	{
+		if (m_NumErased == 0)
+		{
+			return;
+		}
+
+		std::uint32_t iTo = 0;
+		for (std::uint32_t iFrom = 0; iFrom < m_DenseToSlot.size(); iFrom++)
+		{
+			auto iSlot = m_DenseToSlot[iFrom];
+			if (iSlot == INVALID_INDEX)
+			{
+				continue;
+			}
+			if (iTo != iFrom)
+			{
+				m_Values[iTo] = std::move(m_Values[iFrom]);
+				m_DenseToSlot[iTo] = iSlot;
+				m_Slots[iSlot].DenseIndex = iTo;
+			}
+			iTo++;
+		}
+		m_Values.erase(m_Values.begin() + iTo, m_Values.end());
+		m_DenseToSlot.resize(iTo);
+		m_NumErased = 0;
+	}
+
+	struct Slot
+	{
+		// index into m_Values while used, next free slot while free
+		std::uint32_t DenseIndex = INVALID_INDEX;
+		std::uint32_t Generation = 0;
+	};
+
+	// values in the order of insertion, with tombstones where
+	// m_DenseToSlot is INVALID_INDEX until they are compacted
+	mutable std::vector<T> m_Values;
+	mutable std::vector<std::uint32_t> m_DenseToSlot;
+	mutable std::vector<Slot> m_Slots;
+	mutable std::size_t m_NumErased = 0;
+	std::uint32_t m_FreeHead = INVALID_INDEX;
+};
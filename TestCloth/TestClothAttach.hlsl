@@ -0,0 +1,38 @@
+struct PinnedParticle
+{
+	uint id;
+	uint attachment;
+	uint2 dummy;
+	float4 localPosition;
+};
+
+StructuredBuffer<PinnedParticle> PinnedParticles : register(t0);
+StructuredBuffer<float4x4> AttachmentTransforms : register(t1);
+StructuredBuffer<float4> PositionsFrom : register(t2);
+RWStructuredBuffer<float4> PositionsTo : register(u0);
+RWStructuredBuffer<float4> VelocitiesTo : register(u1);
+
+cbuffer cbTestClothAttach
+{
+	uint NumPinnedParticles;
+	float TimeStep;
+};
+
+// overwrites the integrated state of pinned particles only,
+// so that the update shader does not have to care about them
+[numthreads(64, 1, 1)]
+void main(uint3 threadID : SV_DispatchThreadID)
+{
+	if (threadID.x >= NumPinnedParticles)
+	{
+		return;
+	}
+
+	PinnedParticle pinned = PinnedParticles[threadID.x];
+	float4 target = mul(pinned.localPosition,
+		AttachmentTransforms[pinned.attachment]);
+
+	VelocitiesTo[pinned.id] = float4(
+		(target.xyz - PositionsFrom[pinned.id].xyz) / TimeStep, 0.0f);
+	PositionsTo[pinned.id] = target;
+}
@@ -0,0 +1,51 @@
+#include "TestClothSolver.hlsli"
+
+#define NUM_THREADS 256
+
+StructuredBuffer<float4> Positions : register(t0);
+
+// minimum xyz followed by bitwise inverted maximum xyz, as ordered uints.
+// cleared to 0xffffffff, so that InterlockedMin reduces both.
+RWByteAddressBuffer Bounds : register(u0);
+
+groupshared float3 MinPositions[NUM_THREADS];
+groupshared float3 MaxPositions[NUM_THREADS];
+
+// map floats to uints of the same order, so that atomics can compare them
+uint ToOrderedUint(float value)
+{
+	uint bits = asuint(value);
+	return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+}
+
+// reduce the particle positions to an axis-aligned bounding box
+[numthreads(NUM_THREADS, 1, 1)]
+void main(uint3 threadID : SV_DispatchThreadID, uint index : SV_GroupIndex)
+{
+	uint numParticles = ClothResolution.x * ClothResolution.y;
+	float3 position = Positions[min(threadID.x, numParticles - 1)].xyz;
+	MinPositions[index] = position;
+	MaxPositions[index] = position;
+	GroupMemoryBarrierWithGroupSync();
+
+	[unroll]
+	for (uint stride = NUM_THREADS / 2; stride > 0; stride >>= 1)
+	{
+		if (index < stride)
+		{
+			MinPositions[index] = min(MinPositions[index], MinPositions[index + stride]);
+			MaxPositions[index] = max(MaxPositions[index], MaxPositions[index + stride]);
+		}
+		GroupMemoryBarrierWithGroupSync();
+	}
+
+	if (index == 0)
+	{
+		Bounds.InterlockedMin(0, ToOrderedUint(MinPositions[0].x));
+		Bounds.InterlockedMin(4, ToOrderedUint(MinPositions[0].y));
+		Bounds.InterlockedMin(8, ToOrderedUint(MinPositions[0].z));
+		Bounds.InterlockedMin(12, ~ToOrderedUint(MaxPositions[0].x));
+		Bounds.InterlockedMin(16, ~ToOrderedUint(MaxPositions[0].y));
+		Bounds.InterlockedMin(20, ~ToOrderedUint(MaxPositions[0].z));
+	}
+}
@@ -0,0 +1,691 @@
+#include "stdafx.h"
+#include "TestClothCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+	const std::uint32_t QUANTIZATION_LEVELS = 0xffff;
+
+	// residuals sharing a Rice parameter
+	const std::uint32_t BLOCK_SIZE = 64;
+
+	// quotients from here on are escaped, the value follows in ESCAPE_BITS
+	const std::uint32_t ESCAPE_QUOTIENT = 24;
+	const std::uint32_t ESCAPE_BITS = 17;
+
+	// appends bits from the least significant end
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<std::uint8_t>& bytes)
+			: m_Bytes(bytes)
+		{
+		}
+
+		// numBits up to 32
+		void Write(std::uint32_t bits, std::uint32_t numBits)
+		{
+			m_Buffer |= static_cast<std::uint64_t>(bits) << m_NumBits;
+			m_NumBits += numBits;
+			while (m_NumBits >= 8)
+			{
+				m_Bytes.push_back(static_cast<std::uint8_t>(m_Buffer));
+				m_Buffer >>= 8;
+				m_NumBits -= 8;
+			}
+		}
+
+		void Flush()
+		{
+			if (m_NumBits > 0)
+			{
+				m_Bytes.push_back(static_cast<std::uint8_t>(m_Buffer));
+			}
+			m_Buffer = 0;
+			m_NumBits = 0;
+		}
+
+	private:
+		std::vector<std::uint8_t>& m_Bytes;
+		std::uint64_t m_Buffer = 0;
+		std::uint32_t m_NumBits = 0;
+	};
+
+	std::uint32_t ZigZag(std::int32_t value)
+	{
+		return (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+	}
+
+	// Rice parameter close to log2 of the mean of the block
+	std::uint32_t ChooseRiceParameter(const std::uint32_t* pValues, std::uint32_t numValues)
+	{
+		std::uint64_t sum = 0;
+		for (std::uint32_t i = 0; i < numValues; i++)
+		{
+			sum += pValues[i];
+		}
+
+		std::uint32_t k = 0;
+		while (k < ESCAPE_BITS && (static_cast<std::uint64_t>(numValues) << (k + 1)) <= sum)
+		{
+			k++;
+		}
+		return k;
+	}
+
+	// residuals in blocks: a 5 bit parameter k, then every value as its
+	// quotient by 2^k in unary (ones terminated by a zero) and k low bits
+	void WriteRice(BitWriter& writer, const std::vector<std::uint32_t>& values)
+	{
+		for (std::size_t begin = 0; begin < values.size(); begin += BLOCK_SIZE)
+		{
+			auto numValues = static_cast<std::uint32_t>(
+				std::min<std::size_t>(BLOCK_SIZE, values.size() - begin));
+			auto k = ChooseRiceParameter(&values[begin], numValues);
+			writer.Write(k, 5);
+
+			for (std::uint32_t i = 0; i < numValues; i++)
+			{
+				auto value = values[begin + i];
+				auto quotient = value >> k;
+				if (quotient < ESCAPE_QUOTIENT)
+				{
+					writer.Write((1u << quotient) - 1, quotient + 1);
+					writer.Write(value & ((1u << k) - 1), k);
+				}
+				else
+				{
+					writer.Write((1u << ESCAPE_QUOTIENT) - 1, ESCAPE_QUOTIENT);
+					writer.Write(value, ESCAPE_BITS);
+				}
+			}
+		}
+	}
+
+	// reads bits from the least significant end, see BitWriter
+	class BitReader
+	{
+	public:
+		BitReader(const std::uint8_t* pBytes, std::size_t size)
+			: m_pBytes(pBytes)
+			, m_Size(size)
+		{
+		}
+
+		// numBits up to 32
+		std::uint32_t Read(std::uint32_t numBits)
+		{
+			while (m_NumBits < numBits)
+			{
+				if (m_Position == m_Size)
+				{
+					throw std::runtime_error("Cache frame is truncated");
+				}
+				m_Buffer |= static_cast<std::uint64_t>(m_pBytes[m_Position++]) << m_NumBits;
+				m_NumBits += 8;
+			}
+
+			auto bits = static_cast<std::uint32_t>(m_Buffer & ((1ull << numBits) - 1));
+			m_Buffer >>= numBits;
+			m_NumBits -= numBits;
+			return bits;
+		}
+
+		// ones up to the next zero, which is consumed, or maxOnes ones
+		std::uint32_t ReadUnary(std::uint32_t maxOnes)
+		{
+			std::uint32_t numOnes = 0;
+			while (numOnes < maxOnes && Read(1))
+			{
+				numOnes++;
+			}
+			return numOnes;
+		}
+
+	private:
+		const std::uint8_t* m_pBytes;
+		std::size_t m_Size;
+		std::size_t m_Position = 0;
+		std::uint64_t m_Buffer = 0;
+		std::uint32_t m_NumBits = 0;
+	};
+
+	std::int32_t UnZigZag(std::uint32_t value)
+	{
+		return static_cast<std::int32_t>(value >> 1) ^ -static_cast<std::int32_t>(value & 1);
+	}
+
+	// decodes the residuals written by WriteRice()
+	void ReadRice(BitReader& reader, std::vector<std::uint32_t>& values)
+	{
+		for (std::size_t begin = 0; begin < values.size(); begin += BLOCK_SIZE)
+		{
+			auto end = std::min<std::size_t>(begin + BLOCK_SIZE, values.size());
+			auto k = reader.Read(5);
+			if (k > ESCAPE_BITS)
+			{
+				throw std::runtime_error("Cache frame is corrupt");
+			}
+
+			for (auto i = begin; i < end; i++)
+			{
+				auto quotient = reader.ReadUnary(ESCAPE_QUOTIENT);
+				values[i] = quotient < ESCAPE_QUOTIENT ?
+					(quotient << k) | reader.Read(k) : reader.Read(ESCAPE_BITS);
+			}
+		}
+	}
+
+	// quantization of one axis within the bounding box of a frame
+	struct Quantizer
+	{
+		Quantizer(float min, float max)
+			: Min(min)
+			, Scale(max > min ? QUANTIZATION_LEVELS / (max - min) : 0.0f)
+			, Step(max > min ? (max - min) / QUANTIZATION_LEVELS : 0.0f)
+		{
+		}
+
+		std::int32_t Quantize(float value) const
+		{
+			auto quantized = static_cast<std::int32_t>(std::floor((value - Min) * Scale + 0.5f));
+			return std::min(std::max(quantized, 0), static_cast<std::int32_t>(QUANTIZATION_LEVELS));
+		}
+
+		float Dequantize(std::int32_t quantized) const
+		{
+			return Min + quantized * Step;
+		}
+
+		float Min;
+		float Scale;
+		float Step;
+	};
+
+	float GetAxis(const DirectX::XMFLOAT4& position, int axis)
+	{
+		return (&position.x)[axis];
+	}
+
+	// prediction of frames after a key frame from the reconstructed frames
+	// before, shared by writer and reader so that both round alike
+	std::int32_t PredictFromPrevious(const Quantizer& quantizer,
+		float previous, float beforePrevious, std::uint32_t framesSinceKey)
+	{
+		if (framesSinceKey > 1)
+		{
+			previous += previous - beforePrevious;
+		}
+		return quantizer.Quantize(previous);
+	}
+
+	// parallelogram prediction from the particles before in the grid
+	std::int32_t PredictFromNeighbours(const std::int32_t* pQuantized,
+		std::uint32_t id, std::uint32_t resolution)
+	{
+		auto x = id % resolution;
+		auto y = id / resolution;
+		if (y == 0)
+		{
+			return x == 0 ? 0 : pQuantized[id - 1];
+		}
+		if (x == 0)
+		{
+			return pQuantized[id - resolution];
+		}
+
+		auto predicted = pQuantized[id - 1] + pQuantized[id - resolution] -
+			pQuantized[id - resolution - 1];
+		return std::min(std::max(predicted, 0), static_cast<std::int32_t>(QUANTIZATION_LEVELS));
+	}
+}
+
+namespace TestCloth
+{
+	CacheWriter::CacheWriter(const std::wstring& fileName, std::uint32_t resolution,
+		std::uint32_t keyframeInterval, std::uint32_t numBuffers)
+		: m_File(fileName, std::ios::binary | std::ios::trunc)
+		, m_Resolution(resolution)
+		, m_NumParticles(resolution * resolution)
+		, m_KeyframeInterval(std::max(keyframeInterval, 1u))
+		, m_Previous(resolution * resolution)
+		, m_BeforePrevious(resolution * resolution)
+		, m_RawBytes(0)
+		, m_WrittenBytes(0)
+		, m_Queue(numBuffers, Frame(resolution * resolution), [this](Frame& frame) { WriteFrame(frame); })
+	{
+		if (!m_File)
+		{
+			throw std::runtime_error("Failed to create cache file");
+		}
+
+		CacheHeader header;
+		header.Magic = CACHE_MAGIC;
+		header.Version = CACHE_VERSION;
+		header.Resolution = resolution;
+		header.KeyframeInterval = m_KeyframeInterval;
+		m_File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		m_Offset = sizeof(header);
+	}
+
+	CacheWriter::~CacheWriter()
+	{
+		try
+		{
+			Close();
+		}
+		catch (const std::exception&)
+		{
+		}
+	}
+
+	bool CacheWriter::AddFrame(std::uint64_t step, const DirectX::XMFLOAT4* pPositions)
+	{
+		auto pFrame = m_Queue.Acquire();
+		if (!pFrame)
+		{
+			return false;
+		}
+
+		pFrame->Step = step;
+		std::copy(pPositions, pPositions + m_NumParticles, pFrame->Positions.begin());
+		m_Queue.Push(pFrame);
+
+		return true;
+	}
+
+	void CacheWriter::DropFrame()
+	{
+		m_Queue.Drop();
+	}
+
+	void CacheWriter::Close()
+	{
+		// a file without the index is not read back, whatever failed
+		try
+		{
+			m_Queue.Close();
+		}
+		catch (...)
+		{
+			m_File.close();
+			throw;
+		}
+
+		// the index is written once, after the last frame
+		if (!m_File.is_open())
+		{
+			return;
+		}
+
+		CacheFooter footer;
+		footer.IndexOffset = m_Offset;
+		footer.NumFrames = static_cast<std::uint32_t>(m_Index.size());
+		footer.Magic = CACHE_MAGIC;
+		m_File.write(reinterpret_cast<const char*>(m_Index.data()),
+			m_Index.size() * sizeof(CacheIndexEntry));
+		m_File.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+		m_File.close();
+		if (!m_File)
+		{
+			throw std::runtime_error("Failed to write cache file");
+		}
+	}
+
+	void CacheWriter::WriteFrame(const Frame& frame)
+	{
+		const auto& positions = frame.Positions;
+
+		CacheFrameHeader header;
+		header.Flags = m_Index.size() % m_KeyframeInterval == 0 ? CACHE_FRAME_KEY : 0;
+		header.Step = frame.Step;
+		header.Min = DirectX::XMFLOAT3(positions[0].x, positions[0].y, positions[0].z);
+		header.Max = header.Min;
+		for (const auto& position : positions)
+		{
+			header.Min.x = std::min(header.Min.x, position.x);
+			header.Min.y = std::min(header.Min.y, position.y);
+			header.Min.z = std::min(header.Min.z, position.z);
+			header.Max.x = std::max(header.Max.x, position.x);
+			header.Max.y = std::max(header.Max.y, position.y);
+			header.Max.z = std::max(header.Max.z, position.z);
+		}
+
+		// residuals axis by axis, which keeps similar magnitudes in a block
+		m_Payload.clear();
+		BitWriter writer(m_Payload);
+		std::vector<std::int32_t> quantized(m_NumParticles);
+		std::vector<std::uint32_t> residuals(m_NumParticles);
+		const float* pMin = &header.Min.x;
+		const float* pMax = &header.Max.x;
+		auto framesSinceKey = static_cast<std::uint32_t>(m_Index.size() % m_KeyframeInterval);
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			Quantizer quantizer(pMin[axis], pMax[axis]);
+
+			for (std::uint32_t i = 0; i < m_NumParticles; i++)
+			{
+				quantized[i] = quantizer.Quantize(GetAxis(positions[i], axis));
+
+				std::int32_t predicted;
+				if (framesSinceKey == 0)
+				{
+					predicted = PredictFromNeighbours(quantized.data(), i, m_Resolution);
+				}
+				else
+				{
+					predicted = PredictFromPrevious(quantizer, GetAxis(m_Previous[i], axis),
+						GetAxis(m_BeforePrevious[i], axis), framesSinceKey);
+				}
+				residuals[i] = ZigZag(quantized[i] - predicted);
+			}
+
+			// predict from what the reader reconstructs, so that errors do not accumulate
+			for (std::uint32_t i = 0; i < m_NumParticles; i++)
+			{
+				(&m_BeforePrevious[i].x)[axis] = GetAxis(m_Previous[i], axis);
+				(&m_Previous[i].x)[axis] = quantizer.Dequantize(quantized[i]);
+			}
+
+			WriteRice(writer, residuals);
+		}
+		writer.Flush();
+
+		header.Size = static_cast<std::uint32_t>(m_Payload.size());
+		m_File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		m_File.write(reinterpret_cast<const char*>(m_Payload.data()), m_Payload.size());
+		if (!m_File)
+		{
+			throw std::runtime_error("Failed to write cache file");
+		}
+
+		CacheIndexEntry entry;
+		entry.Offset = m_Offset;
+		entry.Step = frame.Step;
+		m_Index.push_back(entry);
+
+		m_Offset += sizeof(header) + m_Payload.size();
+		m_RawBytes += static_cast<std::uint64_t>(m_NumParticles) * sizeof(DirectX::XMFLOAT4);
+		m_WrittenBytes += sizeof(header) + m_Payload.size();
+	}
+
+	CacheReader::CacheReader(const std::wstring& fileName, std::uint32_t readAhead)
+		: m_File(fileName, std::ios::binary)
+		, m_Stalls(0)
+	{
+		if (!m_File)
+		{
+			throw std::runtime_error("Failed to open cache file");
+		}
+
+		CacheHeader header;
+		if (!m_File.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+			header.Magic != CACHE_MAGIC)
+		{
+			throw std::runtime_error("Not a cloth cache");
+		}
+		if (header.Version != CACHE_VERSION)
+		{
+			throw std::runtime_error("Unsupported cache version");
+		}
+		if (header.Resolution < 3 || header.Resolution > 0xffff || header.KeyframeInterval == 0)
+		{
+			throw std::runtime_error("Invalid cache header");
+		}
+
+		CacheFooter footer;
+		m_File.seekg(-static_cast<std::streamoff>(sizeof(footer)), std::ios::end);
+		auto footerOffset = static_cast<std::uint64_t>(m_File.tellg());
+		if (!m_File.read(reinterpret_cast<char*>(&footer), sizeof(footer)) ||
+			footer.Magic != CACHE_MAGIC)
+		{
+			throw std::runtime_error("Cache file is not finished");
+		}
+		if (footer.NumFrames == 0 || footer.IndexOffset > footerOffset ||
+			(footerOffset - footer.IndexOffset) / sizeof(CacheIndexEntry) != footer.NumFrames)
+		{
+			throw std::runtime_error("Invalid cache index");
+		}
+
+		m_Index.resize(footer.NumFrames);
+		m_File.seekg(static_cast<std::streamoff>(footer.IndexOffset));
+		if (!m_File.read(reinterpret_cast<char*>(m_Index.data()),
+			m_Index.size() * sizeof(CacheIndexEntry)))
+		{
+			throw std::runtime_error("Failed to read cache index");
+		}
+
+		// frames lie back to back between the header and the index
+		auto end = footer.IndexOffset;
+		for (auto it = m_Index.rbegin(); it != m_Index.rend(); ++it)
+		{
+			if (it->Offset < sizeof(header) || it->Offset + sizeof(CacheFrameHeader) > end ||
+				(it != m_Index.rbegin() && it->Step > (it - 1)->Step))
+			{
+				throw std::runtime_error("Invalid cache index");
+			}
+			end = it->Offset;
+		}
+
+		m_IndexOffset = footer.IndexOffset;
+		m_Resolution = header.Resolution;
+		m_NumParticles = header.Resolution * header.Resolution;
+		m_KeyframeInterval = header.KeyframeInterval;
+		m_Previous.resize(m_NumParticles);
+		m_BeforePrevious.resize(m_NumParticles);
+		m_Quantized.resize(m_NumParticles);
+		m_Frames.resize(std::max(readAhead, 2u),
+			std::vector<DirectX::XMFLOAT4>(m_NumParticles));
+
+		m_Thread = std::thread([this]() { ReaderMain(); });
+	}
+
+	CacheReader::~CacheReader()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Quit = true;
+		}
+		m_Changed.notify_one();
+		m_Thread.join();
+	}
+
+	std::size_t CacheReader::FindFrame(double step) const
+	{
+		auto it = std::upper_bound(m_Index.begin(), m_Index.end(), step,
+			[](double value, const CacheIndexEntry& entry) { return value < entry.Step; });
+		return it == m_Index.begin() ? 0 : static_cast<std::size_t>(it - m_Index.begin()) - 1;
+	}
+
+	bool CacheReader::GetPositions(double step, DirectX::XMFLOAT4* pPositions)
+	{
+		auto iFrame = FindFrame(step);
+		auto iNext = std::min(iFrame + 1, m_Index.size() - 1);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (m_Exception)
+			{
+				std::rethrow_exception(m_Exception);
+			}
+
+			// seek if the frame is behind or beyond the read-ahead
+			if (m_Seek || iFrame < m_iFirstFrame || iFrame >= m_iFirstFrame + m_Frames.size())
+			{
+				if (!m_Seek || m_iSeekFrame != iFrame)
+				{
+					m_Seek = true;
+					m_iSeekFrame = iFrame;
+					m_Changed.notify_one();
+				}
+				m_Stalls++;
+				return false;
+			}
+
+			// frames before are not needed anymore, make room to read ahead
+			auto numReleased = std::min(iFrame - m_iFirstFrame, m_NumDecoded);
+			if (numReleased > 0)
+			{
+				m_iFirstFrame += numReleased;
+				m_NumDecoded -= numReleased;
+				m_Changed.notify_one();
+			}
+
+			if (iFrame != m_iFirstFrame || iNext >= m_iFirstFrame + m_NumDecoded)
+			{
+				m_Stalls++;
+				return false;
+			}
+		}
+
+		// the reader thread does not write frames in the window meanwhile
+		const auto& from = m_Frames[iFrame % m_Frames.size()];
+		const auto& to = m_Frames[iNext % m_Frames.size()];
+		auto stepFrom = static_cast<double>(m_Index[iFrame].Step);
+		auto stepTo = static_cast<double>(m_Index[iNext].Step);
+		auto alpha = stepTo > stepFrom ?
+			static_cast<float>(std::min(std::max((step - stepFrom) / (stepTo - stepFrom), 0.0), 1.0)) :
+			0.0f;
+
+		for (std::uint32_t i = 0; i < m_NumParticles; i++)
+		{
+			pPositions[i].x = from[i].x + (to[i].x - from[i].x) * alpha;
+			pPositions[i].y = from[i].y + (to[i].y - from[i].y) * alpha;
+			pPositions[i].z = from[i].z + (to[i].z - from[i].z) * alpha;
+			pPositions[i].w = 1.0f;
+		}
+
+		return true;
+	}
+
+	void CacheReader::ReaderMain()
+	{
+		for (;;)
+		{
+			std::size_t iFrame;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Changed.wait(lock, [this]()
+				{
+					return m_Quit || m_Seek || (m_NumDecoded < m_Frames.size() &&
+						m_iFirstFrame + m_NumDecoded < m_Index.size());
+				});
+				if (m_Quit)
+				{
+					return;
+				}
+
+				if (m_Seek)
+				{
+					m_iFirstFrame = m_iSeekFrame;
+					m_NumDecoded = 0;
+					m_Seek = false;
+				}
+				iFrame = m_iFirstFrame + m_NumDecoded;
+			}
+
+			try
+			{
+				DecodeFrame(iFrame, m_Frames[iFrame % m_Frames.size()]);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Exception = std::current_exception();
+				return;
+			}
+
+			// discarded if a seek came in meanwhile
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (!m_Seek && iFrame == m_iFirstFrame + m_NumDecoded)
+			{
+				m_NumDecoded++;
+			}
+		}
+	}
+
+	void CacheReader::DecodeFrame(std::size_t iFrame, std::vector<DirectX::XMFLOAT4>& positions)
+	{
+		// continue from the frame decoded last, or from the key frame before
+		auto iStart = iFrame - iFrame % m_KeyframeInterval;
+		if (m_iPredictedFrame != SIZE_MAX && m_iPredictedFrame >= iStart && m_iPredictedFrame < iFrame)
+		{
+			iStart = m_iPredictedFrame + 1;
+		}
+
+		for (auto i = iStart; i <= iFrame; i++)
+		{
+			DecodeNextFrame(i, positions);
+		}
+	}
+
+	void CacheReader::DecodeNextFrame(std::size_t iFrame, std::vector<DirectX::XMFLOAT4>& positions)
+	{
+		const auto& entry = m_Index[iFrame];
+		if (m_iFileFrame != iFrame)
+		{
+			m_File.clear();
+			m_File.seekg(static_cast<std::streamoff>(entry.Offset));
+		}
+
+		CacheFrameHeader header;
+		auto end = iFrame + 1 < m_Index.size() ? m_Index[iFrame + 1].Offset : m_IndexOffset;
+		if (!m_File.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+			entry.Offset + sizeof(header) + header.Size > end)
+		{
+			throw std::runtime_error("Failed to read cache frame");
+		}
+
+		m_Payload.resize(header.Size);
+		if (!m_File.read(reinterpret_cast<char*>(m_Payload.data()), header.Size))
+		{
+			throw std::runtime_error("Failed to read cache frame");
+		}
+		m_iFileFrame = iFrame + 1;
+
+		BitReader reader(m_Payload.data(), m_Payload.size());
+		std::vector<std::uint32_t> residuals(m_NumParticles);
+		const float* pMin = &header.Min.x;
+		const float* pMax = &header.Max.x;
+		auto framesSinceKey = static_cast<std::uint32_t>(iFrame % m_KeyframeInterval);
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			Quantizer quantizer(pMin[axis], pMax[axis]);
+			ReadRice(reader, residuals);
+
+			for (std::uint32_t i = 0; i < m_NumParticles; i++)
+			{
+				auto predicted = framesSinceKey == 0 ?
+					PredictFromNeighbours(m_Quantized.data(), i, m_Resolution) :
+					PredictFromPrevious(quantizer, GetAxis(m_Previous[i], axis),
+						GetAxis(m_BeforePrevious[i], axis), framesSinceKey);
+
+				m_Quantized[i] = predicted + UnZigZag(residuals[i]);
+				if (m_Quantized[i] < 0 || m_Quantized[i] > static_cast<std::int32_t>(QUANTIZATION_LEVELS))
+				{
+					throw std::runtime_error("Cache frame is corrupt");
+				}
+			}
+
+			for (std::uint32_t i = 0; i < m_NumParticles; i++)
+			{
+				auto value = quantizer.Dequantize(m_Quantized[i]);
+				(&m_BeforePrevious[i].x)[axis] = GetAxis(m_Previous[i], axis);
+				(&m_Previous[i].x)[axis] = value;
+				(&positions[i].x)[axis] = value;
+			}
+		}
+
+		for (auto& position : positions)
+		{
+			position.w = 1.0f;
+		}
+
+		m_iPredictedFrame = iFrame;
+	}
+}
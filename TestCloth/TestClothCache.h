@@ -0,0 +1,193 @@
+#pragma once
+
+#include "WorkQueue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace TestCloth
+{
+	// cache file layout: CacheHeader, then every frame as CacheFrameHeader
+	// followed by Size bytes of coded positions, then CacheIndexEntry for
+	// every frame and CacheFooter at the very end of the file.
+	//
+	// positions are quantized to 16 bits per axis within the bounding box of
+	// their frame. key frames predict every particle from its neighbours in the
+	// grid. other frames are delta coded against the same particle in the
+	// frames before, extrapolated linearly once two of them follow the key
+	// frame, and requantized to the current box. the residuals are Rice coded
+	// in blocks.
+	struct CacheHeader
+	{
+		std::uint32_t Magic;
+		std::uint32_t Version;
+
+		// particles per row and per column
+		std::uint32_t Resolution;
+		std::uint32_t KeyframeInterval;
+	};
+
+	struct CacheFrameHeader
+	{
+		std::uint32_t Size;
+		std::uint32_t Flags;
+		std::uint64_t Step;
+		DirectX::XMFLOAT3 Min;
+		DirectX::XMFLOAT3 Max;
+	};
+
+	struct CacheIndexEntry
+	{
+		// from the start of the file to the frame header
+		std::uint64_t Offset;
+		std::uint64_t Step;
+	};
+
+	struct CacheFooter
+	{
+		std::uint64_t IndexOffset;
+		std::uint32_t NumFrames;
+		std::uint32_t Magic;
+	};
+
+	const std::uint32_t CACHE_MAGIC = 0x43534354; // "TCSC"
+	const std::uint32_t CACHE_VERSION = 1;
+
+	// CacheFrameHeader::Flags, frame is decoded without the frame before
+	const std::uint32_t CACHE_FRAME_KEY = 1;
+
+	// encodes frames on its own thread and appends them to a cache file.
+	// positions are reconstructed within half a quantization step, that is
+	// 1 / 131070 of the extent of their frame along each axis.
+	class CacheWriter
+	{
+	public:
+		// up to numBuffers frames wait for the writer thread before frames are dropped
+		CacheWriter(const std::wstring& fileName, std::uint32_t resolution,
+			std::uint32_t keyframeInterval = 60, std::uint32_t numBuffers = 8);
+		CacheWriter(const CacheWriter&) = delete;
+		CacheWriter& operator=(const CacheWriter&) = delete;
+		~CacheWriter();
+
+		// copy positions (float4 per particle) to be encoded on the writer thread.
+		// returns false if the frame is dropped because all buffers are waiting.
+		bool AddFrame(std::uint64_t step, const DirectX::XMFLOAT4* pPositions);
+
+		// count a frame dropped before it reached AddFrame()
+		void DropFrame();
+
+		// encode the waiting frames and write the index.
+		// rethrows the first error of the writer thread.
+		void Close();
+
+		// size of the frames as float4 positions, and as written
+		std::uint64_t GetRawBytes() const { return m_RawBytes; }
+		std::uint64_t GetWrittenBytes() const { return m_WrittenBytes; }
+		std::uint64_t GetDroppedFrames() const { return m_Queue.GetDroppedFrames(); }
+
+	private:
+		struct Frame
+		{
+			explicit Frame(std::uint32_t numParticles) : Step(0), Positions(numParticles) {}
+
+			std::uint64_t Step;
+			std::vector<DirectX::XMFLOAT4> Positions;
+		};
+
+		void WriteFrame(const Frame& frame);
+
+		std::ofstream m_File;
+		std::uint32_t m_Resolution;
+		std::uint32_t m_NumParticles;
+		std::uint32_t m_KeyframeInterval;
+
+		// written by the writer thread only.
+		// positions of the last two frames, as reconstructed by the reader.
+		std::vector<DirectX::XMFLOAT4> m_Previous;
+		std::vector<DirectX::XMFLOAT4> m_BeforePrevious;
+		std::vector<std::uint8_t> m_Payload;
+		std::vector<CacheIndexEntry> m_Index;
+		std::uint64_t m_Offset = 0;
+
+		std::atomic<std::uint64_t> m_RawBytes;
+		std::atomic<std::uint64_t> m_WrittenBytes;
+
+		// last, so that the writer thread stops before the members it writes go
+		FrameQueue<Frame> m_Queue;
+	};
+
+	// streams frames of a cache file, decoded ahead on its own thread
+	class CacheReader
+	{
+	public:
+		// up to readAhead frames are decoded before they are asked for
+		explicit CacheReader(const std::wstring& fileName, std::uint32_t readAhead = 16);
+		CacheReader(const CacheReader&) = delete;
+		CacheReader& operator=(const CacheReader&) = delete;
+		~CacheReader();
+
+		std::uint32_t GetResolution() const { return m_Resolution; }
+		std::uint64_t GetFirstStep() const { return m_Index.front().Step; }
+		std::uint64_t GetLastStep() const { return m_Index.back().Step; }
+
+		// positions (float4 per particle) at step, interpolated between the
+		// stored frames around it. returns false without writing positions
+		// while those frames are not decoded yet. steps are expected to
+		// increase; other steps seek through the frame index.
+		bool GetPositions(double step, DirectX::XMFLOAT4* pPositions);
+
+		// frames asked for before they were decoded
+		std::uint64_t GetStalls() const { return m_Stalls; }
+
+	private:
+		// last frame at or before step, clamped to the frames in the file
+		std::size_t FindFrame(double step) const;
+
+		void ReaderMain();
+
+		// decode frame, and the frames it is predicted from if necessary
+		void DecodeFrame(std::size_t iFrame, std::vector<DirectX::XMFLOAT4>& positions);
+		void DecodeNextFrame(std::size_t iFrame, std::vector<DirectX::XMFLOAT4>& positions);
+
+		std::ifstream m_File;
+		std::uint32_t m_Resolution;
+		std::uint32_t m_NumParticles;
+		std::uint32_t m_KeyframeInterval;
+		std::vector<CacheIndexEntry> m_Index;
+
+		// end of the last frame
+		std::uint64_t m_IndexOffset;
+
+		// used by the reader thread only
+		std::vector<DirectX::XMFLOAT4> m_Previous;
+		std::vector<DirectX::XMFLOAT4> m_BeforePrevious;
+		std::vector<std::uint8_t> m_Payload;
+		std::vector<std::int32_t> m_Quantized;
+		std::size_t m_iPredictedFrame = SIZE_MAX;
+		std::size_t m_iFileFrame = SIZE_MAX;
+
+		// decoded frames m_iFirstFrame and on, in a ring of m_Frames
+		std::vector<std::vector<DirectX::XMFLOAT4>> m_Frames;
+		std::size_t m_iFirstFrame = 0;
+		std::size_t m_NumDecoded = 0;
+		std::size_t m_iSeekFrame = 0;
+		bool m_Seek = false;
+		bool m_Quit = false;
+		std::mutex m_Mutex;
+		std::condition_variable m_Changed;
+		std::exception_ptr m_Exception;
+		std::thread m_Thread;
+
+		// counted under m_Mutex, read without it
+		std::atomic<std::uint64_t> m_Stalls;
+	};
+}
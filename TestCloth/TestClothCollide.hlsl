@@ -0,0 +1,70 @@
+#include "TestClothSolver.hlsli"
+
+#define COLLIDER_SPHERE 0
+#define COLLIDER_PLANE 1
+
+struct Collider
+{
+	// sphere: center and radius, plane: unit normal and offset along it.
+	// radius and offset include the collision thickness.
+	float4 shape;
+	uint type;
+	uint3 dummy;
+};
+
+StructuredBuffer<Collider> Colliders : register(t0);
+RWStructuredBuffer<float4> Positions : register(u0);
+RWStructuredBuffer<float4> Velocities : register(u1);
+
+// pushes particles out of the static colliders and removes their velocity
+// into them. pinned particles are overwritten by the attachments afterwards.
+[numthreads(128, 2, 1)]
+void main(uint3 threadID : SV_DispatchThreadID)
+{
+	// the grid is dispatched in whole groups, skip threads beyond it
+	if (any(threadID.xy >= ClothResolution))
+	{
+		return;
+	}
+
+	uint numColliders, stride;
+	Colliders.GetDimensions(numColliders, stride);
+
+	uint id = ComposeID(threadID.xy);
+	float4 position = Positions[id];
+	float3 velocity = Velocities[id].xyz;
+	bool collided = false;
+
+	for (uint i = 0; i < numColliders; i++)
+	{
+		Collider collider = Colliders[i];
+
+		float3 normal;
+		float depth;
+		if (collider.type == COLLIDER_SPHERE)
+		{
+			float3 offset = position.xyz - collider.shape.xyz;
+			float distance = length(offset);
+			normal = distance > 0.0f ? offset / distance : float3(0.0f, 1.0f, 0.0f);
+			depth = collider.shape.w - distance;
+		}
+		else
+		{
+			normal = collider.shape.xyz;
+			depth = collider.shape.w - dot(normal, position.xyz);
+		}
+
+		if (depth > 0.0f)
+		{
+			position.xyz += depth * normal;
+			velocity -= min(dot(velocity, normal), 0.0f) * normal;
+			collided = true;
+		}
+	}
+
+	if (collided)
+	{
+		Positions[id] = position;
+		Velocities[id] = float4(velocity, 0.0f);
+	}
+}
@@ -0,0 +1,293 @@
+#include "stdafx.h"
+#include "TestClothExport.h"
+#include "TestClothLinks.hlsli"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+	// characters written by WriteFloat() at most
+	const std::size_t MAX_FLOAT_CHARS = 24;
+	const std::size_t MAX_UINT_CHARS = 10;
+
+	char* WriteUint(char* p, std::uint32_t value)
+	{
+		char digits[MAX_UINT_CHARS];
+		std::size_t numDigits = 0;
+		do
+		{
+			digits[numDigits++] = static_cast<char>('0' + value % 10);
+			value /= 10;
+		} while (value > 0);
+
+		while (numDigits > 0)
+		{
+			*p++ = digits[--numDigits];
+		}
+		return p;
+	}
+
+	// fixed notation with up to 6 decimals, without the trailing zeros.
+	// several times faster than printf, which is left for values too large
+	// for fixed notation, infinities and NaN.
+	char* WriteFloat(char* p, float value)
+	{
+		if (!(std::fabs(value) < 1e9f))
+		{
+			return p + sprintf_s(p, MAX_FLOAT_CHARS, "%g", value);
+		}
+
+		if (value < 0.0f)
+		{
+			*p++ = '-';
+			value = -value;
+		}
+
+		auto scaled = static_cast<std::uint64_t>(static_cast<double>(value) * 1e6 + 0.5);
+		p = WriteUint(p, static_cast<std::uint32_t>(scaled / 1000000));
+
+		auto fraction = static_cast<std::uint32_t>(scaled % 1000000);
+		if (fraction == 0)
+		{
+			return p;
+		}
+
+		*p++ = '.';
+		for (int i = 5; i >= 0; i--)
+		{
+			p[i] = static_cast<char>('0' + fraction % 10);
+			fraction /= 10;
+		}
+		p += 6;
+
+		while (p[-1] == '0')
+		{
+			p--;
+		}
+		return p;
+	}
+
+	template <typename T>
+	char* WriteBinary(char* p, const T& value)
+	{
+		std::memcpy(p, &value, sizeof(value));
+		return p + sizeof(value);
+	}
+
+	char* WriteString(char* p, const char* pString)
+	{
+		auto length = std::strlen(pString);
+		std::memcpy(p, pString, length);
+		return p + length;
+	}
+}
+
+namespace TestCloth
+{
+	MeshExporter::MeshExporter(const std::wstring& fileNamePrefix, ExportFormat format,
+		std::uint32_t resolution, std::uint32_t numBuffers)
+		: m_FileNamePrefix(fileNamePrefix)
+		, m_Format(format)
+		, m_Resolution(resolution)
+		, m_NumParticles(resolution * resolution)
+		, m_WrittenBytes(0)
+		, m_WrittenFrames(0)
+		, m_Queue(numBuffers, Frame(resolution * resolution), [this](Frame& frame) { WriteFrame(frame); })
+	{
+		// large enough for any frame, so that formatting never reallocates
+		const std::size_t numTriangles = 2 * (resolution - 1) * (resolution - 1);
+		const std::size_t headerSize = 512;
+		m_Triangles.reserve(numTriangles);
+		m_Text.resize(headerSize + (format == ExportFormat::Ply ?
+			m_NumParticles * 6 * sizeof(float) + numTriangles * (1 + 3 * sizeof(std::uint32_t)) :
+			m_NumParticles * 2 * (3 + 3 * (MAX_FLOAT_CHARS + 1)) +
+			numTriangles * (3 + 3 * (2 * MAX_UINT_CHARS + 3))));
+	}
+
+	MeshExporter::~MeshExporter()
+	{
+		try
+		{
+			Close();
+		}
+		catch (const std::exception&)
+		{
+		}
+	}
+
+	bool MeshExporter::AddFrame(std::uint64_t step, const DirectX::XMFLOAT4* pPositions,
+		const DirectX::XMFLOAT4* pNormals, const std::uint32_t* pLinks)
+	{
+		auto pFrame = m_Queue.Acquire();
+		if (!pFrame)
+		{
+			return false;
+		}
+
+		pFrame->Step = step;
+		std::copy(pPositions, pPositions + m_NumParticles, pFrame->Positions.begin());
+		std::copy(pNormals, pNormals + m_NumParticles, pFrame->Normals.begin());
+		std::copy(pLinks, pLinks + m_NumParticles, pFrame->Links.begin());
+		m_Queue.Push(pFrame);
+
+		return true;
+	}
+
+	void MeshExporter::DropFrame()
+	{
+		m_Queue.Drop();
+	}
+
+	void MeshExporter::Close()
+	{
+		m_Queue.Close();
+	}
+
+	double MeshExporter::GetThroughput() const
+	{
+		// wall clock time, including the time frames waited for the writer thread
+		double milliseconds = m_Timer.GetMilliseconds();
+		return milliseconds > 0.0 ? m_WrittenBytes * 1e3 / milliseconds : 0.0;
+	}
+
+	void MeshExporter::WriteFrame(const Frame& frame)
+	{
+		// triangles of the quads drawn, wound as the grid of the solver
+		m_Triangles.clear();
+		for (std::uint32_t qy = 0; qy < m_Resolution - 1; qy++)
+		{
+			for (std::uint32_t qx = 0; qx < m_Resolution - 1; qx++)
+			{
+				std::uint32_t q = qx + qy * m_Resolution;
+				if ((frame.Links[q] & LINK_QUAD_TOP_LEFT) == LINK_QUAD_TOP_LEFT &&
+					(frame.Links[q + m_Resolution + 1] & LINK_QUAD_BOTTOM_RIGHT) == LINK_QUAD_BOTTOM_RIGHT)
+				{
+					m_Triangles.push_back(DirectX::XMUINT3(q, q + 1, q + 1 + m_Resolution));
+					m_Triangles.push_back(DirectX::XMUINT3(q, q + 1 + m_Resolution, q + m_Resolution));
+				}
+			}
+		}
+
+		auto end = m_Format == ExportFormat::Ply ? FormatPly(frame) : FormatObj(frame);
+		auto size = static_cast<std::size_t>(end - m_Text.data());
+
+		std::wostringstream fileName;
+		fileName << m_FileNamePrefix << L'_' << std::setw(6) << std::setfill(L'0') << frame.Step <<
+			(m_Format == ExportFormat::Ply ? L".ply" : L".obj");
+
+		std::ofstream file(fileName.str(), std::ios::binary | std::ios::trunc);
+		file.write(m_Text.data(), size);
+		file.close();
+		if (!file)
+		{
+			throw std::runtime_error("Failed to write mesh file");
+		}
+
+		m_WrittenBytes += size;
+		m_WrittenFrames++;
+	}
+
+	char* MeshExporter::FormatPly(const Frame& frame)
+	{
+		char header[512];
+		auto headerSize = sprintf_s(header,
+			"ply\n"
+			"format binary_little_endian 1.0\n"
+			"comment TestCloth step %llu\n"
+			"element vertex %u\n"
+			"property float x\n"
+			"property float y\n"
+			"property float z\n"
+			"property float nx\n"
+			"property float ny\n"
+			"property float nz\n"
+			"element face %u\n"
+			"property list uchar uint vertex_indices\n"
+			"end_header\n",
+			static_cast<unsigned long long>(frame.Step), m_NumParticles,
+			static_cast<std::uint32_t>(m_Triangles.size()));
+
+		auto p = m_Text.data();
+		std::memcpy(p, header, headerSize);
+		p += headerSize;
+
+		for (std::uint32_t i = 0; i < m_NumParticles; i++)
+		{
+			const auto& position = frame.Positions[i];
+			const auto& normal = frame.Normals[i];
+			p = WriteBinary(p, position.x);
+			p = WriteBinary(p, position.y);
+			p = WriteBinary(p, position.z);
+			p = WriteBinary(p, normal.x);
+			p = WriteBinary(p, normal.y);
+			p = WriteBinary(p, normal.z);
+		}
+
+		for (const auto& triangle : m_Triangles)
+		{
+			*p++ = 3;
+			p = WriteBinary(p, triangle.x);
+			p = WriteBinary(p, triangle.y);
+			p = WriteBinary(p, triangle.z);
+		}
+
+		return p;
+	}
+
+	char* MeshExporter::FormatObj(const Frame& frame)
+	{
+		char header[64];
+		sprintf_s(header, "# TestCloth step %llu\n", static_cast<unsigned long long>(frame.Step));
+
+		auto p = WriteString(m_Text.data(), header);
+
+		for (const auto& position : frame.Positions)
+		{
+			*p++ = 'v';
+			*p++ = ' ';
+			p = WriteFloat(p, position.x);
+			*p++ = ' ';
+			p = WriteFloat(p, position.y);
+			*p++ = ' ';
+			p = WriteFloat(p, position.z);
+			*p++ = '\n';
+		}
+
+		for (const auto& normal : frame.Normals)
+		{
+			*p++ = 'v';
+			*p++ = 'n';
+			*p++ = ' ';
+			p = WriteFloat(p, normal.x);
+			*p++ = ' ';
+			p = WriteFloat(p, normal.y);
+			*p++ = ' ';
+			p = WriteFloat(p, normal.z);
+			*p++ = '\n';
+		}
+
+		// indices from 1, a normal per vertex
+		for (const auto& triangle : m_Triangles)
+		{
+			*p++ = 'f';
+			for (auto index : { triangle.x, triangle.y, triangle.z })
+			{
+				*p++ = ' ';
+				p = WriteUint(p, index + 1);
+				*p++ = '/';
+				*p++ = '/';
+				p = WriteUint(p, index + 1);
+			}
+			*p++ = '\n';
+		}
+
+		return p;
+	}
+}
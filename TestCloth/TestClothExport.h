@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Profiler.h"
+#include "WorkQueue.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace TestCloth
+{
+	enum class ExportFormat
+	{
+		// binary little endian, positions and normals as floats
+		Ply,
+
+		// text, positions and normals with 6 decimals
+		Obj,
+	};
+
+	// writes every frame of a cloth as a mesh file of its own, for tools
+	// which import mesh sequences. frames are copied into preallocated
+	// buffers and formatted on a writer thread. only the quads drawn by
+	// the cloth are exported, torn ones are left out.
+	class MeshExporter
+	{
+	public:
+		// files are named <fileNamePrefix>_<step>.ply or .obj. up to numBuffers
+		// frames wait for the writer thread before frames are dropped.
+		MeshExporter(const std::wstring& fileNamePrefix, ExportFormat format,
+			std::uint32_t resolution, std::uint32_t numBuffers = 8);
+		MeshExporter(const MeshExporter&) = delete;
+		MeshExporter& operator=(const MeshExporter&) = delete;
+		~MeshExporter();
+
+		// copy positions and normals (float4 per particle) and links (see
+		// TestClothLinks.hlsli) to be written on the writer thread.
+		// returns false if the frame is dropped because all buffers are waiting.
+		bool AddFrame(std::uint64_t step, const DirectX::XMFLOAT4* pPositions,
+			const DirectX::XMFLOAT4* pNormals, const std::uint32_t* pLinks);
+
+		// count a frame dropped before it reached AddFrame()
+		void DropFrame();
+
+		// write the waiting frames. rethrows the first error of the writer thread.
+		void Close();
+
+		std::uint64_t GetWrittenBytes() const { return m_WrittenBytes; }
+		std::uint64_t GetWrittenFrames() const { return m_WrittenFrames; }
+		std::uint64_t GetDroppedFrames() const { return m_Queue.GetDroppedFrames(); }
+
+		// bytes written per second since the exporter was created
+		double GetThroughput() const;
+
+	private:
+		struct Frame
+		{
+			explicit Frame(std::uint32_t numParticles)
+				: Step(0), Positions(numParticles), Normals(numParticles), Links(numParticles) {}
+
+			std::uint64_t Step;
+			std::vector<DirectX::XMFLOAT4> Positions;
+			std::vector<DirectX::XMFLOAT4> Normals;
+			std::vector<std::uint32_t> Links;
+		};
+
+		void WriteFrame(const Frame& frame);
+
+		// the formatted file is returned as [m_Text.data(), end)
+		char* FormatPly(const Frame& frame);
+		char* FormatObj(const Frame& frame);
+
+		std::wstring m_FileNamePrefix;
+		ExportFormat m_Format;
+		std::uint32_t m_Resolution;
+		std::uint32_t m_NumParticles;
+
+		// written by the writer thread only
+		std::vector<DirectX::XMUINT3> m_Triangles;
+		std::vector<char> m_Text;
+
+		std::atomic<std::uint64_t> m_WrittenBytes;
+		std::atomic<std::uint64_t> m_WrittenFrames;
+		CpuTimer m_Timer;
+
+		// last, so that the writer thread stops before the members it writes go
+		FrameQueue<Frame> m_Queue;
+	};
+}
@@ -1,13 +1,17 @@
 #include "TestCloth.hlsli"
+#include "TestClothLinks.hlsli"
 
 StructuredBuffer<float4> InputPositions : register(t0);
 StructuredBuffer<float4> InputNormals : register(t1);
+StructuredBuffer<uint> InputLinks : register(t2);
+StructuredBuffer<float4> PreviousPositions : register(t3);
 
 cbuffer cbTestClothMatrices : register(b0)
 {
 	matrix WorldView;
 	matrix Projection;
 	uint2 ClothResolution;
+	float RenderAlpha;
 };
 
 uint2 DecomposeID(in uint id)
@@ -21,62 +25,62 @@ uint RecomposeID(in uint2 id)
 	return id.x + id.y * ClothResolution.x;
 }
 
+// position blended between the last two steps
+float4 GetPosition(in uint id)
+{
+	return float4(lerp(PreviousPositions[id].xyz, InputPositions[id].xyz, RenderAlpha), 1.0f);
+}
+
 [maxvertexcount(8)]
 void main(point VS_OUTPUT Input[1], inout TriangleStream<GS_OUTPUT> triStream)
 {
 	uint id = Input[0].id;
 	uint2 ID2 = DecomposeID(id);
-	if (ID2.x > 0 && ID2.y > 0)
+	if (ID2.x > 0 && ID2.y > 0 &&
+		(InputLinks[id] & LINK_QUAD_BOTTOM_RIGHT) == LINK_QUAD_BOTTOM_RIGHT &&
+		(InputLinks[id - ClothResolution.x - 1] & LINK_QUAD_TOP_LEFT) == LINK_QUAD_TOP_LEFT)
 	{
 		float4 pos;
 		GS_OUTPUT Output;
 
-		pos = InputPositions[id - 1];
-		pos.w = 1.0f;
+		pos = GetPosition(id - 1);
 		Output.Position = mul(mul(pos, WorldView), Projection);
 		Output.Normal = InputNormals[id - 1].xyz;
 		triStream.Append(Output);
 
-		pos = InputPositions[id];
-		pos.w = 1.0f;
+		pos = GetPosition(id);
 		Output.Position = mul(mul(pos, WorldView), Projection);
 		Output.Normal = InputNormals[id].xyz;
 		triStream.Append(Output);
 
-		pos = InputPositions[id - ClothResolution.x - 1];
-		pos.w = 1.0f;
+		pos = GetPosition(id - ClothResolution.x - 1);
 		Output.Position = mul(mul(pos, WorldView), Projection);
 		Output.Normal = InputNormals[id - ClothResolution.x - 1].xyz;
 		triStream.Append(Output);
 	
-		pos = InputPositions[id - ClothResolution.x];
-		pos.w = 1.0f;
+		pos = GetPosition(id - ClothResolution.x);
 		Output.Position = mul(mul(pos, WorldView), Projection);
 		Output.Normal = InputNormals[id - ClothResolution.x].xyz;
 		triStream.Append(Output);
 
 		triStream.RestartStrip();
 
-		pos = InputPositions[id];
-		pos.w = 1.0f;
+		pos = GetPosition(id);
 		Output.Position = mul(mul(pos, WorldView), Projection);
 		Output.Normal = -InputNormals[id].xyz;
 		triStream.Append(Output);
 
-		pos = InputPositions[id - 1];
-		pos.w = 1.0f;
+		pos = GetPosition(id - 1);
 		Output.Position = mul(mul(pos, WorldView), Projection);
 		Output.Normal = -InputNormals[id - 1].xyz;
 		triStream.Append(Output);
 
-		pos = InputPositions[id - ClothResolution.x];
-		pos.w = 1.0f;
+		pos = GetPosition(id - ClothResolution.x);
 		Output.Position = mul(mul(pos, WorldView), Projection);
 		Output.Normal = -InputNormals[id - ClothResolution.x].xyz;
 		triStream.Append(Output);
 
-		pos = InputPositions[id - ClothResolution.x - 1];
-		pos.w = 1.0f;
+		pos = GetPosition(id - ClothResolution.x - 1);
 		Output.Position = mul(mul(pos, WorldView), Projection);
 		Output.Normal = -InputNormals[id - ClothResolution.x - 1].xyz;
 		triStream.Append(Output);
@@ -0,0 +1,96 @@
+#include "TestClothLinks.hlsli"
+#include "TestClothSolver.hlsli"
+#include "TestClothHinge.hlsli"
+
+StructuredBuffer<float4> PositionsFrom : register(t0);
+StructuredBuffer<float4> VelocitiesFrom : register(t1);
+StructuredBuffer<Hinge> Hinges : register(t2);
+StructuredBuffer<uint> LinksFrom : register(t3);
+RWByteAddressBuffer HingeForces : register(u0);
+
+cbuffer cbTestClothHinge : register(b1)
+{
+	uint NumHinges;
+};
+
+void AddForce(in uint id, in float3 force)
+{
+	int3 f = int3(force * HINGE_FORCE_SCALE);
+	HingeForces.InterlockedAdd(id * 12 + 0, asuint(f.x));
+	HingeForces.InterlockedAdd(id * 12 + 4, asuint(f.y));
+	HingeForces.InterlockedAdd(id * 12 + 8, asuint(f.z));
+}
+
+// dihedral angle bending (Bridson et al. 2003),
+// independent of stretching unlike the bending springs.
+// Bending carries TestCloth::Desc::Hinge in this mode.
+[numthreads(64, 1, 1)]
+void main(uint3 threadID : SV_DispatchThreadID)
+{
+	if (threadID.x >= NumHinges)
+	{
+		return;
+	}
+
+	Hinge hinge = Hinges[threadID.x];
+
+	// the triangles no longer bend against each other once an edge of
+	// either is torn
+	if (!IsLinked(LinksFrom, hinge.ids.z, hinge.ids.w, ClothResolution.x) ||
+		!IsLinked(LinksFrom, hinge.ids.x, hinge.ids.z, ClothResolution.x) ||
+		!IsLinked(LinksFrom, hinge.ids.x, hinge.ids.w, ClothResolution.x) ||
+		!IsLinked(LinksFrom, hinge.ids.y, hinge.ids.z, ClothResolution.x) ||
+		!IsLinked(LinksFrom, hinge.ids.y, hinge.ids.w, ClothResolution.x))
+	{
+		return;
+	}
+
+	float3 x0 = PositionsFrom[hinge.ids.x].xyz;
+	float3 x1 = PositionsFrom[hinge.ids.y].xyz;
+	float3 x2 = PositionsFrom[hinge.ids.z].xyz;
+	float3 x3 = PositionsFrom[hinge.ids.w].xyz;
+
+	float3 e = x3 - x2;
+	float3 n1 = cross(x0 - x2, x0 - x3);
+	float3 n2 = cross(x1 - x3, x1 - x2);
+	float eLen = length(e);
+	float n1LenSq = dot(n1, n1);
+	float n2LenSq = dot(n2, n2);
+
+	// skip degenerate triangles
+	if (eLen < 1.0e-8f || n1LenSq < 1.0e-16f || n2LenSq < 1.0e-16f)
+	{
+		return;
+	}
+
+	float3 u0 = eLen * n1 / n1LenSq;
+	float3 u1 = eLen * n2 / n2LenSq;
+	float3 u2 = dot(x0 - x3, e) / eLen * n1 / n1LenSq +
+		dot(x1 - x3, e) / eLen * n2 / n2LenSq;
+	float3 u3 = -dot(x0 - x2, e) / eLen * n1 / n1LenSq -
+		dot(x1 - x2, e) / eLen * n2 / n2LenSq;
+
+	float3 n1Hat = n1 * rsqrt(n1LenSq);
+	float3 n2Hat = n2 * rsqrt(n2LenSq);
+	float sinHalfAngle = sqrt(saturate(0.5f * (1.0f - dot(n1Hat, n2Hat))));
+	if (dot(cross(n1Hat, n2Hat), e) < 0.0f)
+	{
+		sinHalfAngle = -sinHalfAngle;
+	}
+
+	float angularVelocity =
+		dot(u0, VelocitiesFrom[hinge.ids.x].xyz) +
+		dot(u1, VelocitiesFrom[hinge.ids.y].xyz) +
+		dot(u2, VelocitiesFrom[hinge.ids.z].xyz) +
+		dot(u3, VelocitiesFrom[hinge.ids.w].xyz);
+
+	float magnitude = Bending.stiffness * eLen * eLen /
+		(sqrt(n1LenSq) + sqrt(n2LenSq)) *
+		(sinHalfAngle - hinge.restSinHalfAngle) -
+		Bending.damping * eLen * angularVelocity;
+
+	AddForce(hinge.ids.x, magnitude * u0);
+	AddForce(hinge.ids.y, magnitude * u1);
+	AddForce(hinge.ids.z, magnitude * u2);
+	AddForce(hinge.ids.w, magnitude * u3);
+}
@@ -0,0 +1,11 @@
+// hinge between two triangles (x2, x3, x0) and (x3, x2, x1)
+// sharing the edge x2-x3, precomputed on CPU
+struct Hinge
+{
+	uint4 ids;
+	float restSinHalfAngle;
+	float3 dummy;
+};
+
+// hinge forces are accumulated atomically in 16.16 fixed point
+#define HINGE_FORCE_SCALE 65536.0f
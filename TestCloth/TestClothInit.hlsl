@@ -1,5 +1,8 @@
+#include "TestClothLinks.hlsli"
+
 RWStructuredBuffer<float4> Positions : register(u0);
 RWStructuredBuffer<float4> Velocities : register(u1);
+RWStructuredBuffer<uint> Links : register(u2);
 
 cbuffer cbTestCloth
 {
@@ -15,6 +18,12 @@ uint ComposeID(in uint2 id)
 [numthreads(128, 2, 1)]
 void main(uint3 threadID : SV_DispatchThreadID)
 {
+	// the grid is dispatched in whole groups, skip threads beyond it
+	if (any(threadID.xy >= ClothResolution))
+	{
+		return;
+	}
+
 	uint2 id2D = threadID.xy;
 	uint id = ComposeID(id2D);
 
@@ -25,4 +34,5 @@ void main(uint3 threadID : SV_DispatchThreadID)
 		lerp(FourPositions[2], FourPositions[3], factors.x),
 		factors.y);
 	Velocities[id] = float4(0.0f, 0.0f, 0.0f, 0.0f);
+	Links[id] = LINK_ALL;
 }
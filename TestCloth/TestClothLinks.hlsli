@@ -0,0 +1,42 @@
+// bits of the per-particle link mask.
+// each bit is one spring of the grid stencil; a cleared bit is a torn spring.
+// both ends of a spring evaluate the same strain, so they tear it together.
+// the exporter includes the macros from C++, the functions are HLSL only.
+#define LINK_NEIGHBOUR_XMIN 0x001
+#define LINK_NEIGHBOUR_XMAX 0x002
+#define LINK_NEIGHBOUR_YMIN 0x004
+#define LINK_NEIGHBOUR_YMAX 0x008
+#define LINK_DIAGONAL_XMIN_YMIN 0x010
+#define LINK_DIAGONAL_XMAX_YMIN 0x020
+#define LINK_DIAGONAL_XMIN_YMAX 0x040
+#define LINK_DIAGONAL_XMAX_YMAX 0x080
+#define LINK_BENDING_XMIN 0x100
+#define LINK_BENDING_XMAX 0x200
+#define LINK_BENDING_YMIN 0x400
+#define LINK_BENDING_YMAX 0x800
+#define LINK_ALL 0xfff
+
+// links required to draw the quad whose bottom-right corner is the particle,
+// checked at the bottom-right and top-left corners respectively
+#define LINK_QUAD_BOTTOM_RIGHT (LINK_NEIGHBOUR_XMIN | LINK_NEIGHBOUR_YMIN | LINK_DIAGONAL_XMIN_YMIN)
+#define LINK_QUAD_TOP_LEFT (LINK_NEIGHBOUR_XMAX | LINK_NEIGHBOUR_YMAX)
+
+#ifndef __cplusplus
+// link of the spring from a particle to a neighbour in its 3x3 stencil,
+// indexed by (dx + 1) + (dy + 1) * 3
+static const uint STENCIL_LINKS[9] =
+{
+	LINK_DIAGONAL_XMIN_YMIN, LINK_NEIGHBOUR_YMIN, LINK_DIAGONAL_XMAX_YMIN,
+	LINK_NEIGHBOUR_XMIN, 0, LINK_NEIGHBOUR_XMAX,
+	LINK_DIAGONAL_XMIN_YMAX, LINK_NEIGHBOUR_YMAX, LINK_DIAGONAL_XMAX_YMAX
+};
+
+// whether the spring between two neighbouring particles is intact,
+// e.g. an edge of a triangle of the grid
+bool IsLinked(StructuredBuffer<uint> links, in uint id0, in uint id1, in uint resolution)
+{
+	int dx = int(id1 % resolution) - int(id0 % resolution);
+	int dy = int(id1 / resolution) - int(id0 / resolution);
+	return (links[id0] & STENCIL_LINKS[(dx + 1) + (dy + 1) * 3]) != 0;
+}
+#endif
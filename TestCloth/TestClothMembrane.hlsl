@@ -0,0 +1,79 @@
+#include "TestClothLinks.hlsli"
+#include "TestClothSolver.hlsli"
+
+StructuredBuffer<float4> PositionsFrom : register(t0);
+StructuredBuffer<float4> VelocitiesFrom : register(t1);
+StructuredBuffer<float4> TriangleInvRest : register(t2);
+StructuredBuffer<float> TriangleArea : register(t3);
+StructuredBuffer<uint> LinksFrom : register(t4);
+
+// vertex forces in SoA order: slot * NumTriangles + triangle
+RWStructuredBuffer<float4> TriangleForces : register(u0);
+
+// StVK membrane with orthotropic (warp / weft / shear) stiffness.
+// forces are gathered per particle by TestClothUpdate.hlsl,
+// so no atomics are needed.
+[numthreads(64, 1, 1)]
+void main(uint3 threadID : SV_DispatchThreadID)
+{
+	uint numTriangles = GetNumTriangles();
+	uint tri = threadID.x;
+	if (tri >= numTriangles)
+	{
+		return;
+	}
+
+	uint quad = tri / 2;
+	uint q = quad % (ClothResolution.x - 1) + quad / (ClothResolution.x - 1) * ClothResolution.x;
+	uint3 ids = (tri & 1) == 0 ?
+		uint3(q, q + 1, q + 1 + ClothResolution.x) :
+		uint3(q, q + 1 + ClothResolution.x, q + ClothResolution.x);
+
+	// a torn edge splits the triangle, which no longer resists stretch
+	if (!IsLinked(LinksFrom, ids.x, ids.y, ClothResolution.x) ||
+		!IsLinked(LinksFrom, ids.y, ids.z, ClothResolution.x) ||
+		!IsLinked(LinksFrom, ids.z, ids.x, ClothResolution.x))
+	{
+		TriangleForces[tri] = float4(0.0f, 0.0f, 0.0f, 0.0f);
+		TriangleForces[numTriangles + tri] = float4(0.0f, 0.0f, 0.0f, 0.0f);
+		TriangleForces[numTriangles * 2 + tri] = float4(0.0f, 0.0f, 0.0f, 0.0f);
+		return;
+	}
+
+	float3 x0 = PositionsFrom[ids.x].xyz;
+	float3 v0 = VelocitiesFrom[ids.x].xyz;
+	float3x2 Ds = transpose(float2x3(
+		PositionsFrom[ids.y].xyz - x0,
+		PositionsFrom[ids.z].xyz - x0));
+	float3x2 Dv = transpose(float2x3(
+		VelocitiesFrom[ids.y].xyz - v0,
+		VelocitiesFrom[ids.z].xyz - v0));
+
+	float4 invRest = TriangleInvRest[tri];
+	float2x2 DmInv = float2x2(invRest.xy, invRest.zw);
+
+	// deformation gradient and its rate; columns are warp and weft directions
+	float3x2 F = mul(Ds, DmInv);
+	float3x2 Fdot = mul(Dv, DmInv);
+
+	// Green strain and strain rate
+	float2x2 FtF = mul(transpose(F), F);
+	float2x2 E = 0.5f * (FtF - float2x2(1.0f, 0.0f, 0.0f, 1.0f));
+	float2x2 FtFdot = mul(transpose(F), Fdot);
+	float2x2 Edot = 0.5f * (FtFdot + transpose(FtFdot));
+
+	// second Piola-Kirchhoff stress
+	float2x2 S = float2x2(
+		TriangleMembrane.warpStiffness * E._11, TriangleMembrane.shearStiffness * E._12,
+		TriangleMembrane.shearStiffness * E._21, TriangleMembrane.weftStiffness * E._22);
+	S += TriangleMembrane.damping * Edot;
+
+	// forces on the second and third vertex; the first balances them
+	float3x2 H = -TriangleArea[tri] * mul(mul(F, S), transpose(DmInv));
+	float3 f1 = float3(H._11, H._21, H._31);
+	float3 f2 = float3(H._12, H._22, H._32);
+
+	TriangleForces[tri] = float4(-f1 - f2, 0.0f);
+	TriangleForces[numTriangles + tri] = float4(f1, 0.0f);
+	TriangleForces[numTriangles * 2 + tri] = float4(f2, 0.0f);
+}
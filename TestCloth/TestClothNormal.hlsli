@@ -0,0 +1,43 @@
+// normal of a particle from the quads around it, used by the update and by
+// playback. requires ComposeID() and ClothResolution of TestClothSolver.hlsli.
+float4 ComputeNormal(StructuredBuffer<float4> positions, uint2 id2D)
+{
+	uint id = ComposeID(id2D);
+
+	const uint X_NOT_MIN = id2D.x > 0;
+	const uint Y_NOT_MIN = id2D.y > 0;
+	const uint X_NOT_MAX = id2D.x < ClothResolution.x - 1;
+	const uint Y_NOT_MAX = id2D.y < ClothResolution.y - 1;
+
+	float4 normal = float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	if (X_NOT_MIN && Y_NOT_MIN)
+	{
+		normal.xyz += cross(
+			positions[id - 1].xyz - positions[id].xyz,
+			positions[id - ClothResolution.x].xyz - positions[id].xyz);
+	}
+
+	if (X_NOT_MAX && Y_NOT_MIN)
+	{
+		normal.xyz += cross(
+			positions[id - ClothResolution.x].xyz - positions[id].xyz,
+			positions[id + 1].xyz - positions[id].xyz);
+	}
+
+	if (X_NOT_MAX && Y_NOT_MAX)
+	{
+		normal.xyz += cross(
+			positions[id + 1].xyz - positions[id].xyz,
+			positions[id + ClothResolution.x].xyz - positions[id].xyz);
+	}
+
+	if (X_NOT_MIN && Y_NOT_MAX)
+	{
+		normal.xyz += cross(
+			positions[id + ClothResolution.x].xyz - positions[id].xyz,
+			positions[id - 1].xyz - positions[id].xyz);
+	}
+
+	return -normalize(normal);
+}
@@ -0,0 +1,18 @@
+#include "TestClothSolver.hlsli"
+#include "TestClothNormal.hlsli"
+
+StructuredBuffer<float4> Positions : register(t0);
+RWStructuredBuffer<float4> Normals : register(u0);
+
+// normals of positions which were not simulated, e.g. played back from a cache
+[numthreads(128, 2, 1)]
+void main(uint3 threadID : SV_DispatchThreadID)
+{
+	// the grid is dispatched in whole groups, skip threads beyond it
+	if (any(threadID.xy >= ClothResolution))
+	{
+		return;
+	}
+
+	Normals[ComposeID(threadID.xy)] = ComputeNormal(Positions, threadID.xy);
+}
@@ -1,12 +1,21 @@
 #include "stdafx.h"
 #include "TestClothObject.h"
 #include "Globals.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+#include "TestClothCache.h"
+#include "TestClothSnapshot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 namespace
 {
-	const int NDIM_HORIZONTAL = 128;
-	const int NDIM_VERTICAL = 128;
-
 	struct SpringCS
 	{
 		float stiffness;
@@ -15,6 +24,14 @@ namespace
 		float dummy;
 	};
 
+	struct MembraneCS
+	{
+		float warpStiffness;
+		float weftStiffness;
+		float shearStiffness;
+		float damping;
+	};
+
 	struct CB_TEST_CLOTH_UPDATE
 	{
 		SpringCS Neighbour;
@@ -22,12 +39,439 @@ namespace
 		SpringCS Bending;
 		DirectX::XMUINT2 ClothResolution;
 		float TimeStep;
+		float TearStrain;
+		float StrainLimit;
+		DirectX::XMFLOAT3 dummy;
+		MembraneCS TriangleMembrane;
+	};
+
+	struct StretchedEdgeCS
+	{
+		std::uint32_t id0;
+		std::uint32_t id1;
+		float maxLength;
+		float dummy;
+	};
+
+	struct PinnedParticleCS
+	{
+		std::uint32_t id;
+		std::uint32_t attachment;
+		DirectX::XMUINT2 dummy;
+		DirectX::XMFLOAT4 localPosition;
+	};
+
+	// see TestClothCollide.hlsl
+	struct ColliderCS
+	{
+		DirectX::XMFLOAT4 shape;
+		std::uint32_t type;
+		DirectX::XMUINT3 dummy;
+	};
+
+	struct HingeCS
+	{
+		DirectX::XMUINT4 ids;
+		float restSinHalfAngle;
+		DirectX::XMFLOAT3 dummy;
+	};
+
+	struct CB_TEST_CLOTH_HINGE
+	{
+		std::uint32_t NumHinges;
+		DirectX::XMUINT3 dummy;
+	};
+
+	struct CB_TEST_CLOTH_ATTACH
+	{
+		std::uint32_t NumPinnedParticles;
+		float TimeStep;
+		DirectX::XMUINT2 dummy;
+	};
+
+	struct CB_TEST_CLOTH_UPSAMPLE
+	{
+		DirectX::XMUINT2 ClothResolution;
+		DirectX::XMUINT2 RenderResolution;
+		float RenderAlpha;
+		float RestLength;
+		float WrinkleAmplitude;
 		float dummy;
 	};
+
+	struct CB_TEST_CLOTH_RESAMPLE
+	{
+		DirectX::XMUINT2 SourceResolution;
+		DirectX::XMUINT2 TargetResolution;
+	};
+
+	// corners of the cloth written by TestClothInit.hlsl, see Desc::Corners
+	void GetInitialCorners(const TestCloth::Desc& desc, DirectX::XMFLOAT4 (&corners)[4])
+	{
+		if (!desc.Corners.empty())
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				const auto& corner = desc.Corners[i];
+				corners[i] = DirectX::XMFLOAT4(corner.x, corner.y, corner.z, 1.0f);
+			}
+			return;
+		}
+
+		float SQRT2 = std::sqrtf(2.0f);
+		corners[0] = DirectX::XMFLOAT4(-1.0f, 1.0f, 0.0f, 1.0f);
+		corners[1] = DirectX::XMFLOAT4( 1.0f, 1.0f, 0.0f, 1.0f);
+		corners[2] = DirectX::XMFLOAT4(-1.0f, SQRT2 - 1.0f, SQRT2, 1.0f);
+		corners[3] = DirectX::XMFLOAT4( 1.0f, SQRT2 - 1.0f, SQRT2, 1.0f);
+	}
+
+	// CPU counterpart of the interpolation in TestClothInit.hlsl
+	DirectX::XMVECTOR GetInitialPosition(const TestCloth::Desc& desc,
+		std::uint32_t id, std::uint32_t resolution)
+	{
+		DirectX::XMFLOAT4 corners[4];
+		GetInitialCorners(desc, corners);
+
+		float fx = static_cast<float>(id % resolution) / (resolution - 1);
+		float fy = static_cast<float>(id / resolution) / (resolution - 1);
+
+		return DirectX::XMVectorLerp(
+			DirectX::XMVectorLerp(DirectX::XMLoadFloat4(&corners[0]),
+				DirectX::XMLoadFloat4(&corners[1]), fx),
+			DirectX::XMVectorLerp(DirectX::XMLoadFloat4(&corners[2]),
+				DirectX::XMLoadFloat4(&corners[3]), fx),
+			fy);
+	}
+
+	// triangles of the grid, numbered and wound as in TestClothSolver.hlsli
+	std::vector<DirectX::XMUINT3> GetGridTriangles(std::uint32_t resolution)
+	{
+		std::vector<DirectX::XMUINT3> triangles;
+		triangles.reserve(2 * (resolution - 1) * (resolution - 1));
+
+		for (std::uint32_t qy = 0; qy < resolution - 1; qy++)
+		{
+			for (std::uint32_t qx = 0; qx < resolution - 1; qx++)
+			{
+				std::uint32_t q = qx + qy * resolution;
+				triangles.push_back(DirectX::XMUINT3(q, q + 1, q + 1 + resolution));
+				triangles.push_back(DirectX::XMUINT3(q, q + 1 + resolution, q + resolution));
+			}
+		}
+
+		return triangles;
+	}
+
+	// signed sin(angle / 2) of a hinge, as evaluated in TestClothHinge.hlsl
+	float GetHingeSinHalfAngle(const TestCloth::Desc& desc,
+		const DirectX::XMUINT4& ids, std::uint32_t resolution)
+	{
+		using namespace DirectX;
+		XMVECTOR x0 = GetInitialPosition(desc, ids.x, resolution);
+		XMVECTOR x1 = GetInitialPosition(desc, ids.y, resolution);
+		XMVECTOR x2 = GetInitialPosition(desc, ids.z, resolution);
+		XMVECTOR x3 = GetInitialPosition(desc, ids.w, resolution);
+
+		XMVECTOR n1 = XMVector3Normalize(XMVector3Cross(x0 - x2, x0 - x3));
+		XMVECTOR n2 = XMVector3Normalize(XMVector3Cross(x1 - x3, x1 - x2));
+		float cosAngle = XMVectorGetX(XMVector3Dot(n1, n2));
+		float sinHalfAngle = std::sqrt(std::max(0.0f, 0.5f * (1.0f - cosAngle)));
+
+		return XMVectorGetX(XMVector3Dot(XMVector3Cross(n1, n2), x3 - x2)) < 0.0f ?
+			-sinHalfAngle : sinHalfAngle;
+	}
+
+	// inverse of ToOrderedUint() in TestClothBounds.hlsl
+	float FromOrderedUint(std::uint32_t value)
+	{
+		std::uint32_t bits = (value & 0x80000000) ? (value & 0x7fffffff) : ~value;
+		float result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	DirectX::XMMATRIX GetAttachmentTransform(const TestCloth::Attachment& attachment)
+	{
+		return attachment.Transform ? attachment.Transform() : DirectX::XMMatrixIdentity();
+	}
+
+	// particle of another grid resolution nearest in uv space
+	std::uint32_t ResampleParticleId(std::uint32_t id,
+		std::uint32_t resolutionFrom, std::uint32_t resolutionTo)
+	{
+		auto resample = [=](std::uint32_t coord)
+		{
+			return (coord * (resolutionTo - 1) + (resolutionFrom - 1) / 2) / (resolutionFrom - 1);
+		};
+
+		return resample(id % resolutionFrom) + resample(id / resolutionFrom) * resolutionTo;
+	}
+
+	// desc of a level of detail, with attachments moved to its grid.
+	// the solver takes forces per unit mass, and a coarse particle carries
+	// the mass of (fine / coarse)^2 fine ones. the stiffness of the spring
+	// grid, the triangles and the hinges does not depend on the cell size, so
+	// dividing stiffness and damping by that ratio keeps the material.
+	TestCloth::Desc MakeLevelDesc(const TestCloth::Desc& desc, std::uint32_t resolution)
+	{
+		auto levelDesc = desc;
+		levelDesc.Resolution = resolution;
+
+		float ratio = static_cast<float>(desc.Resolution) / resolution;
+		float invMassScale = 1.0f / (ratio * ratio);
+		for (auto pSpring : { &levelDesc.Neighbour, &levelDesc.Diagonal,
+			&levelDesc.Bending, &levelDesc.Hinge })
+		{
+			pSpring->Stiffness *= invMassScale;
+			pSpring->Damping *= invMassScale;
+		}
+		levelDesc.Triangles.WarpStiffness *= invMassScale;
+		levelDesc.Triangles.WeftStiffness *= invMassScale;
+		levelDesc.Triangles.ShearStiffness *= invMassScale;
+		levelDesc.Triangles.Damping *= invMassScale;
+
+		for (auto& attachment : levelDesc.Attachments)
+		{
+			auto& particles = attachment.Particles;
+			for (auto& id : particles)
+			{
+				id = ResampleParticleId(id, desc.Resolution, resolution);
+			}
+
+			// neighbouring particles may fall on the same coarse particle
+			std::sort(particles.begin(), particles.end());
+			particles.erase(std::unique(particles.begin(), particles.end()), particles.end());
+		}
+
+		return levelDesc;
+	}
+
+	// bytecode of the shaders compiled so far, by file, target and defines.
+	// every cloth creates the same few shaders, so that scenes of many
+	// cloths compile each of them once.
+	std::mutex g_ShaderCacheMutex;
+	std::unordered_map<std::wstring, ComPtr<ID3DBlob>> g_ShaderCache;
+
+	// compile the main function of a shader file, null if it fails
+	ComPtr<ID3DBlob> CompileShader(const wchar_t* fileName, const char* target,
+		const D3D_SHADER_MACRO* pDefines = nullptr)
+	{
+		std::wstring key = fileName;
+		key.append(L"|").append(target, target + std::strlen(target));
+		for (auto pDefine = pDefines; pDefine && pDefine->Name; pDefine++)
+		{
+			key.append(L"|").append(pDefine->Name, pDefine->Name + std::strlen(pDefine->Name));
+			key.append(L"=").append(pDefine->Definition,
+				pDefine->Definition + std::strlen(pDefine->Definition));
+		}
+
+		std::lock_guard<std::mutex> lock(g_ShaderCacheMutex);
+		auto found = g_ShaderCache.find(key);
+		if (found != g_ShaderCache.end())
+		{
+			return found->second;
+		}
+
+		ID3DBlob* pCode;
+		if (FAILED(DXUTCompileFromFile(fileName, pDefines, "main", target, 0, 0, &pCode)))
+		{
+			return nullptr;
+		}
+		ComPtr<ID3DBlob> code(pCode, false);
+		g_ShaderCache[key] = code;
+		return code;
+	}
+
+	void CreateStagingBuffer(UINT byteWidth, ComPtr<ID3D11Buffer>& buffer)
+	{
+		D3D11_BUFFER_DESC bufferDesc;
+		ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+		bufferDesc.Usage = D3D11_USAGE_STAGING;
+		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+		bufferDesc.ByteWidth = byteWidth;
+
+		ID3D11Buffer* pBuffer;
+		if (FAILED(DXUTGetD3D11Device()->CreateBuffer(&bufferDesc, nullptr, &pBuffer)))
+		{
+			throw std::runtime_error("Failed to create buffer");
+		}
+		ComPtr<ID3D11Buffer>(pBuffer, false).swap(buffer);
+	}
+
+	// staging copies of GPU buffers, read back a few frames later without
+	// stalling in the order they were made. copies are skipped while all
+	// slots are in flight.
+	class ReadbackRing
+	{
+	public:
+		static const std::uint32_t NUM_SLOTS = 4;
+		static const std::uint32_t MAX_BUFFERS = 3;
+
+		// staging buffers of the given sizes in every slot
+		void Initialize(const UINT* pSizes, std::uint32_t numBuffers)
+		{
+			for (auto& slot : m_Slots)
+			{
+				for (std::uint32_t i = 0; i < numBuffers; i++)
+				{
+					CreateStagingBuffer(pSizes[i], slot.Buffers[i]);
+				}
+			}
+			m_NumBuffers = numBuffers;
+		}
+
+		bool IsInitialized() const { return m_NumBuffers > 0; }
+
+		// copy the sources, one per buffer, into the next slot.
+		// returns false if all slots are in flight.
+		bool Copy(ID3D11DeviceContext* pCTX, ID3D11Buffer* const* ppSources, std::uint64_t step)
+		{
+			auto& slot = m_Slots[m_iWrite];
+			if (slot.Pending)
+			{
+				return false;
+			}
+
+			for (std::uint32_t i = 0; i < m_NumBuffers; i++)
+			{
+				pCTX->CopyResource(slot.Buffers[i].get(), ppSources[i]);
+			}
+			slot.Step = step;
+			slot.Pending = true;
+			m_iWrite = (m_iWrite + 1) % NUM_SLOTS;
+			return true;
+		}
+
+		// call read(step, ppData) with the oldest copy, if it reached the CPU
+		// or after waiting for it. returns false if there is none.
+		template <typename Read>
+		bool ReadNext(ID3D11DeviceContext* pCTX, bool wait, Read read)
+		{
+			auto& slot = m_Slots[m_iRead];
+			if (!slot.Pending)
+			{
+				return false;
+			}
+
+			// the copies complete in order, so the last one is mapped first
+			const void* pData[MAX_BUFFERS];
+			D3D11_MAPPED_SUBRESOURCE subres;
+			auto iLast = m_NumBuffers - 1;
+			if (pCTX->Map(slot.Buffers[iLast].get(), 0, D3D11_MAP_READ,
+				wait ? 0 : D3D11_MAP_FLAG_DO_NOT_WAIT, &subres) != S_OK)
+			{
+				return false;
+			}
+			pData[iLast] = subres.pData;
+
+			for (std::uint32_t i = 0; i < iLast; i++)
+			{
+				if (FAILED(pCTX->Map(slot.Buffers[i].get(), 0, D3D11_MAP_READ, 0, &subres)))
+				{
+					Unmap(pCTX, slot, 0, i);
+					pCTX->Unmap(slot.Buffers[iLast].get(), 0);
+					throw std::runtime_error("Failed to map buffer");
+				}
+				pData[i] = subres.pData;
+			}
+
+			// the copy is used up even if read fails, so that it is not read again
+			slot.Pending = false;
+			m_iRead = (m_iRead + 1) % NUM_SLOTS;
+			try
+			{
+				read(slot.Step, pData);
+			}
+			catch (...)
+			{
+				Unmap(pCTX, slot, 0, m_NumBuffers);
+				throw;
+			}
+			Unmap(pCTX, slot, 0, m_NumBuffers);
+			return true;
+		}
+
+		// forget the copies in flight
+		void Discard()
+		{
+			for (auto& slot : m_Slots)
+			{
+				slot.Pending = false;
+			}
+			m_iRead = m_iWrite;
+		}
+
+	private:
+		struct Slot
+		{
+			ComPtr<ID3D11Buffer> Buffers[MAX_BUFFERS];
+			std::uint64_t Step = 0;
+			bool Pending = false;
+		};
+
+		static void Unmap(ID3D11DeviceContext* pCTX, const Slot& slot,
+			std::uint32_t begin, std::uint32_t end)
+		{
+			for (auto i = begin; i < end; i++)
+			{
+				pCTX->Unmap(slot.Buffers[i].get(), 0);
+			}
+		}
+
+		Slot m_Slots[NUM_SLOTS];
+		std::uint32_t m_NumBuffers = 0;
+		std::uint32_t m_iWrite = 0;
+		std::uint32_t m_iRead = 0;
+	};
+
+	// operations of the free functions in TestClothObject.h, shared by cloths
+	// with and without levels of detail
+	class ClothControl
+	{
+	public:
+		virtual void SaveSnapshot(const std::wstring& fileName) const = 0;
+		virtual void StartRecording(const std::wstring& fileName) = 0;
+		virtual void StopRecording() = 0;
+		virtual void StartPlayback(const std::wstring& fileName) = 0;
+		virtual void StopPlayback() = 0;
+		virtual void SeekPlayback(double numSteps) = 0;
+		virtual void StartExport(const std::wstring& fileNamePrefix, TestCloth::ExportFormat format) = 0;
+		virtual void StopExport() = 0;
+
+	protected:
+		~ClothControl() {}
+	};
+
+	ClothControl& GetClothControl(const ObjectHandle& object)
+	{
+		auto pControl = dynamic_cast<ClothControl*>(object.get());
+		if (!pControl)
+		{
+			throw std::runtime_error("Object is not a cloth");
+		}
+		return *pControl;
+	}
 }
 
-class TestClothObject : public Object
+class TestClothObject : public BatchedObject<TestClothObject>, public ClothControl
 {
+	friend class BatchedObject<TestClothObject>;
+
+public:
+	// render grid of Desc::RenderResolution, see TestClothUpsample.hlsl
+	struct DetailBuffers
+	{
+		ComPtr<ID3D11ShaderResourceView> PositionSRV;
+		ComPtr<ID3D11UnorderedAccessView> PositionUAV;
+		ComPtr<ID3D11ShaderResourceView> NormalSRV;
+		ComPtr<ID3D11UnorderedAccessView> NormalUAV;
+		ComPtr<ID3D11ShaderResourceView> LinkSRV;
+		ComPtr<ID3D11UnorderedAccessView> LinkUAV;
+		ComPtr<ID3D11Buffer> PositionBuffer;
+		ComPtr<ID3D11Buffer> NormalBuffer;
+		ComPtr<ID3D11Buffer> LinkBuffer;
+	};
+
 private:
 	struct SimulationBuffers
 	{
@@ -35,8 +479,11 @@ private:
 		ComPtr<ID3D11UnorderedAccessView> ClothPositionUAV;
 		ComPtr<ID3D11ShaderResourceView> ClothVelocitySRV;
 		ComPtr<ID3D11UnorderedAccessView> ClothVelocityUAV;
+		ComPtr<ID3D11ShaderResourceView> ClothLinkSRV;
+		ComPtr<ID3D11UnorderedAccessView> ClothLinkUAV;
 		ComPtr<ID3D11Buffer> ClothPositionBuffer;
 		ComPtr<ID3D11Buffer> ClothVelocityBuffer;
+		ComPtr<ID3D11Buffer> ClothLinkBuffer;
 	};
 
 	struct CB_TEST_CLOTH
@@ -44,10 +491,17 @@ private:
 		DirectX::XMMATRIX WorldView;
 		DirectX::XMMATRIX Projection;
 		DirectX::XMUINT2 ClothResolution;
-		DirectX::XMUINT2 dummy;
+		float RenderAlpha;
+		float dummy;
 	};
 
-	static void InitializeBuffers(SimulationBuffers& buffers)
+	// one thread per particle, in groups of 128x2 (see TestClothUpdate.hlsl)
+	void DispatchGrid(ID3D11DeviceContext* pCTX) const
+	{
+		pCTX->Dispatch((m_Resolution + 127) / 128, (m_Resolution + 1) / 2, 1);
+	}
+
+	void InitializeBuffers(SimulationBuffers& buffers)
 	{
 		HRESULT hr;
 		D3D11_BUFFER_DESC bufferDesc;
@@ -64,7 +518,7 @@ private:
 
 		// buffer for vertices
 		bufferDesc.ByteWidth = sizeof(DirectX::XMFLOAT4) *
-			NDIM_HORIZONTAL * NDIM_VERTICAL;
+			m_Resolution * m_Resolution;
 		bufferDesc.StructureByteStride = sizeof(DirectX::XMFLOAT4);
 		hr = DXUTGetD3D11Device()->CreateBuffer(&bufferDesc, nullptr, &pBuffer);
 		if (FAILED(hr))
@@ -88,7 +542,7 @@ private:
 		ZeroMemory(&srvDesc, sizeof(srvDesc));
 		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
 		srvDesc.Buffer.FirstElement = 0;
-		srvDesc.Buffer.NumElements = NDIM_HORIZONTAL * NDIM_VERTICAL;
+		srvDesc.Buffer.NumElements = m_Resolution * m_Resolution;
 		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
 		ID3D11ShaderResourceView* pSRV;
 
@@ -98,7 +552,7 @@ private:
 		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
 		uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
 		uavDesc.Buffer.FirstElement = 0;
-		uavDesc.Buffer.NumElements = NDIM_HORIZONTAL * NDIM_VERTICAL;
+		uavDesc.Buffer.NumElements = m_Resolution * m_Resolution;
 		ID3D11UnorderedAccessView* pUAV;
 
 		// positions
@@ -138,401 +592,1972 @@ private:
 		}
 		ComPtr<ID3D11UnorderedAccessView>(pUAV, false)
 			.swap(buffers.ClothVelocityUAV);
-	}
-
-	static void InitializePositions(ComPtr<ID3D11UnorderedAccessView>)
-	{
-	}
-
-	static void InitializeVelocities(ComPtr<ID3D11UnorderedAccessView>)
-	{
-	}
-
-	void UpdateBuffer(const SimulationBuffers& buffersFrom,
-		SimulationBuffers& buffersTo)
-	{
-		CB_TEST_CLOTH_UPDATE cbTestCloth;
-		cbTestCloth.Neighbour.stiffness = m_desc.Neighbour.Stiffness;
-		cbTestCloth.Neighbour.damping = m_desc.Neighbour.Damping;
-		cbTestCloth.Neighbour.restLength = 2.0f / (NDIM_HORIZONTAL - 1);
-
-		cbTestCloth.Diagonal.stiffness = m_desc.Diagonal.Stiffness;
-		cbTestCloth.Diagonal.damping = m_desc.Diagonal.Damping;
-		cbTestCloth.Diagonal.restLength = 2.0f * std::sqrtf(2.0f) / (NDIM_HORIZONTAL - 1);
-
-		cbTestCloth.Bending.stiffness = m_desc.Bending.Stiffness;
-		cbTestCloth.Bending.damping = m_desc.Bending.Damping;
-		cbTestCloth.Bending.restLength = 4.0f / (NDIM_HORIZONTAL - 1);
-
-		cbTestCloth.ClothResolution.x = NDIM_HORIZONTAL;
-		cbTestCloth.ClothResolution.y = NDIM_VERTICAL;
-		cbTestCloth.TimeStep = m_desc.TimeStep;
 
-		auto pCTX = DXUTGetD3D11DeviceContext();
-		D3D11_MAPPED_SUBRESOURCE subres;
-		ZeroMemory(&subres, sizeof(subres));
-		if (FAILED(pCTX->Map(m_pUpdateConstants.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &subres)))
+		// buffer for link masks (see TestClothLinks.hlsli)
+		bufferDesc.ByteWidth = sizeof(std::uint32_t) *
+			m_Resolution * m_Resolution;
+		bufferDesc.StructureByteStride = sizeof(std::uint32_t);
+		hr = DXUTGetD3D11Device()->CreateBuffer(&bufferDesc, nullptr, &pBuffer);
+		if (FAILED(hr))
 		{
-			throw std::runtime_error("Failed to map constant buffer for update cloth");
+			throw std::runtime_error("Failed to create buffer");
 		}
-		memcpy(subres.pData, &cbTestCloth, sizeof(cbTestCloth));
-		pCTX->Unmap(m_pUpdateConstants.get(), 0);
+		ComPtr<ID3D11Buffer>(pBuffer, false)
+			.swap(buffers.ClothLinkBuffer);
 
-		ID3D11ShaderResourceView* pSRVs[2] =
+		hr = DXUTGetD3D11Device()->CreateShaderResourceView(buffers.ClothLinkBuffer.get(),
+			&srvDesc, &pSRV);
+		if (FAILED(hr))
 		{
-			buffersFrom.ClothPositionSRV.get(),
-			buffersFrom.ClothVelocitySRV.get(),
-		};
+			throw std::runtime_error("Failed to create SRV");
+		}
+		ComPtr<ID3D11ShaderResourceView>(pSRV, false)
+			.swap(buffers.ClothLinkSRV);
 
-		ID3D11UnorderedAccessView* pUAVs[3] =
+		hr = DXUTGetD3D11Device()->CreateUnorderedAccessView(buffers.ClothLinkBuffer.get(),
+			&uavDesc, &pUAV);
+		if (FAILED(hr))
 		{
-			buffersTo.ClothPositionUAV.get(),
-			buffersTo.ClothVelocityUAV.get(),
-			m_pClothNormalUAV.get(),
-		};
-
-		ID3D11Buffer* pConstants = m_pUpdateConstants.get();
-
-		pCTX->CSSetShader(m_pUpdateShader.get(), nullptr, 0);
-		pCTX->CSSetShaderResources(0, 2, pSRVs);
-		pCTX->CSSetUnorderedAccessViews(0, 3, pUAVs, nullptr);
-		pCTX->CSSetConstantBuffers(0, 1, &pConstants);
-
-		pCTX->Dispatch(1, 64, 1);
-
-		pSRVs[0] = nullptr;
-		pSRVs[1] = nullptr;
-		pUAVs[0] = nullptr;
-		pUAVs[1] = nullptr;
-		pUAVs[2] = nullptr;
-
-		pCTX->CSSetShaderResources(0, 2, pSRVs);
-		pCTX->CSSetUnorderedAccessViews(0, 3, pUAVs, nullptr);
+			throw std::runtime_error("Failed to create UAV");
+		}
+		ComPtr<ID3D11UnorderedAccessView>(pUAV, false)
+			.swap(buffers.ClothLinkUAV);
 	}
 
-	void InitializeVertexShader()
+	// compile compute shader from file
+	static ComPtr<ID3D11ComputeShader> CreateComputeShader(const wchar_t* fileName,
+		const D3D_SHADER_MACRO* pDefines = nullptr)
 	{
-		// VS
-		ID3DBlob* pShaderCode;
-		if (FAILED(DXUTCompileFromFile(L"TestClothVS.hlsl", nullptr, "main",
-			"vs_4_0", 0, 0,
-			&pShaderCode)))
+		auto pShaderBuffer = CompileShader(fileName, "cs_5_0", pDefines);
+		if (!pShaderBuffer)
 		{
-			throw std::runtime_error("Failed to compile vertex shader");
+			throw std::runtime_error("Failed to compile compute shader");
 		}
 
-		ID3D11VertexShader* pVS;
-		if (FAILED(DXUTGetD3D11Device()->CreateVertexShader(pShaderCode->GetBufferPointer(),
-			pShaderCode->GetBufferSize(), nullptr, &pVS)))
+		ID3D11ComputeShader* pShader;
+		if (FAILED(DXUTGetD3D11Device()->CreateComputeShader(pShaderBuffer->GetBufferPointer(),
+			pShaderBuffer->GetBufferSize(), nullptr, &pShader)))
 		{
-			pShaderCode->Release();
-			throw std::runtime_error("Failed to create vertex shader");
+			throw std::runtime_error("Failed to create compute shader");
 		}
 
-		pShaderCode->Release();
-
-		ComPtr<ID3D11VertexShader>(pVS, false)
-			.swap(m_pTestClothVS);
+		return ComPtr<ID3D11ComputeShader>(pShader, false);
 	}
 
-	void InitializeGeometryShader()
+	// create constant buffer.
+	// dynamic buffers are writable from CPU with D3D11_MAP_WRITE_DISCARD.
+	static ComPtr<ID3D11Buffer> CreateConstantBuffer(UINT byteWidth, bool dynamic)
 	{
-		// GS
-		ID3DBlob* pShaderCode;
-		if (FAILED(DXUTCompileFromFile(L"TestClothGS.hlsl", nullptr, "main",
-			"gs_4_0", 0, 0, &pShaderCode)))
-		{
-			throw std::runtime_error("Failed to compile geometry shader");
-		}
+		D3D11_BUFFER_DESC constBufDesc;
+		ZeroMemory(&constBufDesc, sizeof(constBufDesc));
+		constBufDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		constBufDesc.CPUAccessFlags = dynamic ? D3D11_CPU_ACCESS_WRITE : 0;
+		constBufDesc.ByteWidth = byteWidth;
+		constBufDesc.Usage = dynamic ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
 
-		ID3D11GeometryShader* pGS;
-		if (FAILED(DXUTGetD3D11Device()->CreateGeometryShader(pShaderCode->GetBufferPointer(),
-			pShaderCode->GetBufferSize(), nullptr, &pGS)))
+		ID3D11Buffer* pConstBuffer = nullptr;
+		if (FAILED(DXUTGetD3D11Device()->CreateBuffer(&constBufDesc,
+			nullptr, &pConstBuffer)))
 		{
-			pShaderCode->Release();
-			throw std::runtime_error("Failed to create geometry shader");
+			throw std::runtime_error("Failed to create constant buffer");
 		}
 
-		pShaderCode->Release();
-
-		ComPtr<ID3D11GeometryShader>(pGS, false)
-			.swap(m_pTestClothGS);
+		return ComPtr<ID3D11Buffer>(pConstBuffer, false);
 	}
 
-	void InitializePixelShader()
+	// create raw buffer writable from shaders, cleared to zero.
+	static void CreateRawBufferUAV(UINT byteWidth, UINT miscFlags,
+		ComPtr<ID3D11Buffer>& buffer, ComPtr<ID3D11UnorderedAccessView>& uav)
 	{
-		// PS
-		ID3DBlob* pShaderCode;
-		if (FAILED(DXUTCompileFromFile(L"TestClothPS.hlsl", nullptr,
-			"main", "ps_4_0", 0, 0, &pShaderCode)))
-		{
-			throw std::runtime_error("Failed to compile pixel shader");
-		}
+		D3D11_BUFFER_DESC bufferDesc;
+		ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+		bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+		bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS | miscFlags;
+		bufferDesc.ByteWidth = byteWidth;
 
-		ID3D11PixelShader* pPS;
-		if (FAILED(DXUTGetD3D11Device()->CreatePixelShader(pShaderCode->GetBufferPointer(),
-			pShaderCode->GetBufferSize(), nullptr, &pPS)))
+		std::vector<std::uint8_t> zeros(byteWidth, 0);
+		D3D11_SUBRESOURCE_DATA subresData;
+		ZeroMemory(&subresData, sizeof(subresData));
+		subresData.pSysMem = zeros.data();
+
+		ID3D11Buffer* pBuffer;
+		if (FAILED(DXUTGetD3D11Device()->CreateBuffer(&bufferDesc, &subresData, &pBuffer)))
 		{
-			pShaderCode->Release();
-			throw std::runtime_error("Failed to create pixel shader");
+			throw std::runtime_error("Failed to create buffer");
 		}
+		ComPtr<ID3D11Buffer>(pBuffer, false).swap(buffer);
 
-		pShaderCode->Release();
-
-		ComPtr<ID3D11PixelShader>(pPS, false)
-			.swap(m_pTestClothPS);
+		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+		ZeroMemory(&uavDesc, sizeof(uavDesc));
+		uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+		uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+		uavDesc.Buffer.FirstElement = 0;
+		uavDesc.Buffer.NumElements = byteWidth / 4;
+		uavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+
+		ID3D11UnorderedAccessView* pUAV;
+		if (FAILED(DXUTGetD3D11Device()->CreateUnorderedAccessView(pBuffer, &uavDesc, &pUAV)))
+		{
+			throw std::runtime_error("Failed to create UAV");
+		}
+		ComPtr<ID3D11UnorderedAccessView>(pUAV, false).swap(uav);
 	}
 
-	void InitializeConstantBuffer()
+	// create structured buffer readable and writable from shaders
+	static void CreateStructuredBufferUAV(UINT stride, UINT numElements,
+		ComPtr<ID3D11Buffer>& buffer, ComPtr<ID3D11ShaderResourceView>& srv,
+		ComPtr<ID3D11UnorderedAccessView>& uav)
 	{
-		HRESULT hr;
-
-		D3D11_BUFFER_DESC constBufDesc;
-		ZeroMemory(&constBufDesc, sizeof(constBufDesc));
-		constBufDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		constBufDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-		constBufDesc.ByteWidth = sizeof(CB_TEST_CLOTH);
-		constBufDesc.Usage = D3D11_USAGE_DYNAMIC;
+		D3D11_BUFFER_DESC bufferDesc;
+		ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+		bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS |
+			D3D11_BIND_SHADER_RESOURCE;
+		bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bufferDesc.ByteWidth = stride * numElements;
+		bufferDesc.StructureByteStride = stride;
 
-		ID3D11Buffer* pConstBuffer = nullptr;
-		hr = DXUTGetD3D11Device()->CreateBuffer(&constBufDesc,
-			nullptr, &pConstBuffer);
-		if (FAILED(hr))
+		ID3D11Buffer* pBuffer;
+		if (FAILED(DXUTGetD3D11Device()->CreateBuffer(&bufferDesc, nullptr, &pBuffer)))
 		{
-			throw std::runtime_error("Failed to create constant buffer for initialization");
+			throw std::runtime_error("Failed to create buffer");
 		}
-		ComPtr<ID3D11Buffer>(pConstBuffer, false)
-			.swap(m_pTestClothConstants);
+		ComPtr<ID3D11Buffer>(pBuffer, false).swap(buffer);
 
-		constBufDesc.ByteWidth = sizeof(CB_TEST_CLOTH_UPDATE);
-		hr = DXUTGetD3D11Device()->CreateBuffer(&constBufDesc,
-			nullptr, &pConstBuffer);
-		if (FAILED(hr))
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+		ZeroMemory(&srvDesc, sizeof(srvDesc));
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = numElements;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+
+		ID3D11ShaderResourceView* pSRV;
+		if (FAILED(DXUTGetD3D11Device()->CreateShaderResourceView(pBuffer, &srvDesc, &pSRV)))
 		{
-			throw std::runtime_error("Failed to create constant buffer for update");
+			throw std::runtime_error("Failed to create SRV");
 		}
-		ComPtr<ID3D11Buffer>(pConstBuffer, false)
-			.swap(m_pUpdateConstants);
-	}
+		ComPtr<ID3D11ShaderResourceView>(pSRV, false).swap(srv);
 
-	void InitializeRasterizerState()
-	{
-		HRESULT hr;
-		D3D11_RASTERIZER_DESC rasterizerDesc;
-		ZeroMemory(&rasterizerDesc, sizeof(rasterizerDesc));
-		rasterizerDesc.CullMode = D3D11_CULL_BACK;
-		rasterizerDesc.FillMode = D3D11_FILL_SOLID;
-		rasterizerDesc.DepthClipEnable = TRUE;
+		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+		ZeroMemory(&uavDesc, sizeof(uavDesc));
+		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+		uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+		uavDesc.Buffer.FirstElement = 0;
+		uavDesc.Buffer.NumElements = numElements;
 
-		ID3D11RasterizerState* pRasterizerState = nullptr;
-		hr = DXUTGetD3D11Device()
-			->CreateRasterizerState(&rasterizerDesc,
-			&pRasterizerState);
-		if (FAILED(hr))
+		ID3D11UnorderedAccessView* pUAV;
+		if (FAILED(DXUTGetD3D11Device()->CreateUnorderedAccessView(pBuffer, &uavDesc, &pUAV)))
 		{
-			throw std::runtime_error("Failed to create rasterizer state");
+			throw std::runtime_error("Failed to create UAV");
 		}
-
-		ComPtr<ID3D11RasterizerState>(pRasterizerState, false)
-			.swap(m_pRasterizerState);
+		ComPtr<ID3D11UnorderedAccessView>(pUAV, false).swap(uav);
 	}
 
-	void InitializeNormals()
+	// create structured buffer readable from shaders.
+	// dynamic buffers are writable from CPU with D3D11_MAP_WRITE_DISCARD.
+	static void CreateStructuredBufferSRV(UINT stride, UINT numElements,
+		const void* pInitialData, bool dynamic,
+		ComPtr<ID3D11Buffer>& buffer, ComPtr<ID3D11ShaderResourceView>& srv)
 	{
-		HRESULT hr;
-
-		// buffer for normal
 		D3D11_BUFFER_DESC bufferDesc;
 		ZeroMemory(&bufferDesc, sizeof(bufferDesc));
-		bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS |
-			D3D11_BIND_SHADER_RESOURCE;
-		bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		bufferDesc.Usage = dynamic ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_IMMUTABLE;
 		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-		bufferDesc.CPUAccessFlags = 0;
-		bufferDesc.ByteWidth = sizeof(DirectX::XMFLOAT4) *
-			NDIM_HORIZONTAL * NDIM_VERTICAL;
-		bufferDesc.StructureByteStride = sizeof(DirectX::XMFLOAT4);
+		bufferDesc.CPUAccessFlags = dynamic ? D3D11_CPU_ACCESS_WRITE : 0;
+		bufferDesc.ByteWidth = stride * numElements;
+		bufferDesc.StructureByteStride = stride;
+
+		D3D11_SUBRESOURCE_DATA subresData;
+		ZeroMemory(&subresData, sizeof(subresData));
+		subresData.pSysMem = pInitialData;
 
 		ID3D11Buffer* pBuffer;
-		hr = DXUTGetD3D11Device()->CreateBuffer(&bufferDesc,
-			nullptr, &pBuffer);
-		if (FAILED(hr))
+		if (FAILED(DXUTGetD3D11Device()->CreateBuffer(&bufferDesc,
+			pInitialData ? &subresData : nullptr, &pBuffer)))
 		{
 			throw std::runtime_error("Failed to create buffer");
 		}
-		ComPtr<ID3D11Buffer>(pBuffer, false)
-			.swap(m_pClothNormalBuffer);
+		ComPtr<ID3D11Buffer>(pBuffer, false).swap(buffer);
 
-		// SRV for normal
 		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
 		ZeroMemory(&srvDesc, sizeof(srvDesc));
 		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
 		srvDesc.Buffer.FirstElement = 0;
-		srvDesc.Buffer.NumElements = NDIM_HORIZONTAL * NDIM_VERTICAL;
+		srvDesc.Buffer.NumElements = numElements;
 		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
 
 		ID3D11ShaderResourceView* pSRV;
-		hr = DXUTGetD3D11Device()->CreateShaderResourceView(pBuffer, &srvDesc,
-			&pSRV);
-		if (FAILED(hr))
+		if (FAILED(DXUTGetD3D11Device()->CreateShaderResourceView(pBuffer,
+			&srvDesc, &pSRV)))
 		{
 			throw std::runtime_error("Failed to create SRV");
 		}
-		ComPtr<ID3D11ShaderResourceView>(pSRV, false)
-			.swap(m_pClothNormalSRV);
+		ComPtr<ID3D11ShaderResourceView>(pSRV, false).swap(srv);
+	}
 
-		// UAV for normal
-		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc;
-		ZeroMemory(&uavDesc, sizeof(uavDesc));
-		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
-		uavDesc.Buffer.FirstElement = 0;
-		uavDesc.Buffer.NumElements = NDIM_HORIZONTAL * NDIM_VERTICAL;
-		uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	static void InitializePositions(ComPtr<ID3D11UnorderedAccessView>)
+	{
+	}
 
-		ID3D11UnorderedAccessView* pUAV;
-		hr = DXUTGetD3D11Device()->CreateUnorderedAccessView(pBuffer, &uavDesc,
-			&pUAV);
-		if (FAILED(hr))
+	static void InitializeVelocities(ComPtr<ID3D11UnorderedAccessView>)
+	{
+	}
+
+	// solver constants, mapped anew in every command list recorded
+	void WriteUpdateConstants(ID3D11DeviceContext* pCTX)
+	{
+		CB_TEST_CLOTH_UPDATE cbTestCloth;
+		cbTestCloth.Neighbour.stiffness = m_desc.Neighbour.Stiffness;
+		cbTestCloth.Neighbour.damping = m_desc.Neighbour.Damping;
+		cbTestCloth.Neighbour.restLength = 2.0f / (m_Resolution - 1);
+
+		cbTestCloth.Diagonal.stiffness = m_desc.Diagonal.Stiffness;
+		cbTestCloth.Diagonal.damping = m_desc.Diagonal.Damping;
+		cbTestCloth.Diagonal.restLength = 2.0f * std::sqrtf(2.0f) / (m_Resolution - 1);
+
+		const auto& bending = m_desc.BendingType == TestCloth::BendingModel::Hinges ?
+			m_desc.Hinge : m_desc.Bending;
+		cbTestCloth.Bending.stiffness = bending.Stiffness;
+		cbTestCloth.Bending.damping = bending.Damping;
+		cbTestCloth.Bending.restLength = 4.0f / (m_Resolution - 1);
+
+		cbTestCloth.ClothResolution.x = m_Resolution;
+		cbTestCloth.ClothResolution.y = m_Resolution;
+		cbTestCloth.TimeStep = m_desc.TimeStep;
+		cbTestCloth.TearStrain = m_desc.TearStrain;
+		cbTestCloth.StrainLimit = m_desc.StrainLimit;
+
+		cbTestCloth.TriangleMembrane.warpStiffness = m_desc.Triangles.WarpStiffness;
+		cbTestCloth.TriangleMembrane.weftStiffness = m_desc.Triangles.WeftStiffness;
+		cbTestCloth.TriangleMembrane.shearStiffness = m_desc.Triangles.ShearStiffness;
+		cbTestCloth.TriangleMembrane.damping = m_desc.Triangles.Damping;
+
+		D3D11_MAPPED_SUBRESOURCE subres;
+		ZeroMemory(&subres, sizeof(subres));
+		if (FAILED(pCTX->Map(m_pUpdateConstants.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &subres)))
 		{
-			throw std::runtime_error("Failed to create UAV");
+			throw std::runtime_error("Failed to map constant buffer for update cloth");
 		}
-		ComPtr<ID3D11UnorderedAccessView>(pUAV, false)
-			.swap(m_pClothNormalUAV);
+		memcpy(subres.pData, &cbTestCloth, sizeof(cbTestCloth));
+		pCTX->Unmap(m_pUpdateConstants.get(), 0);
+	}
+
+	void UpdateBuffer(const SimulationBuffers& buffersFrom,
+		SimulationBuffers& buffersTo)
+	{
+		auto pCTX = m_pUpdateCTX.get();
+		WriteUpdateConstants(pCTX);
+
+		if (m_desc.Model == TestCloth::MembraneModel::Triangles)
+		{
+			UpdateMembrane(buffersFrom);
+		}
+
+		if (m_desc.BendingType == TestCloth::BendingModel::Hinges)
+		{
+			UpdateHinges(buffersFrom);
+		}
+
+		ID3D11ShaderResourceView* pSRVs[4] =
+		{
+			buffersFrom.ClothPositionSRV.get(),
+			buffersFrom.ClothVelocitySRV.get(),
+			buffersFrom.ClothLinkSRV.get(),
+			m_pTriangleForceSRV.get(),
+		};
+
+		ID3D11UnorderedAccessView* pUAVs[5] =
+		{
+			buffersTo.ClothPositionUAV.get(),
+			buffersTo.ClothVelocityUAV.get(),
+			m_pClothNormalUAV.get(),
+			buffersTo.ClothLinkUAV.get(),
+			m_pHingeForceUAV.get(),
+		};
+
+		ID3D11Buffer* pConstants = m_pUpdateConstants.get();
+
+		pCTX->CSSetShader(m_pUpdateShader.get(), nullptr, 0);
+		pCTX->CSSetShaderResources(0, 4, pSRVs);
+		pCTX->CSSetUnorderedAccessViews(0, 5, pUAVs, nullptr);
+		pCTX->CSSetConstantBuffers(0, 1, &pConstants);
+
+		DispatchGrid(pCTX);
+
+		pSRVs[0] = nullptr;
+		pSRVs[1] = nullptr;
+		pSRVs[2] = nullptr;
+		pSRVs[3] = nullptr;
+		pUAVs[0] = nullptr;
+		pUAVs[1] = nullptr;
+		pUAVs[2] = nullptr;
+		pUAVs[3] = nullptr;
+		pUAVs[4] = nullptr;
+
+		pCTX->CSSetShaderResources(0, 4, pSRVs);
+		pCTX->CSSetUnorderedAccessViews(0, 5, pUAVs, nullptr);
+
+		for (std::uint32_t i = 0; i < m_desc.StrainLimitIterations && m_desc.StrainLimit > 0.0f; i++)
+		{
+			LimitStrain(buffersTo);
+		}
+
+		ApplyColliders(buffersTo);
+		ApplyAttachments(buffersFrom, buffersTo);
+	}
+
+	// evaluate triangle membrane forces, gathered later by the update shader.
+	// expects the update constants to be up to date.
+	void UpdateMembrane(const SimulationBuffers& buffersFrom)
+	{
+		auto pCTX = m_pUpdateCTX.get();
+
+		ID3D11ShaderResourceView* pSRVs[5] =
+		{
+			buffersFrom.ClothPositionSRV.get(),
+			buffersFrom.ClothVelocitySRV.get(),
+			m_pTriangleInvRestSRV.get(),
+			m_pTriangleAreaSRV.get(),
+			buffersFrom.ClothLinkSRV.get(),
+		};
+
+		ID3D11UnorderedAccessView* pUAV = m_pTriangleForceUAV.get();
+		ID3D11Buffer* pConstants = m_pUpdateConstants.get();
+
+		pCTX->CSSetShader(m_pMembraneShader.get(), nullptr, 0);
+		pCTX->CSSetShaderResources(0, 5, pSRVs);
+		pCTX->CSSetUnorderedAccessViews(0, 1, &pUAV, nullptr);
+		pCTX->CSSetConstantBuffers(0, 1, &pConstants);
+
+		pCTX->Dispatch((m_NumTriangles + 63) / 64, 1, 1);
+
+		for (int i = 0; i < 5; i++)
+		{
+			pSRVs[i] = nullptr;
+		}
+		pUAV = nullptr;
+
+		pCTX->CSSetShaderResources(0, 5, pSRVs);
+		pCTX->CSSetUnorderedAccessViews(0, 1, &pUAV, nullptr);
+	}
+
+	// accumulate hinge bending forces, consumed by the update shader.
+	// expects the update constants to be up to date.
+	void UpdateHinges(const SimulationBuffers& buffersFrom)
+	{
+		auto pCTX = m_pUpdateCTX.get();
+
+		ID3D11ShaderResourceView* pSRVs[4] =
+		{
+			buffersFrom.ClothPositionSRV.get(),
+			buffersFrom.ClothVelocitySRV.get(),
+			m_pHingeSRV.get(),
+			buffersFrom.ClothLinkSRV.get(),
+		};
+
+		ID3D11UnorderedAccessView* pUAV = m_pHingeForceUAV.get();
+		ID3D11Buffer* pConstants[2] =
+		{
+			m_pUpdateConstants.get(),
+			m_pHingeConstants.get(),
+		};
+
+		pCTX->CSSetShader(m_pHingeShader.get(), nullptr, 0);
+		pCTX->CSSetShaderResources(0, 4, pSRVs);
+		pCTX->CSSetUnorderedAccessViews(0, 1, &pUAV, nullptr);
+		pCTX->CSSetConstantBuffers(0, 2, pConstants);
+
+		pCTX->Dispatch((m_NumHinges + 63) / 64, 1, 1);
+
+		for (int i = 0; i < 4; i++)
+		{
+			pSRVs[i] = nullptr;
+		}
+		pUAV = nullptr;
+
+		pCTX->CSSetShaderResources(0, 4, pSRVs);
+		pCTX->CSSetUnorderedAccessViews(0, 1, &pUAV, nullptr);
+	}
+
+	// one iteration of strain limiting on neighbour and diagonal edges.
+	// expects the update constants to be bound to b0.
+	void LimitStrain(SimulationBuffers& buffers)
+	{
+		auto pCTX = m_pUpdateCTX.get();
+		ID3D11ShaderResourceView* pSRVs[2] = {};
+		ID3D11UnorderedAccessView* pUAVs[3] = {};
+		ID3D11Buffer* pConstants[2] =
+		{
+			m_pUpdateConstants.get(),
+			m_pStretchedEdgeCount.get(),
+		};
+		UINT initialCount = 0;
+
+		// collect stretched edges into the compact list
+		pSRVs[0] = buffers.ClothPositionSRV.get();
+		pSRVs[1] = buffers.ClothLinkSRV.get();
+		pUAVs[0] = m_pStretchedEdgeUAV.get();
+		pCTX->CSSetShader(m_pStrainDetectShader.get(), nullptr, 0);
+		pCTX->CSSetConstantBuffers(0, 2, pConstants);
+		pCTX->CSSetShaderResources(0, 2, pSRVs);
+		pCTX->CSSetUnorderedAccessViews(0, 1, pUAVs, &initialCount);
+		DispatchGrid(pCTX);
+
+		pUAVs[0] = nullptr;
+		pCTX->CSSetUnorderedAccessViews(0, 1, pUAVs, nullptr);
+
+		// size the correction dispatch by the list length
+		pCTX->CopyStructureCount(m_pStretchedEdgeCount.get(), 0, m_pStretchedEdgeUAV.get());
+
+		pUAVs[0] = m_pStrainDispatchArgsUAV.get();
+		pCTX->CSSetShader(m_pStrainArgsShader.get(), nullptr, 0);
+		pCTX->CSSetUnorderedAccessViews(0, 1, pUAVs, nullptr);
+		pCTX->Dispatch(1, 1, 1);
+
+		pUAVs[0] = nullptr;
+		pCTX->CSSetUnorderedAccessViews(0, 1, pUAVs, nullptr);
+
+		// accumulate corrections of the stretched edges only
+		pSRVs[1] = m_pStretchedEdgeSRV.get();
+		pUAVs[0] = m_pStrainCorrectionUAV.get();
+		pCTX->CSSetShader(m_pStrainLimitShader.get(), nullptr, 0);
+		pCTX->CSSetShaderResources(0, 2, pSRVs);
+		pCTX->CSSetUnorderedAccessViews(0, 1, pUAVs, nullptr);
+		pCTX->DispatchIndirect(m_pStrainDispatchArgs.get(), 0);
+
+		pSRVs[0] = nullptr;
+		pSRVs[1] = nullptr;
+		pUAVs[0] = nullptr;
+		pCTX->CSSetShaderResources(0, 2, pSRVs);
+		pCTX->CSSetUnorderedAccessViews(0, 1, pUAVs, nullptr);
+
+		// apply accumulated corrections
+		pUAVs[0] = buffers.ClothPositionUAV.get();
+		pUAVs[1] = buffers.ClothVelocityUAV.get();
+		pUAVs[2] = m_pStrainCorrectionUAV.get();
+		pCTX->CSSetShader(m_pStrainApplyShader.get(), nullptr, 0);
+		pCTX->CSSetUnorderedAccessViews(0, 3, pUAVs, nullptr);
+		DispatchGrid(pCTX);
+
+		pUAVs[0] = nullptr;
+		pUAVs[1] = nullptr;
+		pUAVs[2] = nullptr;
+		pCTX->CSSetUnorderedAccessViews(0, 3, pUAVs, nullptr);
+	}
+
+	// move pinned particles to their attachments.
+	// only the compact list of pinned particles is dispatched.
+	void ApplyAttachments(const SimulationBuffers& buffersFrom,
+		SimulationBuffers& buffersTo)
+	{
+		if (m_NumPinnedParticles == 0)
+		{
+			return;
+		}
+
+		auto pCTX = m_pUpdateCTX.get();
+		D3D11_MAPPED_SUBRESOURCE subres;
+		ZeroMemory(&subres, sizeof(subres));
+		if (FAILED(pCTX->Map(m_pAttachTransformBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &subres)))
+		{
+			throw std::runtime_error("Failed to map attachment transforms");
+		}
+		auto pTransforms = reinterpret_cast<DirectX::XMFLOAT4X4*>(subres.pData);
+		for (const auto& attachment : m_desc.Attachments)
+		{
+			DirectX::XMStoreFloat4x4(pTransforms++,
+				DirectX::XMMatrixTranspose(GetAttachmentTransform(attachment)));
+		}
+		pCTX->Unmap(m_pAttachTransformBuffer.get(), 0);
+
+		CB_TEST_CLOTH_ATTACH cbAttach;
+		ZeroMemory(&cbAttach, sizeof(cbAttach));
+		cbAttach.NumPinnedParticles = m_NumPinnedParticles;
+		cbAttach.TimeStep = m_desc.TimeStep;
+
+		ZeroMemory(&subres, sizeof(subres));
+		if (FAILED(pCTX->Map(m_pAttachConstants.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &subres)))
+		{
+			throw std::runtime_error("Failed to map constant buffer for attachments");
+		}
+		memcpy(subres.pData, &cbAttach, sizeof(cbAttach));
+		pCTX->Unmap(m_pAttachConstants.get(), 0);
+
+		ID3D11ShaderResourceView* pSRVs[3] =
+		{
+			m_pPinnedParticleSRV.get(),
+			m_pAttachTransformSRV.get(),
+			buffersFrom.ClothPositionSRV.get(),
+		};
+
+		ID3D11UnorderedAccessView* pUAVs[2] =
+		{
+			buffersTo.ClothPositionUAV.get(),
+			buffersTo.ClothVelocityUAV.get(),
+		};
+
+		ID3D11Buffer* pConstants = m_pAttachConstants.get();
+
+		pCTX->CSSetShader(m_pAttachShader.get(), nullptr, 0);
+		pCTX->CSSetShaderResources(0, 3, pSRVs);
+		pCTX->CSSetUnorderedAccessViews(0, 2, pUAVs, nullptr);
+		pCTX->CSSetConstantBuffers(0, 1, &pConstants);
+
+		pCTX->Dispatch((m_NumPinnedParticles + 63) / 64, 1, 1);
+
+		pSRVs[0] = nullptr;
+		pSRVs[1] = nullptr;
+		pSRVs[2] = nullptr;
+		pUAVs[0] = nullptr;
+		pUAVs[1] = nullptr;
+
+		pCTX->CSSetShaderResources(0, 3, pSRVs);
+		pCTX->CSSetUnorderedAccessViews(0, 2, pUAVs, nullptr);
+	}
+
+	void InitializeVertexShader()
+	{
+		// VS
+		auto pShaderCode = CompileShader(L"TestClothVS.hlsl", "vs_4_0");
+		if (!pShaderCode)
+		{
+			throw std::runtime_error("Failed to compile vertex shader");
+		}
+
+		ID3D11VertexShader* pVS;
+		if (FAILED(DXUTGetD3D11Device()->CreateVertexShader(pShaderCode->GetBufferPointer(),
+			pShaderCode->GetBufferSize(), nullptr, &pVS)))
+		{
+			throw std::runtime_error("Failed to create vertex shader");
+		}
+
+		ComPtr<ID3D11VertexShader>(pVS, false)
+			.swap(m_pTestClothVS);
+	}
+
+	void InitializeGeometryShader()
+	{
+		// GS
+		auto pShaderCode = CompileShader(L"TestClothGS.hlsl", "gs_4_0");
+		if (!pShaderCode)
+		{
+			throw std::runtime_error("Failed to compile geometry shader");
+		}
+
+		ID3D11GeometryShader* pGS;
+		if (FAILED(DXUTGetD3D11Device()->CreateGeometryShader(pShaderCode->GetBufferPointer(),
+			pShaderCode->GetBufferSize(), nullptr, &pGS)))
+		{
+			throw std::runtime_error("Failed to create geometry shader");
+		}
+
+		ComPtr<ID3D11GeometryShader>(pGS, false)
+			.swap(m_pTestClothGS);
+	}
+
+	void InitializePixelShader()
+	{
+		// PS
+		auto pShaderCode = CompileShader(L"TestClothPS.hlsl", "ps_4_0");
+		if (!pShaderCode)
+		{
+			throw std::runtime_error("Failed to compile pixel shader");
+		}
+
+		ID3D11PixelShader* pPS;
+		if (FAILED(DXUTGetD3D11Device()->CreatePixelShader(pShaderCode->GetBufferPointer(),
+			pShaderCode->GetBufferSize(), nullptr, &pPS)))
+		{
+			throw std::runtime_error("Failed to create pixel shader");
+		}
+
+		ComPtr<ID3D11PixelShader>(pPS, false)
+			.swap(m_pTestClothPS);
+	}
+
+	void InitializeConstantBuffer()
+	{
+		HRESULT hr;
+
+		D3D11_BUFFER_DESC constBufDesc;
+		ZeroMemory(&constBufDesc, sizeof(constBufDesc));
+		constBufDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		constBufDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		constBufDesc.ByteWidth = sizeof(CB_TEST_CLOTH);
+		constBufDesc.Usage = D3D11_USAGE_DYNAMIC;
+
+		ID3D11Buffer* pConstBuffer = nullptr;
+		hr = DXUTGetD3D11Device()->CreateBuffer(&constBufDesc,
+			nullptr, &pConstBuffer);
+		if (FAILED(hr))
+		{
+			throw std::runtime_error("Failed to create constant buffer for initialization");
+		}
+		ComPtr<ID3D11Buffer>(pConstBuffer, false)
+			.swap(m_pTestClothConstants);
+
+		constBufDesc.ByteWidth = sizeof(CB_TEST_CLOTH_UPDATE);
+		hr = DXUTGetD3D11Device()->CreateBuffer(&constBufDesc,
+			nullptr, &pConstBuffer);
+		if (FAILED(hr))
+		{
+			throw std::runtime_error("Failed to create constant buffer for update");
+		}
+		ComPtr<ID3D11Buffer>(pConstBuffer, false)
+			.swap(m_pUpdateConstants);
+	}
+
+	void InitializeRasterizerState()
+	{
+		HRESULT hr;
+		D3D11_RASTERIZER_DESC rasterizerDesc;
+		ZeroMemory(&rasterizerDesc, sizeof(rasterizerDesc));
+		rasterizerDesc.CullMode = D3D11_CULL_BACK;
+		rasterizerDesc.FillMode = D3D11_FILL_SOLID;
+		rasterizerDesc.DepthClipEnable = TRUE;
+
+		ID3D11RasterizerState* pRasterizerState = nullptr;
+		hr = DXUTGetD3D11Device()
+			->CreateRasterizerState(&rasterizerDesc,
+			&pRasterizerState);
+		if (FAILED(hr))
+		{
+			throw std::runtime_error("Failed to create rasterizer state");
+		}
+
+		ComPtr<ID3D11RasterizerState>(pRasterizerState, false)
+			.swap(m_pRasterizerState);
+	}
+
+	void InitializeNormals()
+	{
+		HRESULT hr;
+
+		// buffer for normal
+		D3D11_BUFFER_DESC bufferDesc;
+		ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+		bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS |
+			D3D11_BIND_SHADER_RESOURCE;
+		bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bufferDesc.CPUAccessFlags = 0;
+		bufferDesc.ByteWidth = sizeof(DirectX::XMFLOAT4) *
+			m_Resolution * m_Resolution;
+		bufferDesc.StructureByteStride = sizeof(DirectX::XMFLOAT4);
+
+		ID3D11Buffer* pBuffer;
+		hr = DXUTGetD3D11Device()->CreateBuffer(&bufferDesc,
+			nullptr, &pBuffer);
+		if (FAILED(hr))
+		{
+			throw std::runtime_error("Failed to create buffer");
+		}
+		ComPtr<ID3D11Buffer>(pBuffer, false)
+			.swap(m_pClothNormalBuffer);
+
+		// SRV for normal
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+		ZeroMemory(&srvDesc, sizeof(srvDesc));
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = m_Resolution * m_Resolution;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+
+		ID3D11ShaderResourceView* pSRV;
+		hr = DXUTGetD3D11Device()->CreateShaderResourceView(pBuffer, &srvDesc,
+			&pSRV);
+		if (FAILED(hr))
+		{
+			throw std::runtime_error("Failed to create SRV");
+		}
+		ComPtr<ID3D11ShaderResourceView>(pSRV, false)
+			.swap(m_pClothNormalSRV);
+
+		// UAV for normal
+		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+		ZeroMemory(&uavDesc, sizeof(uavDesc));
+		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+		uavDesc.Buffer.FirstElement = 0;
+		uavDesc.Buffer.NumElements = m_Resolution * m_Resolution;
+		uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+
+		ID3D11UnorderedAccessView* pUAV;
+		hr = DXUTGetD3D11Device()->CreateUnorderedAccessView(pBuffer, &uavDesc,
+			&pUAV);
+		if (FAILED(hr))
+		{
+			throw std::runtime_error("Failed to create UAV");
+		}
+		ComPtr<ID3D11UnorderedAccessView>(pUAV, false)
+			.swap(m_pClothNormalUAV);
+	}
+
+	void InitializeBufferContents()
+	{
+		HRESULT hr;
+
+		auto pShader = CreateComputeShader(L"TestClothInit.hlsl");
+
+		struct CB_TEST_CLOTH_INIT
+		{
+			DirectX::XMFLOAT4 FourPositions[4];
+			DirectX::XMUINT2 ClothResolution, dummy;
+		}  cbTestClothInit;
+
+		GetInitialCorners(m_desc, cbTestClothInit.FourPositions);
+		cbTestClothInit.ClothResolution.x = m_Resolution;
+		cbTestClothInit.ClothResolution.y = m_Resolution;
+
+		ID3D11Buffer* pConstBufferRaw;
+		D3D11_BUFFER_DESC bufferDesc;
+		ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+		bufferDesc.ByteWidth = sizeof(cbTestClothInit);
+		bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+
+		D3D11_SUBRESOURCE_DATA subresData;
+		ZeroMemory(&subresData, sizeof(subresData));
+		subresData.pSysMem = &cbTestClothInit;
+		hr = DXUTGetD3D11Device()->CreateBuffer(&bufferDesc,
+			&subresData, &pConstBufferRaw);
+		if (FAILED(hr))
+		{
+			throw std::runtime_error("Failed to create buffer");
+		}
+		ComPtr<ID3D11Buffer> pConstBuffer(pConstBufferRaw, false);
+
+		ID3D11UnorderedAccessView* pUAVs[3] = {
+			m_SimBuffers[0].ClothPositionUAV.get(),
+			m_SimBuffers[0].ClothVelocityUAV.get(),
+			m_SimBuffers[0].ClothLinkUAV.get(),
+		};
+
+		auto pCTX = DXUTGetD3D11DeviceContext();
+		pCTX->CSSetShader(pShader.get(), nullptr, 0);
+		pCTX->CSSetConstantBuffers(0, 1, &pConstBufferRaw);
+		pCTX->CSSetUnorderedAccessViews(0, 3, pUAVs, nullptr);
+
+		DispatchGrid(pCTX);
+
+		pUAVs[0] = nullptr;
+		pUAVs[1] = nullptr;
+		pUAVs[2] = nullptr;
+		pConstBufferRaw = nullptr;
+
+		pCTX->CSSetShader(nullptr, nullptr, 0);
+		pCTX->CSSetConstantBuffers(0, 1, &pConstBufferRaw);
+		pCTX->CSSetUnorderedAccessViews(0, 3, pUAVs, nullptr);
+	}
+
+	void InitializeShader()
+	{
+		std::vector<D3D_SHADER_MACRO> defines;
+		if (m_desc.Model == TestCloth::MembraneModel::Triangles)
+		{
+			defines.push_back(D3D_SHADER_MACRO{ "TRIANGLE_MEMBRANE", "1" });
+		}
+		if (m_desc.BendingType == TestCloth::BendingModel::Hinges)
+		{
+			defines.push_back(D3D_SHADER_MACRO{ "HINGE_BENDING", "1" });
+		}
+		defines.push_back(D3D_SHADER_MACRO{ nullptr, nullptr });
+
+		m_pUpdateShader = CreateComputeShader(L"TestClothUpdate.hlsl", defines.data());
+	}
+
+	// precompute hinges over all interior edges of the triangle mesh,
+	// stored contiguously in one structured buffer
+	void InitializeHinges()
+	{
+		if (m_desc.BendingType != TestCloth::BendingModel::Hinges)
+		{
+			return;
+		}
+
+		// directed edge (from << 32 | to) -> opposite vertex of its triangle
+		std::unordered_map<std::uint64_t, std::uint32_t> edges;
+		auto triangles = GetGridTriangles(m_Resolution);
+		for (const auto& tri : triangles)
+		{
+			const std::uint32_t ids[3] = { tri.x, tri.y, tri.z };
+			for (std::uint32_t k = 0; k < 3; k++)
+			{
+				std::uint64_t from = ids[k], to = ids[(k + 1) % 3];
+				edges[from << 32 | to] = ids[(k + 2) % 3];
+			}
+		}
+
+		// an interior edge appears once in each direction;
+		// the hinge is created from the direction with from < to
+		std::vector<HingeCS> hinges;
+		for (const auto& edge : edges)
+		{
+			std::uint32_t from = static_cast<std::uint32_t>(edge.first >> 32);
+			std::uint32_t to = static_cast<std::uint32_t>(edge.first);
+			if (from > to)
+			{
+				continue;
+			}
+
+			auto opposite = edges.find(static_cast<std::uint64_t>(to) << 32 | from);
+			if (opposite == edges.end())
+			{
+				continue;
+			}
+
+			HingeCS hinge;
+			ZeroMemory(&hinge, sizeof(hinge));
+			hinge.ids = DirectX::XMUINT4(edge.second, opposite->second, from, to);
+			hinge.restSinHalfAngle = GetHingeSinHalfAngle(m_desc, hinge.ids, m_Resolution);
+			hinges.push_back(hinge);
+		}
+
+		// keep memory access of neighbouring threads coherent
+		std::sort(hinges.begin(), hinges.end(), [](const HingeCS& a, const HingeCS& b)
+		{
+			return a.ids.z != b.ids.z ? a.ids.z < b.ids.z : a.ids.w < b.ids.w;
+		});
+
+		m_NumHinges = static_cast<std::uint32_t>(hinges.size());
+		CreateStructuredBufferSRV(sizeof(HingeCS), m_NumHinges,
+			hinges.data(), false, m_pHingeBuffer, m_pHingeSRV);
+
+		// fixed point xyz force per particle
+		CreateRawBufferUAV(sizeof(std::int32_t) * 3 * m_Resolution * m_Resolution, 0,
+			m_pHingeForceBuffer, m_pHingeForceUAV);
+
+		CB_TEST_CLOTH_HINGE cbHinge;
+		ZeroMemory(&cbHinge, sizeof(cbHinge));
+		cbHinge.NumHinges = m_NumHinges;
+		m_pHingeConstants = CreateConstantBuffer(sizeof(cbHinge), false);
+		DXUTGetD3D11DeviceContext()->UpdateSubresource(m_pHingeConstants.get(),
+			0, nullptr, &cbHinge, 0, 0);
+
+		m_pHingeShader = CreateComputeShader(L"TestClothHinge.hlsl");
+	}
+
+	// precompute per-triangle rest data in SoA buffers
+	// (numbering as in TestClothSolver.hlsli)
+	void InitializeMembrane()
+	{
+		if (m_desc.Model != TestCloth::MembraneModel::Triangles)
+		{
+			return;
+		}
+
+		const std::uint32_t numQuadsX = m_Resolution - 1;
+		const std::uint32_t numQuadsY = m_Resolution - 1;
+		m_NumTriangles = 2 * numQuadsX * numQuadsY;
+
+		// rest positions in material space, same spacing as neighbour springs
+		const float restLength = 2.0f / (m_Resolution - 1);
+		auto restPosition = [restLength](std::uint32_t x, std::uint32_t y)
+		{
+			return DirectX::XMFLOAT2(x * restLength, y * restLength);
+		};
+
+		std::vector<DirectX::XMFLOAT4> invRest(m_NumTriangles);
+		std::vector<float> area(m_NumTriangles);
+
+		for (std::uint32_t qy = 0; qy < numQuadsY; qy++)
+		{
+			for (std::uint32_t qx = 0; qx < numQuadsX; qx++)
+			{
+				DirectX::XMFLOAT2 corners[2][3] =
+				{
+					{ restPosition(qx, qy), restPosition(qx + 1, qy), restPosition(qx + 1, qy + 1) },
+					{ restPosition(qx, qy), restPosition(qx + 1, qy + 1), restPosition(qx, qy + 1) },
+				};
+
+				for (std::uint32_t k = 0; k < 2; k++)
+				{
+					const auto& p = corners[k];
+					float m00 = p[1].x - p[0].x, m01 = p[2].x - p[0].x;
+					float m10 = p[1].y - p[0].y, m11 = p[2].y - p[0].y;
+					float det = m00 * m11 - m01 * m10;
+
+					std::uint32_t tri = 2 * (qx + qy * numQuadsX) + k;
+					invRest[tri] = DirectX::XMFLOAT4(m11 / det, -m01 / det, -m10 / det, m00 / det);
+					area[tri] = 0.5f * std::fabs(det);
+				}
+			}
+		}
+
+		CreateStructuredBufferSRV(sizeof(DirectX::XMFLOAT4), m_NumTriangles,
+			invRest.data(), false, m_pTriangleInvRestBuffer, m_pTriangleInvRestSRV);
+		CreateStructuredBufferSRV(sizeof(float), m_NumTriangles,
+			area.data(), false, m_pTriangleAreaBuffer, m_pTriangleAreaSRV);
+		CreateStructuredBufferUAV(sizeof(DirectX::XMFLOAT4), 3 * m_NumTriangles,
+			m_pTriangleForceBuffer, m_pTriangleForceSRV, m_pTriangleForceUAV);
+
+		m_pMembraneShader = CreateComputeShader(L"TestClothMembrane.hlsl");
+	}
+
+	void InitializeStrainLimiting()
+	{
+		if (m_desc.StrainLimit <= 0.0f)
+		{
+			return;
+		}
+
+		// each particle owns up to four edges
+		const UINT maxStretchedEdges = 4 * m_Resolution * m_Resolution;
+
+		D3D11_BUFFER_DESC bufferDesc;
+		ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+		bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS |
+			D3D11_BIND_SHADER_RESOURCE;
+		bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bufferDesc.ByteWidth = sizeof(StretchedEdgeCS) * maxStretchedEdges;
+		bufferDesc.StructureByteStride = sizeof(StretchedEdgeCS);
+
+		ID3D11Buffer* pBuffer;
+		if (FAILED(DXUTGetD3D11Device()->CreateBuffer(&bufferDesc, nullptr, &pBuffer)))
+		{
+			throw std::runtime_error("Failed to create buffer");
+		}
+		ComPtr<ID3D11Buffer>(pBuffer, false)
+			.swap(m_pStretchedEdgeBuffer);
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+		ZeroMemory(&srvDesc, sizeof(srvDesc));
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = maxStretchedEdges;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+
+		ID3D11ShaderResourceView* pSRV;
+		if (FAILED(DXUTGetD3D11Device()->CreateShaderResourceView(pBuffer, &srvDesc, &pSRV)))
+		{
+			throw std::runtime_error("Failed to create SRV");
+		}
+		ComPtr<ID3D11ShaderResourceView>(pSRV, false)
+			.swap(m_pStretchedEdgeSRV);
+
+		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+		ZeroMemory(&uavDesc, sizeof(uavDesc));
+		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+		uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+		uavDesc.Buffer.FirstElement = 0;
+		uavDesc.Buffer.NumElements = maxStretchedEdges;
+		uavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_APPEND;
+
+		ID3D11UnorderedAccessView* pUAV;
+		if (FAILED(DXUTGetD3D11Device()->CreateUnorderedAccessView(pBuffer, &uavDesc, &pUAV)))
+		{
+			throw std::runtime_error("Failed to create UAV");
+		}
+		ComPtr<ID3D11UnorderedAccessView>(pUAV, false)
+			.swap(m_pStretchedEdgeUAV);
+
+		m_pStretchedEdgeCount = CreateConstantBuffer(16, false);
+
+		// DispatchIndirect arguments, written by TestClothStrainArgs.hlsl
+		CreateRawBufferUAV(sizeof(std::uint32_t) * 4, D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS,
+			m_pStrainDispatchArgs, m_pStrainDispatchArgsUAV);
+
+		// fixed point xyz correction per particle
+		CreateRawBufferUAV(sizeof(std::int32_t) * 3 * m_Resolution * m_Resolution, 0,
+			m_pStrainCorrectionBuffer, m_pStrainCorrectionUAV);
+
+		m_pStrainDetectShader = CreateComputeShader(L"TestClothStrainDetect.hlsl");
+		m_pStrainArgsShader = CreateComputeShader(L"TestClothStrainArgs.hlsl");
+		m_pStrainLimitShader = CreateComputeShader(L"TestClothStrainLimit.hlsl");
+		m_pStrainApplyShader = CreateComputeShader(L"TestClothStrainApply.hlsl");
+	}
+
+	// push the particles out of the colliders. expects the update constants
+	// to be up to date.
+	void ApplyColliders(SimulationBuffers& buffersTo)
+	{
+		if (!m_pColliderSRV)
+		{
+			return;
+		}
+
+		auto pCTX = m_pUpdateCTX.get();
+
+		ID3D11ShaderResourceView* pSRV = m_pColliderSRV.get();
+		ID3D11UnorderedAccessView* pUAVs[2] =
+		{
+			buffersTo.ClothPositionUAV.get(),
+			buffersTo.ClothVelocityUAV.get(),
+		};
+		ID3D11Buffer* pConstants = m_pUpdateConstants.get();
+
+		pCTX->CSSetShader(m_pCollideShader.get(), nullptr, 0);
+		pCTX->CSSetShaderResources(0, 1, &pSRV);
+		pCTX->CSSetUnorderedAccessViews(0, 2, pUAVs, nullptr);
+		pCTX->CSSetConstantBuffers(0, 1, &pConstants);
+
+		DispatchGrid(pCTX);
+
+		pSRV = nullptr;
+		pUAVs[0] = nullptr;
+		pUAVs[1] = nullptr;
+		pCTX->CSSetShaderResources(0, 1, &pSRV);
+		pCTX->CSSetUnorderedAccessViews(0, 2, pUAVs, nullptr);
+	}
+
+	void InitializeColliders()
+	{
+		if (m_desc.Colliders.empty())
+		{
+			return;
+		}
+
+		using namespace DirectX;
+
+		std::vector<ColliderCS> colliders;
+		for (const auto& collider : m_desc.Colliders)
+		{
+			ColliderCS colliderCS;
+			ZeroMemory(&colliderCS, sizeof(colliderCS));
+			if (collider.Shape == TestCloth::ColliderShape::Sphere)
+			{
+				colliderCS.shape = XMFLOAT4(collider.Center.x, collider.Center.y, collider.Center.z,
+					collider.Radius + m_desc.CollisionThickness);
+				colliderCS.type = 0;
+			}
+			else
+			{
+				auto normal = XMVector3Normalize(XMLoadFloat3(&collider.Normal));
+				XMStoreFloat4(&colliderCS.shape, XMVectorSetW(normal,
+					XMVectorGetX(XMVector3Dot(normal, XMLoadFloat3(&collider.Center))) +
+					m_desc.CollisionThickness));
+				colliderCS.type = 1;
+			}
+			colliders.push_back(colliderCS);
+		}
+
+		CreateStructuredBufferSRV(sizeof(ColliderCS), static_cast<UINT>(colliders.size()),
+			colliders.data(), false, m_pColliderBuffer, m_pColliderSRV);
+		m_pCollideShader = CreateComputeShader(L"TestClothCollide.hlsl");
+	}
+
+	void InitializeAttachments()
+	{
+		std::vector<PinnedParticleCS> pinnedParticles;
+
+		std::uint32_t iAttachment = 0;
+		for (const auto& attachment : m_desc.Attachments)
+		{
+			// express initial positions in the space of the attachment
+			auto invTransform = DirectX::XMMatrixInverse(nullptr,
+				GetAttachmentTransform(attachment));
+
+			for (auto id : attachment.Particles)
+			{
+				if (id >= m_Resolution * m_Resolution)
+				{
+					throw std::runtime_error("Attached particle is out of range");
+				}
+
+				PinnedParticleCS pinned;
+				ZeroMemory(&pinned, sizeof(pinned));
+				pinned.id = id;
+				pinned.attachment = iAttachment;
+				DirectX::XMStoreFloat4(&pinned.localPosition,
+					DirectX::XMVector3TransformCoord(GetInitialPosition(m_desc, id, m_Resolution), invTransform));
+				pinned.localPosition.w = 1.0f;
+				pinnedParticles.push_back(pinned);
+			}
+
+			++iAttachment;
+		}
+
+		m_NumPinnedParticles = static_cast<std::uint32_t>(pinnedParticles.size());
+		if (m_NumPinnedParticles == 0)
+		{
+			return;
+		}
+
+		CreateStructuredBufferSRV(sizeof(PinnedParticleCS), m_NumPinnedParticles,
+			pinnedParticles.data(), false,
+			m_pPinnedParticleBuffer, m_pPinnedParticleSRV);
+		CreateStructuredBufferSRV(sizeof(DirectX::XMFLOAT4X4),
+			static_cast<UINT>(m_desc.Attachments.size()), nullptr, true,
+			m_pAttachTransformBuffer, m_pAttachTransformSRV);
+
+		m_pAttachConstants = CreateConstantBuffer(sizeof(CB_TEST_CLOTH_ATTACH), true);
+		m_pAttachShader = CreateComputeShader(L"TestClothAttach.hlsl");
+	}
+
+	// bounds of the positions just written, read back without stalling
+	void ComputeBounds(const SimulationBuffers& buffers)
+	{
+		auto pCTX = m_pUpdateCTX.get();
+
+		const UINT clearValue[4] = { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff };
+		pCTX->ClearUnorderedAccessViewUint(m_pBoundsUAV.get(), clearValue);
+
+		ID3D11Buffer* pConstants = m_pUpdateConstants.get();
+		ID3D11ShaderResourceView* pSRV = buffers.ClothPositionSRV.get();
+		ID3D11UnorderedAccessView* pUAV = m_pBoundsUAV.get();
+		pCTX->CSSetShader(m_pBoundsShader.get(), nullptr, 0);
+		pCTX->CSSetConstantBuffers(0, 1, &pConstants);
+		pCTX->CSSetShaderResources(0, 1, &pSRV);
+		pCTX->CSSetUnorderedAccessViews(0, 1, &pUAV, nullptr);
+		pCTX->Dispatch((m_Resolution * m_Resolution + 255) / 256, 1, 1);
+
+		pSRV = nullptr;
+		pUAV = nullptr;
+		pCTX->CSSetShaderResources(0, 1, &pSRV);
+		pCTX->CSSetUnorderedAccessViews(0, 1, &pUAV, nullptr);
+
+		// skip this step if all the readback buffers are still in flight
+		ID3D11Buffer* pSource = m_pBoundsBuffer.get();
+		m_BoundsReadbacks.Copy(pCTX, &pSource, m_StepCount);
+	}
+
+	// copy the published positions for the cache writer, read back later
+	void RecordCacheFrame()
+	{
+		if (!m_pCacheWriter)
+		{
+			return;
+		}
+
+		ID3D11Buffer* pSource = m_SimBuffers[m_iRender].ClothPositionBuffer.get();
+		if (!m_CacheReadbacks.Copy(DXUTGetD3D11DeviceContext(), &pSource, m_StepCount))
+		{
+			m_pCacheWriter->DropFrame();
+		}
+
+		ReadCacheFrames(*m_pCacheWriter, false);
+
+		auto rawBytes = m_pCacheWriter->GetRawBytes();
+		if (rawBytes > 0)
+		{
+			SetStatistic(L"TestCloth cache size [%]",
+				100.0 * m_pCacheWriter->GetWrittenBytes() / rawBytes);
+		}
+		SetStatistic(L"TestCloth cache dropped frames",
+			static_cast<double>(m_pCacheWriter->GetDroppedFrames()));
+	}
+
+	// hand the frames which reached the CPU to the cache writer, in order
+	void ReadCacheFrames(TestCloth::CacheWriter& cacheWriter, bool wait)
+	{
+		auto read = [&](std::uint64_t step, const void* const* ppData)
+		{
+			cacheWriter.AddFrame(step, static_cast<const DirectX::XMFLOAT4*>(ppData[0]));
+		};
+		while (m_CacheReadbacks.ReadNext(DXUTGetD3D11DeviceContext(), wait, read))
+		{
+		}
+	}
+
+	// copy the published mesh for the exporter, read back later
+	void ExportFrame()
+	{
+		if (!m_pMeshExporter)
+		{
+			return;
+		}
+
+		const auto& buffers = m_SimBuffers[m_iRender];
+		ID3D11Buffer* pSources[3] =
+		{
+			buffers.ClothPositionBuffer.get(),
+			m_pClothNormalBuffer.get(),
+			buffers.ClothLinkBuffer.get(),
+		};
+		if (!m_ExportReadbacks.Copy(DXUTGetD3D11DeviceContext(), pSources, m_StepCount))
+		{
+			m_pMeshExporter->DropFrame();
+		}
+
+		ReadExportFrames(*m_pMeshExporter, false);
+
+		SetStatistic(L"TestCloth export [MB/s]", m_pMeshExporter->GetThroughput() / (1024.0 * 1024.0));
+		SetStatistic(L"TestCloth export dropped frames",
+			static_cast<double>(m_pMeshExporter->GetDroppedFrames()));
+	}
+
+	// hand the frames which reached the CPU to the exporter, in order
+	void ReadExportFrames(TestCloth::MeshExporter& meshExporter, bool wait)
+	{
+		auto read = [&](std::uint64_t step, const void* const* ppData)
+		{
+			meshExporter.AddFrame(step, static_cast<const DirectX::XMFLOAT4*>(ppData[0]),
+				static_cast<const DirectX::XMFLOAT4*>(ppData[1]),
+				static_cast<const std::uint32_t*>(ppData[2]));
+		};
+		while (m_ExportReadbacks.ReadNext(DXUTGetD3D11DeviceContext(), wait, read))
+		{
+		}
+	}
+
+	// take the latest bounds which reached the CPU, on the immediate context
+	void ReadBounds()
+	{
+		auto read = [&](std::uint64_t, const void* const* ppData)
+		{
+			auto pBounds = static_cast<const std::uint32_t*>(ppData[0]);
+			m_Bounds.Min = DirectX::XMFLOAT3(FromOrderedUint(pBounds[0]),
+				FromOrderedUint(pBounds[1]), FromOrderedUint(pBounds[2]));
+			m_Bounds.Max = DirectX::XMFLOAT3(FromOrderedUint(~pBounds[3]),
+				FromOrderedUint(~pBounds[4]), FromOrderedUint(~pBounds[5]));
+			m_HasBounds = true;
+		};
+		while (m_BoundsReadbacks.ReadNext(DXUTGetD3D11DeviceContext(), false, read))
+		{
+		}
+	}
+
+	void InitializeBounds()
+	{
+		m_pBoundsShader = CreateComputeShader(L"TestClothBounds.hlsl");
+		CreateRawBufferUAV(6 * sizeof(std::uint32_t), 0, m_pBoundsBuffer, m_pBoundsUAV);
+
+		const UINT size = 6 * sizeof(std::uint32_t);
+		m_BoundsReadbacks.Initialize(&size, 1);
+	}
+
+	void InitializeInterpolation()
+	{
+		if (m_desc.UpdateRate <= 0.0f)
+		{
+			return;
+		}
+
+		CreateStructuredBufferUAV(sizeof(DirectX::XMFLOAT4), m_Resolution * m_Resolution,
+			m_pPreviousPositionBuffer, m_pPreviousPositionSRV, m_pPreviousPositionUAV);
+		DXUTGetD3D11DeviceContext()->CopyResource(m_pPreviousPositionBuffer.get(),
+			m_SimBuffers[m_iRender].ClothPositionBuffer.get());
+	}
+
+	void InitializeUpsample(const std::shared_ptr<DetailBuffers>& pDetail)
+	{
+		if (m_desc.RenderResolution == 0)
+		{
+			return;
+		}
+
+		if (pDetail)
+		{
+			m_pDetail = pDetail;
+		}
+		else
+		{
+			const UINT numDetailParticles = m_desc.RenderResolution * m_desc.RenderResolution;
+			m_pDetail = std::make_shared<DetailBuffers>();
+			CreateStructuredBufferUAV(sizeof(DirectX::XMFLOAT4), numDetailParticles,
+				m_pDetail->PositionBuffer, m_pDetail->PositionSRV, m_pDetail->PositionUAV);
+			CreateStructuredBufferUAV(sizeof(DirectX::XMFLOAT4), numDetailParticles,
+				m_pDetail->NormalBuffer, m_pDetail->NormalSRV, m_pDetail->NormalUAV);
+			CreateStructuredBufferUAV(sizeof(std::uint32_t), numDetailParticles,
+				m_pDetail->LinkBuffer, m_pDetail->LinkSRV, m_pDetail->LinkUAV);
+		}
+
+		m_pUpsampleConstants = CreateConstantBuffer(sizeof(CB_TEST_CLOTH_UPSAMPLE), true);
+		m_pUpsampleShader = CreateComputeShader(L"TestClothUpsample.hlsl");
+	}
+
+	// reconstruct the render grid from the blended simulated positions,
+	// unless it is up to date with them already
+	void Upsample() const
+	{
+		if (!m_DetailStale)
+		{
+			return;
+		}
+
+		auto pCTX = DXUTGetD3D11DeviceContext();
+
+		D3D11_MAPPED_SUBRESOURCE subres;
+		if (FAILED(pCTX->Map(m_pUpsampleConstants.get(), 0,
+			D3D11_MAP_WRITE_DISCARD, 0, &subres)))
+		{
+			throw std::runtime_error("Failed to map constant buffer");
+		}
+		auto& cbUpsample = *reinterpret_cast<CB_TEST_CLOTH_UPSAMPLE*>(subres.pData);
+		cbUpsample.ClothResolution = DirectX::XMUINT2(m_Resolution, m_Resolution);
+		cbUpsample.RenderResolution =
+			DirectX::XMUINT2(m_desc.RenderResolution, m_desc.RenderResolution);
+		cbUpsample.RenderAlpha = m_RenderAlpha;
+		cbUpsample.RestLength = 2.0f / (m_Resolution - 1);
+		cbUpsample.WrinkleAmplitude = m_desc.WrinkleAmplitude;
+		pCTX->Unmap(m_pUpsampleConstants.get(), 0);
+
+		const auto& buffers = m_SimBuffers[m_iRender];
+
+		ID3D11ShaderResourceView* pSRVs[3] =
+		{
+			buffers.ClothPositionSRV.get(),
+			m_pPreviousPositionSRV ? m_pPreviousPositionSRV.get() : buffers.ClothPositionSRV.get(),
+			buffers.ClothLinkSRV.get(),
+		};
+
+		ID3D11UnorderedAccessView* pUAVs[3] =
+		{
+			m_pDetail->PositionUAV.get(),
+			m_pDetail->NormalUAV.get(),
+			m_pDetail->LinkUAV.get(),
+		};
+
+		ID3D11Buffer* pConstants = m_pUpsampleConstants.get();
+
+		pCTX->CSSetShader(m_pUpsampleShader.get(), nullptr, 0);
+		pCTX->CSSetShaderResources(0, 3, pSRVs);
+		pCTX->CSSetUnorderedAccessViews(0, 3, pUAVs, nullptr);
+		pCTX->CSSetConstantBuffers(0, 1, &pConstants);
+
+		pCTX->Dispatch((m_desc.RenderResolution + 127) / 128,
+			(m_desc.RenderResolution + 1) / 2, 1);
+
+		for (int i = 0; i < 3; i++)
+		{
+			pSRVs[i] = nullptr;
+			pUAVs[i] = nullptr;
+		}
+		pCTX->CSSetShaderResources(0, 3, pSRVs);
+		pCTX->CSSetUnorderedAccessViews(0, 3, pUAVs, nullptr);
+
+		m_DetailStale = false;
+	}
+
+	void InitializeResample()
+	{
+		if (m_desc.Levels.empty())
+		{
+			return;
+		}
+
+		m_pResampleConstants = CreateConstantBuffer(sizeof(CB_TEST_CLOTH_RESAMPLE), true);
+		m_pResampleShader = CreateComputeShader(L"TestClothResample.hlsl");
+	}
+
+	void InitializeUpdateContext()
+	{
+		ID3D11DeviceContext* pCTX;
+		if (FAILED(DXUTGetD3D11Device()->CreateDeferredContext(0, &pCTX)))
+		{
+			throw std::runtime_error("Failed to create deferred context");
+		}
+		m_pUpdateCTX = ComPtr<ID3D11DeviceContext>(pCTX, false);
+	}
+
+public:
+	// pDetail shares the render grid of another level of detail, which is
+	// never rendered at the same time. null creates the grid, if any.
+	void Initialize(const TestCloth::Desc& desc,
+		const std::shared_ptr<DetailBuffers>& pDetail = nullptr)
+	{
+		if (desc.Resolution < 3)
+		{
+			throw std::runtime_error("Cloth resolution must be at least 3");
+		}
+		if (desc.RenderResolution != 0 &&
+			(desc.RenderResolution < 2 || desc.RenderResolution > TestCloth::MAX_RENDER_RESOLUTION))
+		{
+			throw std::runtime_error("Cloth render resolution must be between 2 and " +
+				std::to_string(TestCloth::MAX_RENDER_RESOLUTION));
+		}
+		if (desc.StrainLimitIterations > TestCloth::MAX_STRAIN_LIMIT_ITERATIONS)
+		{
+			throw std::runtime_error("Too many cloth strain limit iterations");
+		}
+		if (!(desc.TimeStep > 0.0f) || !std::isfinite(desc.TimeStep))
+		{
+			throw std::runtime_error("Cloth time step must be positive");
+		}
+		if (!desc.Corners.empty() && desc.Corners.size() != 4)
+		{
+			throw std::runtime_error("Cloth must have 4 corners or none");
+		}
+		for (const auto& collider : desc.Colliders)
+		{
+			const auto& normal = collider.Normal;
+			if (collider.Shape == TestCloth::ColliderShape::Plane &&
+				normal.x == 0.0f && normal.y == 0.0f && normal.z == 0.0f)
+			{
+				throw std::runtime_error("Plane collider normal must not be zero");
+			}
+		}
+
+		m_desc = desc;
+		m_Resolution = desc.Resolution;
+
+		// initialize normals
+		InitializeNormals();
+
+		// initialize gpu buffers
+		InitializeBuffers(m_SimBuffers[0]);
+		InitializeBuffers(m_SimBuffers[1]);
+		InitializeBufferContents();
+
+		// initialize shaders
+		InitializeVertexShader();
+		InitializeGeometryShader();
+		InitializePixelShader();
+
+		// initialize constant buffer
+		InitializeConstantBuffer();
+
+		// initialize rasterizer state
+		InitializeRasterizerState();
+
+		// initialize shader
+		InitializeShader();
+
+		// initialize triangle membrane
+		InitializeMembrane();
+
+		// initialize hinge bending
+		InitializeHinges();
+
+		// initialize strain limiting
+		InitializeStrainLimiting();
+
+		// initialize collision with static colliders
+		InitializeColliders();
+
+		// initialize pinned particles
+		InitializeAttachments();
+
+		// initialize positions interpolated from
+		InitializeInterpolation();
+
+		// initialize bounds reduction and readback
+		InitializeBounds();
+
+		// initialize reconstruction of the render grid
+		InitializeUpsample(pDetail);
+
+		// initialize state transfer between levels of detail
+		InitializeResample();
+
+		// initialize deferred context recording steps
+		InitializeUpdateContext();
+	}
+
+	// copy a buffer into CPU memory, stalling until the GPU has written it
+	static void ReadBuffer(ID3D11Buffer* pBuffer, void* pDest, std::size_t size)
+	{
+		D3D11_BUFFER_DESC bufferDesc;
+		pBuffer->GetDesc(&bufferDesc);
+
+		ComPtr<ID3D11Buffer> staging;
+		CreateStagingBuffer(bufferDesc.ByteWidth, staging);
+		auto pStaging = staging.get();
+
+		auto pCTX = DXUTGetD3D11DeviceContext();
+		pCTX->CopyResource(pStaging, pBuffer);
+
+		D3D11_MAPPED_SUBRESOURCE subres;
+		if (FAILED(pCTX->Map(pStaging, 0, D3D11_MAP_READ, 0, &subres)))
+		{
+			throw std::runtime_error("Failed to map buffer");
+		}
+		std::memcpy(pDest, subres.pData, size);
+		pCTX->Unmap(pStaging, 0);
+	}
+
+	// write the published state, see TestClothSnapshot.h
+	void SaveSnapshot(const std::wstring& fileName) const override
+	{
+		SaveSnapshot(fileName, m_desc);
+	}
+
+	// the same with the parameters of desc, which levels of detail are made from
+	void SaveSnapshot(const std::wstring& fileName, const TestCloth::Desc& desc) const
+	{
+		auto header = TestCloth::MakeSnapshotHeader(desc, m_Resolution, m_StepCount);
+		const std::size_t numParticles = m_Resolution * m_Resolution;
+
+		std::vector<std::uint8_t> data(TestCloth::GetSnapshotSize(header));
+		std::memcpy(data.data(), &header, sizeof(header));
+		TestCloth::WriteSnapshotColliders(desc, header, data.data());
+
+		const auto& buffers = m_SimBuffers[m_iRender];
+		ReadBuffer(buffers.ClothPositionBuffer.get(), &data[static_cast<std::size_t>(header.PositionOffset)],
+			numParticles * sizeof(DirectX::XMFLOAT4));
+		ReadBuffer(buffers.ClothVelocityBuffer.get(), &data[static_cast<std::size_t>(header.VelocityOffset)],
+			numParticles * sizeof(DirectX::XMFLOAT4));
+		ReadBuffer(buffers.ClothLinkBuffer.get(), &data[static_cast<std::size_t>(header.LinkOffset)],
+			numParticles * sizeof(std::uint32_t));
+
+		WriteWholeFile(fileName, data.data(), data.size());
+	}
+
+	// upload a validated snapshot of the same resolution straight from its
+	// mapping. call between publishes, while no step is being recorded.
+	void RestoreSnapshot(const TestCloth::SnapshotHeader& header, const std::uint8_t* pData)
+	{
+		if (header.Resolution != m_Resolution)
+		{
+			throw std::runtime_error("Snapshot resolution does not match the cloth");
+		}
+
+		auto pCTX = DXUTGetD3D11DeviceContext();
+		const auto& buffers = m_SimBuffers[m_iFrom];
+		pCTX->UpdateSubresource(buffers.ClothPositionBuffer.get(), 0, nullptr,
+			pData + header.PositionOffset, 0, 0);
+		pCTX->UpdateSubresource(buffers.ClothVelocityBuffer.get(), 0, nullptr,
+			pData + header.VelocityOffset, 0, 0);
+		pCTX->UpdateSubresource(buffers.ClothLinkBuffer.get(), 0, nullptr,
+			pData + header.LinkOffset, 0, 0);
+
+		// normals are not stored, the first published state is rendered with them
+		if (!m_pNormalShader)
+		{
+			m_pNormalShader = CreateComputeShader(L"TestClothNormals.hlsl");
+		}
+		WriteUpdateConstants(pCTX);
+		ComputeNormals(pCTX, buffers);
+
+		// nothing to interpolate from yet
+		if (m_pPreviousPositionBuffer)
+		{
+			pCTX->CopyResource(m_pPreviousPositionBuffer.get(),
+				buffers.ClothPositionBuffer.get());
+		}
+
+		m_pUpdateCommands.reset();
+		m_iRender = m_iFrom;
+		m_StepCount = header.StepCount;
+		m_DetailStale = true;
+
+		m_BoundsReadbacks.Discard();
+		m_HasBounds = false;
+	}
+
+	const std::shared_ptr<DetailBuffers>& GetDetailBuffers() const
+	{
+		return m_pDetail;
+	}
+
+	std::uint32_t GetResolution() const
+	{
+		return m_Resolution;
+	}
+
+	// stream the published positions to a cache file, see TestClothCache.h
+	void StartRecording(const std::wstring& fileName) override
+	{
+		StopRecording();
+
+		if (!m_CacheReadbacks.IsInitialized())
+		{
+			const UINT size = sizeof(DirectX::XMFLOAT4) * m_Resolution * m_Resolution;
+			m_CacheReadbacks.Initialize(&size, 1);
+		}
+
+		m_pCacheWriter.reset(new TestCloth::CacheWriter(fileName, m_Resolution));
+	}
+
+	void StopRecording() override
+	{
+		if (!m_pCacheWriter)
+		{
+			return;
+		}
+
+		// the recording ends even if its last frames fail
+		std::unique_ptr<TestCloth::CacheWriter> pCacheWriter;
+		pCacheWriter.swap(m_pCacheWriter);
+
+		// wait for the frames still in flight
+		try
+		{
+			ReadCacheFrames(*pCacheWriter, true);
+		}
+		catch (...)
+		{
+			m_CacheReadbacks.Discard();
+			throw;
+		}
+		pCacheWriter->Close();
+	}
+
+	// write the published mesh of every step to a file of its own,
+	// see TestClothExport.h
+	void StartExport(const std::wstring& fileNamePrefix, TestCloth::ExportFormat format) override
+	{
+		StopExport();
+
+		if (!m_ExportReadbacks.IsInitialized())
+		{
+			const UINT sizes[] =
+			{
+				sizeof(DirectX::XMFLOAT4) * m_Resolution * m_Resolution,
+				sizeof(DirectX::XMFLOAT4) * m_Resolution * m_Resolution,
+				sizeof(std::uint32_t) * m_Resolution * m_Resolution,
+			};
+			m_ExportReadbacks.Initialize(sizes, 3);
+		}
+
+		m_pMeshExporter.reset(new TestCloth::MeshExporter(fileNamePrefix, format, m_Resolution));
+	}
+
+	void StopExport() override
+	{
+		if (!m_pMeshExporter)
+		{
+			return;
+		}
+
+		// the export ends even if its last frames fail
+		std::unique_ptr<TestCloth::MeshExporter> pMeshExporter;
+		pMeshExporter.swap(m_pMeshExporter);
+
+		// wait for the frames still in flight
+		try
+		{
+			ReadExportFrames(*pMeshExporter, true);
+		}
+		catch (...)
+		{
+			m_ExportReadbacks.Discard();
+			throw;
+		}
+		pMeshExporter->Close();
+	}
+
+	// replace the simulation by the positions of a cache file, from its first
+	// frame on. the update thread may be recording a step meanwhile, so the
+	// reader is only handed over by PublishImpl().
+	void StartPlayback(const std::wstring& fileName) override
+	{
+		StartPlayback(std::unique_ptr<TestCloth::CacheReader>(new TestCloth::CacheReader(fileName)));
+	}
+
+	void StartPlayback(std::unique_ptr<TestCloth::CacheReader> pCacheReader)
+	{
+		if (pCacheReader->GetResolution() != m_Resolution)
+		{
+			throw std::runtime_error("Cache resolution does not match the cloth");
+		}
+
+		if (!m_pNormalShader)
+		{
+			m_pNormalShader = CreateComputeShader(L"TestClothNormals.hlsl");
+		}
+
+		m_pPendingCacheReader.swap(pCacheReader);
+		m_StopPlayback = false;
+		m_PendingSeek = 0.0;
+	}
+
+	// simulate on from the state played back last
+	void StopPlayback() override
+	{
+		m_pPendingCacheReader.reset();
+		m_StopPlayback = true;
+	}
+
+	void SeekPlayback(double numSteps) override
+	{
+		m_PendingSeek += numSteps;
+	}
+
+	// take over the published state of the same cloth simulated at another
+	// level of detail, on the immediate context (see TestClothResample.hlsl)
+	void ResampleFrom(const TestClothObject& source)
+	{
+		auto pCTX = DXUTGetD3D11DeviceContext();
+
+		D3D11_MAPPED_SUBRESOURCE subres;
+		if (FAILED(pCTX->Map(m_pResampleConstants.get(), 0,
+			D3D11_MAP_WRITE_DISCARD, 0, &subres)))
+		{
+			throw std::runtime_error("Failed to map constant buffer");
+		}
+		auto& cbResample = *reinterpret_cast<CB_TEST_CLOTH_RESAMPLE*>(subres.pData);
+		cbResample.SourceResolution = DirectX::XMUINT2(source.m_Resolution, source.m_Resolution);
+		cbResample.TargetResolution = DirectX::XMUINT2(m_Resolution, m_Resolution);
+		pCTX->Unmap(m_pResampleConstants.get(), 0);
+
+		const auto& buffersFrom = source.m_SimBuffers[source.m_iRender];
+		const auto& buffersTo = m_SimBuffers[m_iFrom];
+
+		ID3D11ShaderResourceView* pSRVs[5] =
+		{
+			buffersFrom.ClothPositionSRV.get(),
+			buffersFrom.ClothVelocitySRV.get(),
+			source.m_pClothNormalSRV.get(),
+			buffersFrom.ClothLinkSRV.get(),
+			source.m_pPreviousPositionSRV.get(),
+		};
+
+		ID3D11UnorderedAccessView* pUAVs[5] =
+		{
+			buffersTo.ClothPositionUAV.get(),
+			buffersTo.ClothVelocityUAV.get(),
+			m_pClothNormalUAV.get(),
+			buffersTo.ClothLinkUAV.get(),
+			m_pPreviousPositionUAV.get(),
+		};
+
+		ID3D11Buffer* pConstants = m_pResampleConstants.get();
+
+		pCTX->CSSetShader(m_pResampleShader.get(), nullptr, 0);
+		pCTX->CSSetShaderResources(0, 5, pSRVs);
+		pCTX->CSSetUnorderedAccessViews(0, 5, pUAVs, nullptr);
+		pCTX->CSSetConstantBuffers(0, 1, &pConstants);
+
+		DispatchGrid(pCTX);
+
+		for (int i = 0; i < 5; i++)
+		{
+			pSRVs[i] = nullptr;
+			pUAVs[i] = nullptr;
+		}
+		pCTX->CSSetShaderResources(0, 5, pSRVs);
+		pCTX->CSSetUnorderedAccessViews(0, 5, pUAVs, nullptr);
+
+		m_iRender = m_iFrom;
+		m_RenderAlpha = source.m_RenderAlpha;
+		m_StepCount = source.m_StepCount;
+		m_DetailStale = true;
+
+		// readbacks from the last time this level was active are stale,
+		// keep the bounds of the source until this level's reach the CPU
+		m_BoundsReadbacks.Discard();
+		m_Bounds = source.m_Bounds;
+		m_HasBounds = source.m_HasBounds;
+	}
+
+private:
+	void UpdateImpl() override
+	{
+		CpuTimer timer;
+
+		// record the step on the deferred context, possibly on a worker thread.
+		// the buffer being rendered (m_iRender) is only read, never written.
+		if (m_pCacheReader)
+		{
+			PlayBackStep(m_SimBuffers[m_iFrom], m_SimBuffers[m_iFrom ^ 1]);
+		}
+		else
+		{
+			UpdateBuffer(m_SimBuffers[m_iFrom], m_SimBuffers[m_iFrom ^ 1]);
+		}
+		m_iFrom ^= 1;
+		ComputeBounds(m_SimBuffers[m_iFrom]);
+
+		ID3D11CommandList* pCommandList;
+		if (FAILED(m_pUpdateCTX->FinishCommandList(FALSE, &pCommandList)))
+		{
+			throw std::runtime_error("Failed to finish command list");
+		}
+		m_pUpdateCommands = ComPtr<ID3D11CommandList>(pCommandList, false);
+
+		m_UpdateCost = m_UpdateCost * 0.9f + static_cast<float>(timer.GetMilliseconds()) * 0.1f;
+	}
+
+	void PublishImpl() override
+	{
+		ApplyPlaybackRequests();
+
+		if (!m_pUpdateCommands)
+		{
+			return;
+		}
+
+		// keep the positions rendered so far to interpolate from
+		auto pCTX = DXUTGetD3D11DeviceContext();
+		if (m_pPreviousPositionBuffer)
+		{
+			pCTX->CopyResource(m_pPreviousPositionBuffer.get(),
+				m_SimBuffers[m_iRender].ClothPositionBuffer.get());
+		}
+
+		// submit the recorded step, then render the buffers it wrote. only the
+		// submission is serial, the steps of the cloths were recorded by the
+		// update chunks of the ObjectList in parallel.
+		m_UpdateTimer.Begin();
+		pCTX->ExecuteCommandList(m_pUpdateCommands.get(), TRUE);
+		m_UpdateTimer.End();
+
+		m_pUpdateCommands.reset();
+		m_iRender = m_iFrom;
+		m_StepCount++;
+		m_DetailStale = true;
+		RecordCacheFrame();
+		ExportFrame();
+		ReadBounds();
+
+		if (m_pCacheReader)
+		{
+			SetStatistic(L"TestCloth playback step", m_PlaybackStep);
+			SetStatistic(L"TestCloth playback stalls",
+				static_cast<double>(m_pCacheReader->GetStalls()));
+			return;
+		}
+
+		// GPU cost per step, to compare the membrane models per asset
+		SetStatistic(m_desc.Model == TestCloth::MembraneModel::Triangles ?
+			L"TestCloth step, triangles [ms]" : L"TestCloth step, springs [ms]",
+			m_UpdateTimer.GetMilliseconds());
 	}
 
-	void InitializeBufferContents()
+	// take over the playback requests made since the last publish,
+	// while the update thread is idle
+	void ApplyPlaybackRequests()
 	{
-		HRESULT hr;
-
-		ID3DBlob* pShaderBuffer;
-		hr = DXUTCompileFromFile(L"TestClothInit.hlsl", nullptr, "main",
-			"cs_5_0", 0, 0, &pShaderBuffer);
-		if (FAILED(hr))
+		if (m_pPendingCacheReader)
 		{
-			throw std::runtime_error("Failed to compile compute shader");
+			m_pCacheReader.swap(m_pPendingCacheReader);
+			m_pPendingCacheReader.reset();
+			m_PlaybackStep = static_cast<double>(m_pCacheReader->GetFirstStep());
+			m_HasPlaybackPositions = false;
 		}
-
-		ID3D11ComputeShader* pShaderRaw;
-		hr = DXUTGetD3D11Device()->CreateComputeShader(
-			pShaderBuffer->GetBufferPointer(),
-			pShaderBuffer->GetBufferSize(),
-			nullptr, &pShaderRaw);
-		if (FAILED(hr))
+		else if (m_StopPlayback)
 		{
-			pShaderBuffer->Release();
-			throw std::runtime_error("Failed to create compute shader");
+			m_pCacheReader.reset();
 		}
-		pShaderBuffer->Release();
-		ComPtr<ID3D11ComputeShader> pShader(pShaderRaw, false);
+		m_StopPlayback = false;
 
-		struct CB_TEST_CLOTH_INIT
+		if (m_PendingSeek != 0.0 && m_pCacheReader)
 		{
-			DirectX::XMFLOAT4 FourPositions[4];
-			DirectX::XMUINT2 ClothResolution, dummy;
-		}  cbTestClothInit;
+			m_PlaybackStep = std::min(std::max(m_PlaybackStep + m_PendingSeek,
+				static_cast<double>(m_pCacheReader->GetFirstStep())),
+				static_cast<double>(m_pCacheReader->GetLastStep()));
+			m_HasPlaybackPositions = false;
+		}
+		m_PendingSeek = 0.0;
+	}
 
-		float SQRT2 = std::sqrtf(2.0f);
-		cbTestClothInit.FourPositions[0] = DirectX::XMFLOAT4(-1.0f, 1.0f, 0.0f, 1.0f);
-		cbTestClothInit.FourPositions[1] = DirectX::XMFLOAT4( 1.0f, 1.0f, 0.0f, 1.0f);
-		cbTestClothInit.FourPositions[2] = DirectX::XMFLOAT4(-1.0f, SQRT2 - 1.0f, SQRT2, 1.0f);
-		cbTestClothInit.FourPositions[3] = DirectX::XMFLOAT4( 1.0f, SQRT2 - 1.0f, SQRT2, 1.0f);
-		cbTestClothInit.ClothResolution.x = NDIM_HORIZONTAL;
-		cbTestClothInit.ClothResolution.y = NDIM_VERTICAL;
+	// record a step uploading the next cached positions instead of simulating.
+	// velocities are their difference to the positions played back before, so
+	// that simulation continues smoothly once playback stops. links are not
+	// cached and kept as they were.
+	void PlayBackStep(const SimulationBuffers& buffersFrom, SimulationBuffers& buffersTo)
+	{
+		auto pCTX = m_pUpdateCTX.get();
+		WriteUpdateConstants(pCTX);
 
-		ID3D11Buffer* pConstBufferRaw;
-		D3D11_BUFFER_DESC bufferDesc;
-		ZeroMemory(&bufferDesc, sizeof(bufferDesc));
-		bufferDesc.ByteWidth = sizeof(cbTestClothInit);
-		bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		const std::size_t numParticles = m_Resolution * m_Resolution;
+		m_PlaybackPositions.resize(numParticles);
+		m_PlaybackVelocities.resize(numParticles);
+		m_PlaybackPreviousPositions.resize(numParticles);
 
-		D3D11_SUBRESOURCE_DATA subresData;
-		ZeroMemory(&subresData, sizeof(subresData));
-		subresData.pSysMem = &cbTestClothInit;
-		hr = DXUTGetD3D11Device()->CreateBuffer(&bufferDesc,
-			&subresData, &pConstBufferRaw);
-		if (FAILED(hr))
+		pCTX->CopyResource(buffersTo.ClothLinkBuffer.get(), buffersFrom.ClothLinkBuffer.get());
+
+		// hold the cloth while the reader thread catches up
+		if (!m_pCacheReader->GetPositions(m_PlaybackStep, m_PlaybackPositions.data()))
 		{
-			throw std::runtime_error("Failed to create buffer");
+			pCTX->CopyResource(buffersTo.ClothPositionBuffer.get(), buffersFrom.ClothPositionBuffer.get());
+			pCTX->CopyResource(buffersTo.ClothVelocityBuffer.get(), buffersFrom.ClothVelocityBuffer.get());
+			return;
 		}
-		ComPtr<ID3D11Buffer> pConstBuffer(pConstBufferRaw, false);
 
-		ID3D11UnorderedAccessView* pUAVs[2] = {
-			m_SimBuffers[0].ClothPositionUAV.get(),
-			m_SimBuffers[0].ClothVelocityUAV.get(),
-		};
+		for (std::size_t i = 0; i < numParticles; i++)
+		{
+			const auto& position = m_PlaybackPositions[i];
+			const auto& previous = m_PlaybackPreviousPositions[i];
+			auto& velocity = m_PlaybackVelocities[i];
+			if (m_HasPlaybackPositions)
+			{
+				velocity.x = (position.x - previous.x) / m_desc.TimeStep;
+				velocity.y = (position.y - previous.y) / m_desc.TimeStep;
+				velocity.z = (position.z - previous.z) / m_desc.TimeStep;
+			}
+			else
+			{
+				velocity.x = velocity.y = velocity.z = 0.0f;
+			}
+			velocity.w = 0.0f;
+		}
 
-		auto pCTX = DXUTGetD3D11DeviceContext();
-		pCTX->CSSetShader(pShader.get(), nullptr, 0);
-		pCTX->CSSetConstantBuffers(0, 1, &pConstBufferRaw);
-		pCTX->CSSetUnorderedAccessViews(0, 2, pUAVs, nullptr);
+		pCTX->UpdateSubresource(buffersTo.ClothPositionBuffer.get(), 0, nullptr,
+			m_PlaybackPositions.data(), 0, 0);
+		pCTX->UpdateSubresource(buffersTo.ClothVelocityBuffer.get(), 0, nullptr,
+			m_PlaybackVelocities.data(), 0, 0);
+		m_PlaybackPositions.swap(m_PlaybackPreviousPositions);
+		m_HasPlaybackPositions = true;
 
-		pCTX->Dispatch(1, 64, 1);
+		// the last frame is held once playback reaches it
+		m_PlaybackStep = std::min(m_PlaybackStep + 1.0,
+			static_cast<double>(m_pCacheReader->GetLastStep()));
 
-		pUAVs[0] = nullptr;
-		pUAVs[1] = nullptr;
-		pConstBufferRaw = nullptr;
+		ComputeNormals(pCTX, buffersTo);
+	}
 
-		pCTX->CSSetShader(nullptr, nullptr, 0);
-		pCTX->CSSetConstantBuffers(0, 1, &pConstBufferRaw);
-		pCTX->CSSetUnorderedAccessViews(0, 2, pUAVs, nullptr);
+	// normals of positions that were uploaded rather than simulated,
+	// with the update constants of pCTX already written
+	void ComputeNormals(ID3D11DeviceContext* pCTX, const SimulationBuffers& buffers)
+	{
+		ID3D11ShaderResourceView* pSRV = buffers.ClothPositionSRV.get();
+		ID3D11UnorderedAccessView* pUAV = m_pClothNormalUAV.get();
+		ID3D11Buffer* pConstants = m_pUpdateConstants.get();
+		pCTX->CSSetShader(m_pNormalShader.get(), nullptr, 0);
+		pCTX->CSSetShaderResources(0, 1, &pSRV);
+		pCTX->CSSetUnorderedAccessViews(0, 1, &pUAV, nullptr);
+		pCTX->CSSetConstantBuffers(0, 1, &pConstants);
+
+		DispatchGrid(pCTX);
+
+		pSRV = nullptr;
+		pUAV = nullptr;
+		pCTX->CSSetShaderResources(0, 1, &pSRV);
+		pCTX->CSSetUnorderedAccessViews(0, 1, &pUAV, nullptr);
 	}
 
-	void InitializeShader()
+	void InterpolateImpl(float alpha) override
 	{
-		ID3DBlob* pShaderBuffer;
-		if (FAILED(DXUTCompileFromFile(L"TestClothUpdate.hlsl", nullptr, "main", "cs_5_0", 0, 0, &pShaderBuffer)))
+		if (alpha != m_RenderAlpha)
 		{
-			throw std::runtime_error("Failed to compile compute shader");
+			m_RenderAlpha = alpha;
+			m_DetailStale = true;
 		}
+	}
 
-		ID3D11ComputeShader* pShader;
-		if (FAILED(DXUTGetD3D11Device()->CreateComputeShader(pShaderBuffer->GetBufferPointer(),
-			pShaderBuffer->GetBufferSize(), nullptr, &pShader)))
+	bool GetBoundsImpl(ObjectBounds& bounds) const override
+	{
+		if (!m_HasBounds)
 		{
-			pShaderBuffer->Release();
-			throw std::runtime_error("Failed to create compute shader");
+			return false;
 		}
 
-		pShaderBuffer->Release();
+		// bounds lag a few steps behind, so leave room for the motion since
+		auto margin = 0.1f * std::max(m_Bounds.Max.x - m_Bounds.Min.x,
+			std::max(m_Bounds.Max.y - m_Bounds.Min.y, m_Bounds.Max.z - m_Bounds.Min.z));
 
-		ComPtr<ID3D11ComputeShader>(pShader, false)
-			.swap(m_pUpdateShader);
+		// the render grid leaves the particles by the overshoot of its
+		// Catmull-Rom surface, below 1.5 cells, and by the wrinkles along
+		// both directions, each up to 2 / pi of a cell at rest length
+		if (m_desc.RenderResolution != 0)
+		{
+			auto restLength = 2.0f / (m_Resolution - 1);
+			margin += 1.5f * restLength * (1.0f + m_desc.StrainLimit) +
+				4.0f / DirectX::XM_PI * restLength * m_desc.WrinkleAmplitude;
+		}
+		bounds.Min = DirectX::XMFLOAT3(m_Bounds.Min.x - margin,
+			m_Bounds.Min.y - margin, m_Bounds.Min.z - margin);
+		bounds.Max = DirectX::XMFLOAT3(m_Bounds.Max.x + margin,
+			m_Bounds.Max.y + margin, m_Bounds.Max.z + margin);
+		return true;
 	}
 
-public:
-	void Initialize(const TestCloth::Desc& desc)
+	UpdateSchedule GetScheduleImpl() const override
 	{
-		m_desc = desc;
-
-		// initialize normals
-		InitializeNormals();
-
-		// initialize gpu buffers
-		InitializeBuffers(m_SimBuffers[0]);
-		InitializeBuffers(m_SimBuffers[1]);
-		InitializeBufferContents();
-
-		// initialize shaders
-		InitializeVertexShader();
-		InitializeGeometryShader();
-		InitializePixelShader();
-
-		// initialize constant buffer
-		InitializeConstantBuffer();
-
-		// initialize rasterizer state
-		InitializeRasterizerState();
-
-		// initialize shader
-		InitializeShader();
+		UpdateSchedule schedule;
+		schedule.Rate = m_desc.UpdateRate;
+		// recording the step is cheap next to running it, so the GPU time of
+		// the last steps is counted too
+		schedule.Cost = m_UpdateCost + static_cast<float>(m_UpdateTimer.GetMilliseconds());
+		schedule.Priority = m_desc.UpdatePriority;
+		return schedule;
 	}
 
-private:
-	void UpdateImpl() override
+	void DeclareAccessImpl(ObjectAccess& access) const override
 	{
-		UpdateBuffer(m_SimBuffers[m_iFrom], m_SimBuffers[m_iFrom ^ 1]);
-		m_iFrom ^= 1;
+		// every object records on its own deferred context,
+		// so only attachments driven by other objects order the updates
+		for (const auto& attachment : m_desc.Attachments)
+		{
+			if (attachment.TransformSource)
+			{
+				access.Reads.push_back(attachment.TransformSource);
+			}
+		}
 	}
 
 	void RenderImpl() const override
@@ -541,6 +2566,14 @@ private:
 
 		auto pCTX = DXUTGetD3D11DeviceContext();
 
+		// draw the reconstructed grid, which is blended already
+		const bool detail = m_desc.RenderResolution != 0;
+		if (detail)
+		{
+			Upsample();
+		}
+		const std::uint32_t resolution = detail ? m_desc.RenderResolution : m_Resolution;
+
 		// update constant buffer
 		D3D11_MAPPED_SUBRESOURCE cbTestClothRes;
 		hr = pCTX->Map(m_pTestClothConstants.get(),
@@ -555,8 +2588,9 @@ private:
 			*reinterpret_cast<CB_TEST_CLOTH*>(cbTestClothRes.pData);
 		cbTestCloth.WorldView = DirectX::XMMatrixTranspose(pCamera->GetViewMatrix());
 		cbTestCloth.Projection = DirectX::XMMatrixTranspose(pCamera->GetProjMatrix());
-		cbTestCloth.ClothResolution.x = NDIM_HORIZONTAL;
-		cbTestCloth.ClothResolution.y = NDIM_VERTICAL;
+		cbTestCloth.ClothResolution.x = resolution;
+		cbTestCloth.ClothResolution.y = resolution;
+		cbTestCloth.RenderAlpha = detail ? 1.0f : m_RenderAlpha;
 		pCTX->Unmap(m_pTestClothConstants.get(), 0);
 
 		pCTX->VSSetShader(m_pTestClothVS.get(),
@@ -569,13 +2603,18 @@ private:
 		// vs shader resources
 
 		// gs shader resources
-		ID3D11ShaderResourceView* pSRV =
-			m_SimBuffers[m_iFrom].ClothPositionSRV.get();
+		ID3D11ShaderResourceView* pPositionSRV = detail ? m_pDetail->PositionSRV.get() :
+			m_SimBuffers[m_iRender].ClothPositionSRV.get();
+		ID3D11ShaderResourceView* pSRV = pPositionSRV;
 		ID3D11Buffer* pConstantBuffer = m_pTestClothConstants.get();
 		pCTX->GSSetConstantBuffers(0, 1, &pConstantBuffer);
 		pCTX->GSSetShaderResources(0, 1, &pSRV);
-		pSRV = m_pClothNormalSRV.get();
+		pSRV = detail ? m_pDetail->NormalSRV.get() : m_pClothNormalSRV.get();
 		pCTX->GSSetShaderResources(1, 1, &pSRV);
+		pSRV = detail ? m_pDetail->LinkSRV.get() : m_SimBuffers[m_iRender].ClothLinkSRV.get();
+		pCTX->GSSetShaderResources(2, 1, &pSRV);
+		pSRV = !detail && m_pPreviousPositionSRV ? m_pPreviousPositionSRV.get() : pPositionSRV;
+		pCTX->GSSetShaderResources(3, 1, &pSRV);
 
 		// ps shader resources (no resources)
 
@@ -587,11 +2626,13 @@ private:
 		// rasterizer state
 		pCTX->RSSetState(m_pRasterizerState.get());
 
-		pCTX->Draw(NDIM_VERTICAL * NDIM_HORIZONTAL, 0);
+		pCTX->Draw(resolution * resolution, 0);
 
 		pSRV = nullptr;
 		pCTX->GSSetShaderResources(0, 1, &pSRV);
 		pCTX->GSSetShaderResources(1, 1, &pSRV);
+		pCTX->GSSetShaderResources(2, 1, &pSRV);
+		pCTX->GSSetShaderResources(3, 1, &pSRV);
 	}
 
 private:
@@ -605,19 +2646,469 @@ private:
 	ComPtr<ID3D11RasterizerState> m_pRasterizerState;
 	ComPtr<ID3D11ComputeShader> m_pUpdateShader;
 	ComPtr<ID3D11Buffer> m_pUpdateConstants;
+	ComPtr<ID3D11ComputeShader> m_pAttachShader;
+	ComPtr<ID3D11Buffer> m_pAttachConstants;
+	ComPtr<ID3D11Buffer> m_pPinnedParticleBuffer;
+	ComPtr<ID3D11ShaderResourceView> m_pPinnedParticleSRV;
+	ComPtr<ID3D11Buffer> m_pAttachTransformBuffer;
+	ComPtr<ID3D11ShaderResourceView> m_pAttachTransformSRV;
+	std::uint32_t m_NumPinnedParticles = 0;
+	ComPtr<ID3D11ComputeShader> m_pCollideShader;
+	ComPtr<ID3D11Buffer> m_pColliderBuffer;
+	ComPtr<ID3D11ShaderResourceView> m_pColliderSRV;
+	ComPtr<ID3D11ComputeShader> m_pMembraneShader;
+	ComPtr<ID3D11Buffer> m_pTriangleInvRestBuffer;
+	ComPtr<ID3D11ShaderResourceView> m_pTriangleInvRestSRV;
+	ComPtr<ID3D11Buffer> m_pTriangleAreaBuffer;
+	ComPtr<ID3D11ShaderResourceView> m_pTriangleAreaSRV;
+	ComPtr<ID3D11Buffer> m_pTriangleForceBuffer;
+	ComPtr<ID3D11ShaderResourceView> m_pTriangleForceSRV;
+	ComPtr<ID3D11UnorderedAccessView> m_pTriangleForceUAV;
+	std::uint32_t m_NumTriangles = 0;
+	ComPtr<ID3D11ComputeShader> m_pHingeShader;
+	ComPtr<ID3D11Buffer> m_pHingeConstants;
+	ComPtr<ID3D11Buffer> m_pHingeBuffer;
+	ComPtr<ID3D11ShaderResourceView> m_pHingeSRV;
+	ComPtr<ID3D11Buffer> m_pHingeForceBuffer;
+	ComPtr<ID3D11UnorderedAccessView> m_pHingeForceUAV;
+	std::uint32_t m_NumHinges = 0;
+	ComPtr<ID3D11ComputeShader> m_pStrainDetectShader;
+	ComPtr<ID3D11ComputeShader> m_pStrainArgsShader;
+	ComPtr<ID3D11ComputeShader> m_pStrainLimitShader;
+	ComPtr<ID3D11ComputeShader> m_pStrainApplyShader;
+	ComPtr<ID3D11Buffer> m_pStretchedEdgeBuffer;
+	ComPtr<ID3D11ShaderResourceView> m_pStretchedEdgeSRV;
+	ComPtr<ID3D11UnorderedAccessView> m_pStretchedEdgeUAV;
+	ComPtr<ID3D11Buffer> m_pStretchedEdgeCount;
+	ComPtr<ID3D11Buffer> m_pStrainDispatchArgs;
+	ComPtr<ID3D11UnorderedAccessView> m_pStrainDispatchArgsUAV;
+	ComPtr<ID3D11Buffer> m_pStrainCorrectionBuffer;
+	ComPtr<ID3D11UnorderedAccessView> m_pStrainCorrectionUAV;
 	std::uint32_t m_iFrom = 0;
 
+	// steps published since initialization, including those of the snapshot
+	std::uint64_t m_StepCount = 0;
+
+	// steps are recorded here, concurrently with the other cloths, and
+	// submitted on the immediate context by PublishImpl()
+	ComPtr<ID3D11DeviceContext> m_pUpdateCTX;
+	ComPtr<ID3D11CommandList> m_pUpdateCommands;
+
+	// buffers read by RenderImpl(), owned by rendering until the next publish
+	std::uint32_t m_iRender = 0;
+
+	// positions published before m_iRender, blended by m_RenderAlpha.
+	// only allocated if the cloth is updated at a reduced rate.
+	ComPtr<ID3D11Buffer> m_pPreviousPositionBuffer;
+	ComPtr<ID3D11ShaderResourceView> m_pPreviousPositionSRV;
+	ComPtr<ID3D11UnorderedAccessView> m_pPreviousPositionUAV;
+	float m_RenderAlpha = 1.0f;
+
+	// smoothed CPU time of UpdateImpl() in milliseconds
+	float m_UpdateCost = 0.0f;
+
+	// bounds reduced on the GPU every step, read back a few frames later
+	ComPtr<ID3D11ComputeShader> m_pBoundsShader;
+	ComPtr<ID3D11Buffer> m_pBoundsBuffer;
+	ComPtr<ID3D11UnorderedAccessView> m_pBoundsUAV;
+	ReadbackRing m_BoundsReadbacks;
+	ObjectBounds m_Bounds;
+	bool m_HasBounds = false;
+
+	// render grid reconstructed by Upsample(), if Desc::RenderResolution is
+	// set. stale once another state or blend of states is to be rendered.
+	ComPtr<ID3D11ComputeShader> m_pUpsampleShader;
+	ComPtr<ID3D11Buffer> m_pUpsampleConstants;
+	std::shared_ptr<DetailBuffers> m_pDetail;
+	mutable bool m_DetailStale = true;
+
+	// positions on their way to the cache writer, while recording
+	std::unique_ptr<TestCloth::CacheWriter> m_pCacheWriter;
+	ReadbackRing m_CacheReadbacks;
+
+	// positions, normals and links on their way to the exporter, while exporting
+	std::unique_ptr<TestCloth::MeshExporter> m_pMeshExporter;
+	ReadbackRing m_ExportReadbacks;
+
+	// positions streamed from a cache file instead of simulated, see
+	// StartPlayback(). m_pCacheReader and the playback state are used by the
+	// update thread, requests wait in the pending members until publish.
+	std::unique_ptr<TestCloth::CacheReader> m_pCacheReader;
+	std::unique_ptr<TestCloth::CacheReader> m_pPendingCacheReader;
+	bool m_StopPlayback = false;
+	double m_PendingSeek = 0.0;
+	double m_PlaybackStep = 0.0;
+	bool m_HasPlaybackPositions = false;
+	std::vector<DirectX::XMFLOAT4> m_PlaybackPositions;
+	std::vector<DirectX::XMFLOAT4> m_PlaybackPreviousPositions;
+	std::vector<DirectX::XMFLOAT4> m_PlaybackVelocities;
+	ComPtr<ID3D11ComputeShader> m_pNormalShader;
+
+	// state transfer from other levels of detail
+	ComPtr<ID3D11ComputeShader> m_pResampleShader;
+	ComPtr<ID3D11Buffer> m_pResampleConstants;
+
 	TestCloth::Desc m_desc;
+
+	// particles per row and per column of the grid
+	std::uint32_t m_Resolution = 0;
+
 	SimulationBuffers m_SimBuffers[2];
+	GpuTimer m_UpdateTimer;
+};
+
+// switches between levels of detail by the projected size of the bounds.
+// every level is simulated by its own object, only the active one is updated.
+class TestClothLodObject : public BatchedObject<TestClothLodObject>, public ClothControl
+{
+	friend class BatchedObject<TestClothLodObject>;
+
+public:
+	~TestClothLodObject()
+	{
+		s_NumLevelParticles -= m_NumParticles;
+	}
+
+	void Initialize(const TestCloth::Desc& desc)
+	{
+		const auto& levels = desc.Levels;
+		if (levels[0].Resolution != desc.Resolution)
+		{
+			throw std::runtime_error("Cloth levels of detail must start at the cloth resolution");
+		}
+		for (std::size_t iLevel = 1; iLevel < levels.size(); iLevel++)
+		{
+			if (levels[iLevel].Resolution >= levels[iLevel - 1].Resolution)
+			{
+				throw std::runtime_error("Cloth levels of detail must be finest first");
+			}
+		}
+
+		m_desc = desc;
+
+		// only the active level is rendered, so the levels share its render grid
+		for (const auto& level : levels)
+		{
+			auto pLevel = MakeObject<TestClothObject>();
+			pLevel->Initialize(MakeLevelDesc(desc, level.Resolution),
+				m_Levels.empty() ? nullptr : m_Levels[0]->GetDetailBuffers());
+			m_Levels.push_back(std::move(pLevel));
+		}
+
+		SetLevel(0);
+	}
+
+	// the parameters of the finest level, which the snapshot restores levels from
+	void SaveSnapshot(const std::wstring& fileName) const override
+	{
+		m_Levels[m_iLevel]->SaveSnapshot(fileName, m_desc);
+	}
+
+	// the cache holds a single resolution, so levels do not switch meanwhile
+	void StartRecording(const std::wstring& fileName) override
+	{
+		m_Levels[m_iLevel]->StartRecording(fileName);
+		m_Recording = true;
+	}
+
+	void StopRecording() override
+	{
+		m_Recording = false;
+		m_Levels[m_iLevel]->StopRecording();
+	}
+
+	// the meshes of a sequence share their topology, so levels do not switch meanwhile
+	void StartExport(const std::wstring& fileNamePrefix, TestCloth::ExportFormat format) override
+	{
+		m_Levels[m_iLevel]->StartExport(fileNamePrefix, format);
+		m_Exporting = true;
+	}
+
+	void StopExport() override
+	{
+		m_Exporting = false;
+		m_Levels[m_iLevel]->StopExport();
+	}
+
+	// played back by the level of the cache resolution, which becomes
+	// active at the next publish and stays so until playback stops
+	void StartPlayback(const std::wstring& fileName) override
+	{
+		std::unique_ptr<TestCloth::CacheReader> pCacheReader(new TestCloth::CacheReader(fileName));
+		for (std::size_t iLevel = 0; iLevel < m_Levels.size(); iLevel++)
+		{
+			if (m_Levels[iLevel]->GetResolution() == pCacheReader->GetResolution())
+			{
+				if (m_Playback)
+				{
+					m_Levels[m_iPlaybackLevel]->StopPlayback();
+				}
+				m_Levels[iLevel]->StartPlayback(std::move(pCacheReader));
+				m_iPlaybackLevel = iLevel;
+				m_Playback = true;
+				return;
+			}
+		}
+
+		throw std::runtime_error("Cache resolution does not match any level of detail");
+	}
+
+	void StopPlayback() override
+	{
+		if (m_Playback)
+		{
+			m_Levels[m_iPlaybackLevel]->StopPlayback();
+			m_Playback = false;
+		}
+	}
+
+	void SeekPlayback(double numSteps) override
+	{
+		if (m_Playback)
+		{
+			m_Levels[m_iPlaybackLevel]->SeekPlayback(numSteps);
+		}
+	}
+
+	// restore into the level simulated at the resolution of the snapshot
+	void RestoreSnapshot(const TestCloth::SnapshotHeader& header, const std::uint8_t* pData)
+	{
+		for (std::size_t iLevel = 0; iLevel < m_Levels.size(); iLevel++)
+		{
+			if (m_Levels[iLevel]->GetResolution() == header.Resolution)
+			{
+				m_Levels[iLevel]->RestoreSnapshot(header, pData);
+				SetLevel(iLevel);
+				return;
+			}
+		}
+
+		throw std::runtime_error("Snapshot resolution does not match any level of detail");
+	}
+
+private:
+	void UpdateImpl() override
+	{
+		m_Levels[m_iLevel]->Update();
+	}
+
+	void PublishImpl() override
+	{
+		m_Levels[m_iLevel]->Publish();
+
+		// switch between publishes only, when no step is being recorded
+		auto iLevel = m_Playback ? m_iPlaybackLevel :
+			m_Recording || m_Exporting ? m_iLevel : SelectLevel();
+		if (iLevel != m_iLevel)
+		{
+			m_Levels[iLevel]->ResampleFrom(*m_Levels[m_iLevel]);
+			SetLevel(iLevel);
+		}
+
+		SetStatistic(L"TestCloth LOD particles", static_cast<double>(s_NumLevelParticles));
+	}
+
+	void InterpolateImpl(float alpha) override
+	{
+		m_Levels[m_iLevel]->Interpolate(alpha);
+	}
+
+	bool GetBoundsImpl(ObjectBounds& bounds) const override
+	{
+		return m_Levels[m_iLevel]->GetBounds(bounds);
+	}
+
+	UpdateSchedule GetScheduleImpl() const override
+	{
+		return m_Levels[m_iLevel]->GetSchedule();
+	}
+
+	void DeclareAccessImpl(ObjectAccess& access) const override
+	{
+		m_Levels[m_iLevel]->DeclareAccess(access);
+	}
+
+	void RenderImpl() const override
+	{
+		m_Levels[m_iLevel]->Render();
+	}
+
+	// level for the current projected size, with a margin of hysteresis
+	// around the thresholds so that the cloth does not pop back and forth
+	std::size_t SelectLevel() const
+	{
+		ObjectBounds bounds;
+		if (!m_Levels[m_iLevel]->GetBounds(bounds))
+		{
+			return m_iLevel;
+		}
+
+		using namespace DirectX;
+
+		// height of the bounding sphere relative to the screen height
+		auto minimum = XMLoadFloat3(&bounds.Min);
+		auto maximum = XMLoadFloat3(&bounds.Max);
+		auto radius = 0.5f * XMVectorGetX(XMVector3Length(maximum - minimum));
+		auto distance = XMVectorGetX(XMVector3Length(
+			0.5f * (minimum + maximum) - GetGlobalCamera()->GetEyePt()));
+		XMFLOAT4X4 projection;
+		XMStoreFloat4x4(&projection, GetGlobalCamera()->GetProjMatrix());
+		auto screenSize = radius * projection._22 / std::max(distance, radius);
+
+		const auto& levels = m_desc.Levels;
+		auto iLevel = m_iLevel;
+		while (iLevel + 1 < levels.size() &&
+			screenSize < levels[iLevel].MinScreenSize * (1.0f - m_desc.LodHysteresis))
+		{
+			iLevel++;
+		}
+		while (iLevel > 0 &&
+			screenSize > levels[iLevel - 1].MinScreenSize * (1.0f + m_desc.LodHysteresis))
+		{
+			iLevel--;
+		}
+
+		return iLevel;
+	}
+
+	void SetLevel(std::size_t iLevel)
+	{
+		std::int64_t resolution = m_desc.Levels[iLevel].Resolution;
+		s_NumLevelParticles += resolution * resolution - m_NumParticles;
+		m_NumParticles = resolution * resolution;
+		m_iLevel = iLevel;
+	}
+
+private:
+	// particles of the active levels of all cloths with levels of detail
+	static std::atomic<std::int64_t> s_NumLevelParticles;
+
+	TestCloth::Desc m_desc;
+
+	// one object per level of detail, finest first
+	std::vector<std::shared_ptr<TestClothObject>> m_Levels;
+	std::size_t m_iLevel = 0;
+	std::int64_t m_NumParticles = 0;
+	bool m_Recording = false;
+	bool m_Exporting = false;
+
+	// level playing back a cache, pinned while m_Playback is set
+	std::size_t m_iPlaybackLevel = 0;
+	bool m_Playback = false;
 };
 
+std::atomic<std::int64_t> TestClothLodObject::s_NumLevelParticles(0);
+
 namespace TestCloth
 {
+	Attachment MakeRowAttachment(std::uint32_t row, std::uint32_t resolution)
+	{
+		Attachment attachment;
+		for (std::uint32_t x = 0; x < resolution; x++)
+		{
+			attachment.Particles.push_back(x + row * resolution);
+		}
+
+		return attachment;
+	}
+
+	Collider MakeSphereCollider(const DirectX::XMFLOAT3& center, float radius)
+	{
+		Collider collider;
+		collider.Shape = ColliderShape::Sphere;
+		collider.Center = center;
+		collider.Radius = radius;
+		collider.Normal = DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
+		return collider;
+	}
+
+	Collider MakePlaneCollider(const DirectX::XMFLOAT3& point, const DirectX::XMFLOAT3& normal)
+	{
+		Collider collider;
+		collider.Shape = ColliderShape::Plane;
+		collider.Center = point;
+		collider.Radius = 0.0f;
+		collider.Normal = normal;
+		return collider;
+	}
+
 	ObjectHandle CreateObject(const Desc& desc)
 	{
-		auto ret = new TestClothObject();
+		if (!desc.Levels.empty())
+		{
+			auto ret = MakeObject<TestClothLodObject>();
+			ret->Initialize(desc);
+
+			return ret;
+		}
+
+		auto ret = MakeObject<TestClothObject>();
 		ret->Initialize(desc);
 
-		return ObjectHandle(ret);
+		return ret;
+	}
+
+	ObjectHandle CreateObject(const Desc& desc, const std::wstring& snapshotFileName)
+	{
+		MappedFile file(snapshotFileName);
+		const auto& header = ValidateSnapshot(file.GetData(), file.GetSize());
+
+		auto snapshotDesc = desc;
+		ApplySnapshotDesc(header, file.GetData(), snapshotDesc);
+
+		if (!snapshotDesc.Levels.empty())
+		{
+			auto ret = MakeObject<TestClothLodObject>();
+			ret->Initialize(snapshotDesc);
+			ret->RestoreSnapshot(header, file.GetData());
+
+			return ret;
+		}
+
+		auto ret = MakeObject<TestClothObject>();
+		ret->Initialize(snapshotDesc);
+		ret->RestoreSnapshot(header, file.GetData());
+
+		return ret;
+	}
+
+	void SaveSnapshot(const ObjectHandle& object, const std::wstring& fileName)
+	{
+		GetClothControl(object).SaveSnapshot(fileName);
+	}
+
+	void StartRecording(const ObjectHandle& object, const std::wstring& fileName)
+	{
+		GetClothControl(object).StartRecording(fileName);
+	}
+
+	void StopRecording(const ObjectHandle& object)
+	{
+		GetClothControl(object).StopRecording();
+	}
+
+	void StartPlayback(const ObjectHandle& object, const std::wstring& fileName)
+	{
+		GetClothControl(object).StartPlayback(fileName);
+	}
+
+	void StopPlayback(const ObjectHandle& object)
+	{
+		GetClothControl(object).StopPlayback();
+	}
+
+	void SeekPlayback(const ObjectHandle& object, double numSteps)
+	{
+		GetClothControl(object).SeekPlayback(numSteps);
+	}
+
+	void StartExport(const ObjectHandle& object, const std::wstring& fileNamePrefix, ExportFormat format)
+	{
+		GetClothControl(object).StartExport(fileNamePrefix, format);
+	}
+
+	void StopExport(const ObjectHandle& object)
+	{
+		GetClothControl(object).StopExport();
 	}
 }
@@ -1,6 +1,12 @@
 #pragma once
 
 #include "ObjectList.h"
+#include "TestClothExport.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
 
 namespace TestCloth
 {
@@ -10,13 +16,199 @@ namespace TestCloth
 		float Damping;
 	};
 
+	// force model for in-plane stretch and shear
+	enum class MembraneModel
+	{
+		// Neighbour and Diagonal springs of the grid stencil
+		Springs,
+
+		// orthotropic StVK triangles, see Membrane
+		Triangles,
+	};
+
+	// triangle membrane stiffness along warp (horizontal) and weft (vertical)
+	// threads, and against shear. stress is scaled by the triangle rest area.
+	struct Membrane
+	{
+		float WarpStiffness;
+		float WeftStiffness;
+		float ShearStiffness;
+		float Damping;
+	};
+
+	// force model for out-of-plane bending
+	enum class BendingModel
+	{
+		// Bending springs across two grid cells
+		Springs,
+
+		// dihedral angle of adjacent triangles, see Desc::Hinge
+		Hinges,
+	};
+
+	// particles pinned to a (possibly moving) transform
+	struct Attachment
+	{
+		// particle indices (x + y * horizontal resolution)
+		std::vector<std::uint32_t> Particles;
+
+		// world transform of the attachment, queried every step.
+		// pinned particles keep their initial position relative to it.
+		// if empty, particles are pinned to their initial world positions.
+		std::function<DirectX::XMMATRIX()> Transform;
+
+		// state read by Transform, if it is written by another object's update
+		const void* TransformSource = nullptr;
+	};
+
+	enum class ColliderShape
+	{
+		Sphere,
+		Plane,
+	};
+
+	// static obstacle, particles are pushed out of it every step
+	struct Collider
+	{
+		ColliderShape Shape;
+
+		// sphere center, or a point on the plane
+		DirectX::XMFLOAT3 Center;
+
+		// sphere only
+		float Radius;
+
+		// plane only, pointing away from the solid side
+		DirectX::XMFLOAT3 Normal;
+	};
+
+	// simulation grid used while the cloth covers at least MinScreenSize
+	struct LevelOfDetail
+	{
+		// particles per row and per column
+		std::uint32_t Resolution;
+
+		// projected height of the bounds, as a fraction of the screen height
+		float MinScreenSize;
+	};
+
+	// largest Desc::RenderResolution, whose float4 vertices have to fit a buffer
+	const std::uint32_t MAX_RENDER_RESOLUTION = 2048;
+
+	// largest Desc::StrainLimitIterations, each is a pass over the grid per step
+	const std::uint32_t MAX_STRAIN_LIMIT_ITERATIONS = 64;
+
 	struct Desc
 	{
+		// particles per row and per column of the grid
+		std::uint32_t Resolution = 128;
+
+		// initial positions of the top left, top right, bottom left and bottom
+		// right particles, the grid is interpolated between them (empty drapes
+		// the default 2 by 2 square). rest lengths are those of the 2 by 2
+		// square, so corners further apart start the cloth stretched.
+		std::vector<DirectX::XMFLOAT3> Corners;
+
 		Spring Neighbour = Spring{ 100000.0f, 30.0f };
 		Spring Diagonal = Spring{ 100000.0f, 30.0f };
 		Spring Bending = Spring{ 400000.0f, 20.0f };
+		MembraneModel Model = MembraneModel::Springs;
+		Membrane Triangles = Membrane{ 200000.0f, 200000.0f, 50000.0f, 60.0f };
+		BendingModel BendingType = BendingModel::Springs;
+		Spring Hinge = Spring{ 2.0f, 0.02f };
 		float TimeStep = 0.001f;
+
+		// steps per second (0 steps every frame). rendering interpolates
+		// between the last two steps, and Priority orders cloths over budget.
+		// every step advances TimeStep however long ago the last one was, so
+		// simulated time passes at UpdateRate * TimeStep per second: a cloth
+		// at a reduced rate moves slower than one stepping every frame, and
+		// slower still while the budget defers its steps.
+		float UpdateRate = 0.0f;
+		float UpdatePriority = 1.0f;
+
+		// relative stretch beyond which springs are torn (0 disables tearing).
+		// triangles and hinges with a torn edge no longer exert forces.
+		float TearStrain = 0.0f;
+
+		// maximum relative stretch of neighbour and diagonal springs,
+		// enforced after every step (0 disables strain limiting).
+		// allows much softer springs and therefore larger time steps.
+		float StrainLimit = 0.0f;
+		std::uint32_t StrainLimitIterations = 4;
+
+		std::vector<Attachment> Attachments;
+
+		std::vector<Collider> Colliders;
+
+		// distance kept between particles and colliders
+		float CollisionThickness = 0.01f;
+
+		// particles per row and per column of the rendered mesh, reconstructed
+		// from the simulated grid by subdivision and wrinkles where it is
+		// compressed (0 renders the simulated grid itself)
+		std::uint32_t RenderResolution = 0;
+
+		// wrinkle height relative to the one restoring the rest length
+		// of compressed cells (0 disables wrinkles)
+		float WrinkleAmplitude = 1.0f;
+
+		// levels switched by the projected size of the cloth, finest first
+		// (empty simulates Resolution only). the first level is at Resolution,
+		// the others strictly coarser. attachments describe the finest level
+		// and are resampled for coarser ones, whose heavier particles get
+		// stiffness and damping scaled to keep the material the same.
+		std::vector<LevelOfDetail> Levels;
+
+		// relative margin around MinScreenSize before switching back
+		float LodHysteresis = 0.2f;
 	};
 
+	// make attachment pinning a whole row of particles (0 is the top row)
+	Attachment MakeRowAttachment(std::uint32_t row, std::uint32_t resolution = 128);
+
+	Collider MakeSphereCollider(const DirectX::XMFLOAT3& center, float radius);
+	Collider MakePlaneCollider(const DirectX::XMFLOAT3& point, const DirectX::XMFLOAT3& normal);
+
 	ObjectHandle CreateObject(const Desc& desc);
+
+	// create cloth restarting from a snapshot written by SaveSnapshot().
+	// simulation parameters are taken from the snapshot, attachments and
+	// levels of detail from desc, whose resolution must match the snapshot.
+	ObjectHandle CreateObject(const Desc& desc, const std::wstring& snapshotFileName);
+
+	// write the last published state of a cloth made by CreateObject(),
+	// see TestClothSnapshot.h for the format
+	void SaveSnapshot(const ObjectHandle& object, const std::wstring& fileName);
+
+	// record every published step of a cloth to a compressed cache file
+	// (see TestClothCache.h), replacing the recording in progress if any.
+	// cloths with levels of detail stay at their current level meanwhile.
+	void StartRecording(const ObjectHandle& object, const std::wstring& fileName);
+
+	// finish writing the cache file
+	void StopRecording(const ObjectHandle& object);
+
+	// replace simulation by the frames of a cache file written by
+	// StartRecording(), streamed and decoded ahead on a reader thread.
+	// steps between the cached frames are interpolated, and the last frame
+	// is held once reached. cloths with levels of detail switch to the level
+	// of the cache resolution. throws if the file cannot be opened.
+	void StartPlayback(const ObjectHandle& object, const std::wstring& fileName);
+
+	// continue simulating from the state played back last
+	void StopPlayback(const ObjectHandle& object);
+
+	// move playback by numSteps (negative rewinds), clamped to the cache
+	void SeekPlayback(const ObjectHandle& object, double numSteps);
+
+	// write the mesh of every published step as a file of its own, see
+	// MeshExporter. files are written on a writer thread, and steps are
+	// dropped rather than stalling the simulation if it falls behind.
+	// cloths with levels of detail stay at their current level meanwhile.
+	void StartExport(const ObjectHandle& object, const std::wstring& fileNamePrefix,
+		ExportFormat format = ExportFormat::Ply);
+
+	// finish writing the files of the steps exported so far
+	void StopExport(const ObjectHandle& object);
 }
@@ -0,0 +1,57 @@
+StructuredBuffer<float4> SourcePositions : register(t0);
+StructuredBuffer<float4> SourceVelocities : register(t1);
+StructuredBuffer<float4> SourceNormals : register(t2);
+StructuredBuffer<uint> SourceLinks : register(t3);
+StructuredBuffer<float4> SourcePreviousPositions : register(t4);
+RWStructuredBuffer<float4> TargetPositions : register(u0);
+RWStructuredBuffer<float4> TargetVelocities : register(u1);
+RWStructuredBuffer<float4> TargetNormals : register(u2);
+RWStructuredBuffer<uint> TargetLinks : register(u3);
+RWStructuredBuffer<float4> TargetPreviousPositions : register(u4);
+
+cbuffer cbTestClothResample
+{
+	uint2 SourceResolution;
+	uint2 TargetResolution;
+};
+
+float4 SampleBilinear(StructuredBuffer<float4> source, uint2 id0, uint2 id1, float2 factors)
+{
+	float4 top = lerp(source[id0.x + id0.y * SourceResolution.x],
+		source[id1.x + id0.y * SourceResolution.x], factors.x);
+	float4 bottom = lerp(source[id0.x + id1.y * SourceResolution.x],
+		source[id1.x + id1.y * SourceResolution.x], factors.x);
+	return lerp(top, bottom, factors.y);
+}
+
+// transfers the state of a cloth to a grid of another resolution.
+// both grids span the same uv square, so that restriction (to a coarser grid)
+// and prolongation (to a finer one) are the same bilinear interpolation.
+// links cannot be blended and are taken from the nearest source particle.
+[numthreads(128, 2, 1)]
+void main(uint3 threadID : SV_DispatchThreadID)
+{
+	if (any(threadID.xy >= TargetResolution))
+	{
+		return;
+	}
+
+	float2 uv = threadID.xy / float2(TargetResolution - 1);
+	float2 source = uv * (SourceResolution - 1);
+	uint2 id0 = min(uint2(source), SourceResolution - 2);
+	uint2 id1 = id0 + 1;
+	float2 factors = source - id0;
+	uint2 nearest = uint2(source + 0.5f);
+
+	uint id = threadID.x + threadID.y * TargetResolution.x;
+	TargetPositions[id] = SampleBilinear(SourcePositions, id0, id1, factors);
+	TargetVelocities[id] = SampleBilinear(SourceVelocities, id0, id1, factors);
+	TargetLinks[id] = SourceLinks[nearest.x + nearest.y * SourceResolution.x];
+
+	float4 normal = SampleBilinear(SourceNormals, id0, id1, factors);
+	TargetNormals[id] = dot(normal.xyz, normal.xyz) > 0.0f ?
+		float4(normalize(normal.xyz), normal.w) : normal;
+
+	// unbound unless the cloth is interpolated (see Desc::UpdateRate)
+	TargetPreviousPositions[id] = SampleBilinear(SourcePreviousPositions, id0, id1, factors);
+}
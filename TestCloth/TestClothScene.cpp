@@ -0,0 +1,421 @@
+#include "stdafx.h"
+#include "TestClothScene.h"
+#include "JsonReader.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <stdexcept>
+
+namespace
+{
+	using namespace TestCloth;
+
+	DirectX::XMFLOAT3 ReadVector(JsonReader& reader)
+	{
+		float values[3];
+		std::size_t numValues = 0;
+
+		reader.BeginArray();
+		while (reader.NextElement())
+		{
+			if (numValues == 3)
+			{
+				reader.Fail("Expected 3 coordinates");
+			}
+			values[numValues++] = reader.ReadFloat();
+		}
+
+		if (numValues != 3)
+		{
+			reader.Fail("Expected 3 coordinates");
+		}
+		return DirectX::XMFLOAT3(values[0], values[1], values[2]);
+	}
+
+	Spring ReadSpring(JsonReader& reader, Spring spring)
+	{
+		JsonString name;
+		reader.BeginObject();
+		while (reader.NextMember(name))
+		{
+			if (name == "stiffness")
+			{
+				spring.Stiffness = reader.ReadFloat();
+			}
+			else if (name == "damping")
+			{
+				spring.Damping = reader.ReadFloat();
+			}
+			else
+			{
+				reader.Fail("Unknown spring member");
+			}
+		}
+
+		return spring;
+	}
+
+	Membrane ReadMembrane(JsonReader& reader, Membrane membrane)
+	{
+		JsonString name;
+		reader.BeginObject();
+		while (reader.NextMember(name))
+		{
+			if (name == "warpStiffness")
+			{
+				membrane.WarpStiffness = reader.ReadFloat();
+			}
+			else if (name == "weftStiffness")
+			{
+				membrane.WeftStiffness = reader.ReadFloat();
+			}
+			else if (name == "shearStiffness")
+			{
+				membrane.ShearStiffness = reader.ReadFloat();
+			}
+			else if (name == "damping")
+			{
+				membrane.Damping = reader.ReadFloat();
+			}
+			else
+			{
+				reader.Fail("Unknown triangles member");
+			}
+		}
+
+		return membrane;
+	}
+
+	Collider ReadCollider(JsonReader& reader)
+	{
+		auto collider = MakeSphereCollider(DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f);
+
+		JsonString name;
+		reader.BeginObject();
+		while (reader.NextMember(name))
+		{
+			if (name == "shape")
+			{
+				auto shape = reader.ReadString();
+				if (shape == "sphere")
+				{
+					collider.Shape = ColliderShape::Sphere;
+				}
+				else if (shape == "plane")
+				{
+					collider.Shape = ColliderShape::Plane;
+				}
+				else
+				{
+					reader.Fail("Unknown collider shape");
+				}
+			}
+			else if (name == "center")
+			{
+				collider.Center = ReadVector(reader);
+			}
+			else if (name == "radius")
+			{
+				collider.Radius = reader.ReadFloat();
+			}
+			else if (name == "normal")
+			{
+				collider.Normal = ReadVector(reader);
+			}
+			else
+			{
+				reader.Fail("Unknown collider member");
+			}
+		}
+
+		// a zero normal cannot be normalized
+		const auto& normal = collider.Normal;
+		if (collider.Shape == ColliderShape::Plane &&
+			normal.x == 0.0f && normal.y == 0.0f && normal.z == 0.0f)
+		{
+			reader.Fail("Plane collider normal must not be zero");
+		}
+
+		return collider;
+	}
+
+	void ReadColliders(JsonReader& reader, std::vector<Collider>& colliders)
+	{
+		reader.BeginArray();
+		while (reader.NextElement())
+		{
+			colliders.push_back(ReadCollider(reader));
+		}
+	}
+
+	LevelOfDetail ReadLevel(JsonReader& reader)
+	{
+		LevelOfDetail level = { 0, 0.0f };
+
+		JsonString name;
+		reader.BeginObject();
+		while (reader.NextMember(name))
+		{
+			if (name == "resolution")
+			{
+				level.Resolution = reader.ReadUint();
+			}
+			else if (name == "minScreenSize")
+			{
+				level.MinScreenSize = reader.ReadFloat();
+			}
+			else
+			{
+				reader.Fail("Unknown level member");
+			}
+		}
+
+		return level;
+	}
+
+	// cloth members overriding desc. rows to pin are collected in pinnedRows,
+	// since the resolution they are attached at may follow them.
+	void ReadCloth(JsonReader& reader, Desc& desc, std::vector<std::uint32_t>& pinnedRows)
+	{
+		JsonString name;
+		reader.BeginObject();
+		while (reader.NextMember(name))
+		{
+			if (name == "resolution")
+			{
+				desc.Resolution = reader.ReadUint();
+			}
+			else if (name == "corners")
+			{
+				desc.Corners.clear();
+				reader.BeginArray();
+				while (reader.NextElement())
+				{
+					desc.Corners.push_back(ReadVector(reader));
+				}
+				if (desc.Corners.size() != 4)
+				{
+					reader.Fail("Expected 4 corners");
+				}
+			}
+			else if (name == "neighbour")
+			{
+				desc.Neighbour = ReadSpring(reader, desc.Neighbour);
+			}
+			else if (name == "diagonal")
+			{
+				desc.Diagonal = ReadSpring(reader, desc.Diagonal);
+			}
+			else if (name == "bending")
+			{
+				desc.Bending = ReadSpring(reader, desc.Bending);
+			}
+			else if (name == "membrane")
+			{
+				auto model = reader.ReadString();
+				if (model == "springs")
+				{
+					desc.Model = MembraneModel::Springs;
+				}
+				else if (model == "triangles")
+				{
+					desc.Model = MembraneModel::Triangles;
+				}
+				else
+				{
+					reader.Fail("Unknown membrane model");
+				}
+			}
+			else if (name == "triangles")
+			{
+				desc.Triangles = ReadMembrane(reader, desc.Triangles);
+			}
+			else if (name == "bendingModel")
+			{
+				auto model = reader.ReadString();
+				if (model == "springs")
+				{
+					desc.BendingType = BendingModel::Springs;
+				}
+				else if (model == "hinges")
+				{
+					desc.BendingType = BendingModel::Hinges;
+				}
+				else
+				{
+					reader.Fail("Unknown bending model");
+				}
+			}
+			else if (name == "hinge")
+			{
+				desc.Hinge = ReadSpring(reader, desc.Hinge);
+			}
+			else if (name == "timeStep")
+			{
+				desc.TimeStep = reader.ReadFloat();
+			}
+			else if (name == "updateRate")
+			{
+				desc.UpdateRate = reader.ReadFloat();
+			}
+			else if (name == "updatePriority")
+			{
+				desc.UpdatePriority = reader.ReadFloat();
+			}
+			else if (name == "tearStrain")
+			{
+				desc.TearStrain = reader.ReadFloat();
+			}
+			else if (name == "strainLimit")
+			{
+				desc.StrainLimit = reader.ReadFloat();
+			}
+			else if (name == "strainLimitIterations")
+			{
+				desc.StrainLimitIterations = reader.ReadUint();
+			}
+			else if (name == "pinnedRows")
+			{
+				pinnedRows.clear();
+				reader.BeginArray();
+				while (reader.NextElement())
+				{
+					pinnedRows.push_back(reader.ReadUint());
+				}
+			}
+			else if (name == "colliders")
+			{
+				ReadColliders(reader, desc.Colliders);
+			}
+			else if (name == "collisionThickness")
+			{
+				desc.CollisionThickness = reader.ReadFloat();
+			}
+			else if (name == "renderResolution")
+			{
+				desc.RenderResolution = reader.ReadUint();
+			}
+			else if (name == "wrinkleAmplitude")
+			{
+				desc.WrinkleAmplitude = reader.ReadFloat();
+			}
+			else if (name == "levels")
+			{
+				desc.Levels.clear();
+				reader.BeginArray();
+				while (reader.NextElement())
+				{
+					desc.Levels.push_back(ReadLevel(reader));
+				}
+			}
+			else if (name == "lodHysteresis")
+			{
+				desc.LodHysteresis = reader.ReadFloat();
+			}
+			else
+			{
+				reader.Fail("Unknown cloth member");
+			}
+		}
+	}
+
+	// names of files are limited to ASCII, with \\, \/ and \" escaped
+	std::wstring ReadFileName(JsonReader& reader)
+	{
+		auto string = reader.ReadString();
+
+		std::wstring fileName;
+		for (std::size_t i = 0; i < string.Length; i++)
+		{
+			auto c = string.pBegin[i];
+			if (c == '\\')
+			{
+				c = string.pBegin[++i];
+				if (c != '\\' && c != '/' && c != '"')
+				{
+					reader.Fail("Unsupported escape sequence in file name");
+				}
+			}
+			if (c < 0x20 || c > 0x7e)
+			{
+				reader.Fail("File names are limited to ASCII");
+			}
+			fileName += static_cast<wchar_t>(c);
+		}
+
+		return fileName;
+	}
+
+	// attachments of the rows, pinned to their initial positions
+	void AttachRows(Desc& desc, const std::vector<std::uint32_t>& pinnedRows)
+	{
+		desc.Attachments.clear();
+		for (auto row : pinnedRows)
+		{
+			if (row >= desc.Resolution)
+			{
+				throw std::runtime_error("Pinned row is out of range");
+			}
+			desc.Attachments.push_back(MakeRowAttachment(row, desc.Resolution));
+		}
+	}
+}
+
+namespace TestCloth
+{
+	Scene ParseScene(const char* pText, std::size_t size)
+	{
+		Scene scene;
+		JsonReader reader(pText, pText + size);
+
+		Desc defaults;
+		std::vector<std::uint32_t> defaultRows;
+		std::vector<std::uint32_t> pinnedRows;
+
+		JsonString name;
+		reader.BeginObject();
+		while (reader.NextMember(name))
+		{
+			if (name == "defaults")
+			{
+				ReadCloth(reader, defaults, defaultRows);
+			}
+			else if (name == "colliders")
+			{
+				ReadColliders(reader, defaults.Colliders);
+			}
+			else if (name == "meshes")
+			{
+				reader.BeginArray();
+				while (reader.NextElement())
+				{
+					scene.Meshes.push_back(ReadFileName(reader));
+				}
+			}
+			else if (name == "cloths")
+			{
+				reader.BeginArray();
+				while (reader.NextElement())
+				{
+					scene.Cloths.push_back(defaults);
+					pinnedRows = defaultRows;
+					ReadCloth(reader, scene.Cloths.back(), pinnedRows);
+					AttachRows(scene.Cloths.back(), pinnedRows);
+				}
+			}
+			else
+			{
+				reader.Fail("Unknown scene member");
+			}
+		}
+		reader.End();
+
+		return scene;
+	}
+
+	Scene LoadScene(const std::wstring& fileName)
+	{
+		MappedFile file(fileName);
+		return ParseScene(reinterpret_cast<const char*>(file.GetData()), file.GetSize());
+	}
+}
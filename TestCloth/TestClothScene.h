@@ -0,0 +1,53 @@
+#pragma once
+
+#include "TestClothObject.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace TestCloth
+{
+	// cloths declared by a scene file, JSON with // comments:
+	//
+	//	{
+	//		// members of every cloth declared after it
+	//		"defaults": { "timeStep": 0.001, "pinnedRows": [0] },
+	//
+	//		// colliders of every cloth declared after it
+	//		"colliders": [ { "shape": "plane", "center": [0, -2, 0], "normal": [0, 1, 0] } ],
+	//
+	//		// SDKmesh files loaded in the background, e.g. collider assets
+	//		"meshes": [ "Colliders\\Chair.sdkmesh" ],
+	//
+	//		"cloths": [
+	//			{
+	//				"resolution": 64,
+	//				"corners": [[-1, 1, 0], [1, 1, 0], [-1, -1, 0], [1, -1, 0]],
+	//				"neighbour": { "stiffness": 100000, "damping": 30 },
+	//				"colliders": [ { "shape": "sphere", "center": [0, 0, 0.5], "radius": 0.3 } ]
+	//			}
+	//		]
+	//	}
+	//
+	// cloth members are named as the members of Desc, starting in lower case:
+	// resolution, corners, neighbour, diagonal, bending, membrane ("springs" or
+	// "triangles"), triangles, bendingModel ("springs" or "hinges"), hinge,
+	// timeStep, updateRate, updatePriority, tearStrain, strainLimit,
+	// strainLimitIterations, colliders, collisionThickness, renderResolution,
+	// wrinkleAmplitude, levels ({ resolution, minScreenSize }) and lodHysteresis.
+	// pinnedRows lists rows attached with MakeRowAttachment(). springs are
+	// { stiffness, damping }, triangles { warpStiffness, weftStiffness,
+	// shearStiffness, damping }. unknown members are errors.
+	struct Scene
+	{
+		std::vector<Desc> Cloths;
+		std::vector<std::wstring> Meshes;
+	};
+
+	// parse the text of a scene file, throws std::runtime_error naming the line
+	Scene ParseScene(const char* pText, std::size_t size);
+
+	// map and parse a scene file
+	Scene LoadScene(const std::wstring& fileName);
+}
@@ -0,0 +1,189 @@
+#include "stdafx.h"
+#include "TestClothSnapshot.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+	std::uint64_t GetNumParticles(std::uint32_t resolution)
+	{
+		return static_cast<std::uint64_t>(resolution) * resolution;
+	}
+
+	bool IsArrayInside(std::uint64_t offset, std::uint64_t elementSize,
+		std::uint64_t numElements, std::size_t fileSize)
+	{
+		return offset % elementSize == 0 && offset <= fileSize &&
+			numElements * elementSize <= fileSize - offset;
+	}
+}
+
+namespace TestCloth
+{
+	SnapshotDesc MakeSnapshotDesc(const Desc& desc)
+	{
+		SnapshotDesc snapshotDesc;
+		snapshotDesc.Neighbour = desc.Neighbour;
+		snapshotDesc.Diagonal = desc.Diagonal;
+		snapshotDesc.Bending = desc.Bending;
+		snapshotDesc.Triangles = desc.Triangles;
+		snapshotDesc.Hinge = desc.Hinge;
+		snapshotDesc.Model = static_cast<std::uint32_t>(desc.Model);
+		snapshotDesc.BendingType = static_cast<std::uint32_t>(desc.BendingType);
+		snapshotDesc.TimeStep = desc.TimeStep;
+		snapshotDesc.UpdateRate = desc.UpdateRate;
+		snapshotDesc.UpdatePriority = desc.UpdatePriority;
+		snapshotDesc.TearStrain = desc.TearStrain;
+		snapshotDesc.StrainLimit = desc.StrainLimit;
+		snapshotDesc.StrainLimitIterations = desc.StrainLimitIterations;
+		snapshotDesc.RenderResolution = desc.RenderResolution;
+		snapshotDesc.WrinkleAmplitude = desc.WrinkleAmplitude;
+		snapshotDesc.CollisionThickness = desc.CollisionThickness;
+		snapshotDesc.NumCorners = static_cast<std::uint32_t>(desc.Corners.size());
+		for (std::uint32_t i = 0; i < 4; i++)
+		{
+			snapshotDesc.Corners[i] = i < snapshotDesc.NumCorners ?
+				desc.Corners[i] : DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+		}
+		return snapshotDesc;
+	}
+
+	void ApplySnapshotDesc(const SnapshotHeader& header, const std::uint8_t* pData, Desc& desc)
+	{
+		const auto& snapshotDesc = header.Desc;
+		desc.Neighbour = snapshotDesc.Neighbour;
+		desc.Diagonal = snapshotDesc.Diagonal;
+		desc.Bending = snapshotDesc.Bending;
+		desc.Triangles = snapshotDesc.Triangles;
+		desc.Hinge = snapshotDesc.Hinge;
+		desc.Model = static_cast<MembraneModel>(snapshotDesc.Model);
+		desc.BendingType = static_cast<BendingModel>(snapshotDesc.BendingType);
+		desc.TimeStep = snapshotDesc.TimeStep;
+		desc.UpdateRate = snapshotDesc.UpdateRate;
+		desc.UpdatePriority = snapshotDesc.UpdatePriority;
+		desc.TearStrain = snapshotDesc.TearStrain;
+		desc.StrainLimit = snapshotDesc.StrainLimit;
+		desc.StrainLimitIterations = snapshotDesc.StrainLimitIterations;
+		desc.RenderResolution = snapshotDesc.RenderResolution;
+		desc.WrinkleAmplitude = snapshotDesc.WrinkleAmplitude;
+		desc.CollisionThickness = snapshotDesc.CollisionThickness;
+		desc.Corners.assign(snapshotDesc.Corners, snapshotDesc.Corners + snapshotDesc.NumCorners);
+
+		auto pColliders = reinterpret_cast<const SnapshotCollider*>(pData + header.ColliderOffset);
+		desc.Colliders.resize(static_cast<std::size_t>(header.NumColliders));
+		for (std::size_t i = 0; i < desc.Colliders.size(); i++)
+		{
+			auto& collider = desc.Colliders[i];
+			collider.Shape = static_cast<ColliderShape>(pColliders[i].Shape);
+			collider.Center = pColliders[i].Center;
+			collider.Radius = pColliders[i].Radius;
+			collider.Normal = pColliders[i].Normal;
+		}
+	}
+
+	SnapshotHeader MakeSnapshotHeader(const Desc& desc, std::uint32_t resolution,
+		std::uint64_t stepCount)
+	{
+		auto numParticles = GetNumParticles(resolution);
+
+		// padding is written to the file too
+		SnapshotHeader header;
+		ZeroMemory(&header, sizeof(header));
+		header.Magic = SNAPSHOT_MAGIC;
+		header.Version = SNAPSHOT_VERSION;
+		header.HeaderSize = sizeof(SnapshotHeader);
+		header.Resolution = resolution;
+		header.StepCount = stepCount;
+		header.PositionOffset = (sizeof(SnapshotHeader) + 15) / 16 * 16;
+		header.VelocityOffset = header.PositionOffset + numParticles * sizeof(DirectX::XMFLOAT4);
+		header.LinkOffset = header.VelocityOffset + numParticles * sizeof(DirectX::XMFLOAT4);
+		header.ColliderOffset = header.LinkOffset + numParticles * sizeof(std::uint32_t);
+		header.NumColliders = desc.Colliders.size();
+		header.Desc = MakeSnapshotDesc(desc);
+		return header;
+	}
+
+	void WriteSnapshotColliders(const Desc& desc, const SnapshotHeader& header, std::uint8_t* pData)
+	{
+		auto pColliders = reinterpret_cast<SnapshotCollider*>(pData + header.ColliderOffset);
+		for (std::size_t i = 0; i < desc.Colliders.size(); i++)
+		{
+			const auto& collider = desc.Colliders[i];
+			pColliders[i].Shape = static_cast<std::uint32_t>(collider.Shape);
+			pColliders[i].Center = collider.Center;
+			pColliders[i].Radius = collider.Radius;
+			pColliders[i].Normal = collider.Normal;
+		}
+	}
+
+	std::size_t GetSnapshotSize(const SnapshotHeader& header)
+	{
+		return static_cast<std::size_t>(header.ColliderOffset +
+			header.NumColliders * sizeof(SnapshotCollider));
+	}
+
+	const SnapshotHeader& ValidateSnapshot(const std::uint8_t* pData, std::size_t size)
+	{
+		if (size < sizeof(SnapshotHeader))
+		{
+			throw std::runtime_error("Snapshot is truncated");
+		}
+
+		auto& header = *reinterpret_cast<const SnapshotHeader*>(pData);
+		if (header.Magic != SNAPSHOT_MAGIC)
+		{
+			throw std::runtime_error("Not a cloth snapshot");
+		}
+		if (header.Version != SNAPSHOT_VERSION || header.HeaderSize != sizeof(SnapshotHeader))
+		{
+			throw std::runtime_error("Unsupported snapshot version");
+		}
+		if (header.Resolution < 3 || header.Resolution > 0xffff)
+		{
+			throw std::runtime_error("Invalid snapshot resolution");
+		}
+		if (header.Desc.Model > static_cast<std::uint32_t>(MembraneModel::Triangles) ||
+			header.Desc.BendingType > static_cast<std::uint32_t>(BendingModel::Hinges))
+		{
+			throw std::runtime_error("Invalid snapshot force model");
+		}
+		if (header.Desc.RenderResolution == 1 || header.Desc.RenderResolution > MAX_RENDER_RESOLUTION ||
+			header.Desc.StrainLimitIterations > MAX_STRAIN_LIMIT_ITERATIONS ||
+			!(header.Desc.TimeStep > 0.0f) || !std::isfinite(header.Desc.TimeStep) ||
+			!(header.Desc.CollisionThickness >= 0.0f) || !std::isfinite(header.Desc.CollisionThickness) ||
+			(header.Desc.NumCorners != 0 && header.Desc.NumCorners != 4))
+		{
+			throw std::runtime_error("Invalid snapshot parameters");
+		}
+
+		auto numParticles = GetNumParticles(header.Resolution);
+		if (!IsArrayInside(header.PositionOffset, sizeof(DirectX::XMFLOAT4), numParticles, size) ||
+			!IsArrayInside(header.VelocityOffset, sizeof(DirectX::XMFLOAT4), numParticles, size) ||
+			!IsArrayInside(header.LinkOffset, sizeof(std::uint32_t), numParticles, size))
+		{
+			throw std::runtime_error("Snapshot is truncated");
+		}
+
+		// colliders are only float aligned, and their count is not bounded by the resolution
+		if (header.ColliderOffset % sizeof(float) != 0 || header.ColliderOffset > size ||
+			header.NumColliders > (size - header.ColliderOffset) / sizeof(SnapshotCollider))
+		{
+			throw std::runtime_error("Snapshot is truncated");
+		}
+
+		auto pColliders = reinterpret_cast<const SnapshotCollider*>(pData + header.ColliderOffset);
+		for (std::uint64_t i = 0; i < header.NumColliders; i++)
+		{
+			const auto& collider = pColliders[i];
+			if (collider.Shape > static_cast<std::uint32_t>(ColliderShape::Plane) ||
+				(collider.Shape == static_cast<std::uint32_t>(ColliderShape::Plane) &&
+					collider.Normal.x == 0.0f && collider.Normal.y == 0.0f && collider.Normal.z == 0.0f))
+			{
+				throw std::runtime_error("Invalid snapshot collider");
+			}
+		}
+
+		return header;
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "TestClothObject.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace TestCloth
+{
+	// Desc::Colliders element
+	struct SnapshotCollider
+	{
+		std::uint32_t Shape;
+		DirectX::XMFLOAT3 Center;
+		float Radius;
+		DirectX::XMFLOAT3 Normal;
+	};
+
+	// simulation parameters of Desc, without attachments and levels of detail
+	// (colliders follow the arrays of the snapshot)
+	struct SnapshotDesc
+	{
+		Spring Neighbour;
+		Spring Diagonal;
+		Spring Bending;
+		Membrane Triangles;
+		Spring Hinge;
+		std::uint32_t Model;
+		std::uint32_t BendingType;
+		float TimeStep;
+		float UpdateRate;
+		float UpdatePriority;
+		float TearStrain;
+		float StrainLimit;
+		std::uint32_t StrainLimitIterations;
+		std::uint32_t RenderResolution;
+		float WrinkleAmplitude;
+		float CollisionThickness;
+
+		// 0 or 4, the first NumCorners of Corners are set
+		std::uint32_t NumCorners;
+		DirectX::XMFLOAT3 Corners[4];
+	};
+
+	// snapshot file layout: the header, followed by Resolution * Resolution
+	// positions (float4), velocities (float4) and link masks (uint32), then
+	// NumColliders colliders, at the given offsets from the start of the file.
+	// the layout matches the solver buffers, so that mapped files are
+	// uploaded as they are.
+	struct SnapshotHeader
+	{
+		std::uint32_t Magic;
+		std::uint32_t Version;
+		std::uint32_t HeaderSize;
+		std::uint32_t Resolution;
+		std::uint64_t StepCount;
+		std::uint64_t PositionOffset;
+		std::uint64_t VelocityOffset;
+		std::uint64_t LinkOffset;
+		std::uint64_t ColliderOffset;
+		std::uint64_t NumColliders;
+		SnapshotDesc Desc;
+	};
+
+	const std::uint32_t SNAPSHOT_MAGIC = 0x53534354; // "TCSS"
+	const std::uint32_t SNAPSHOT_VERSION = 2;
+
+	SnapshotDesc MakeSnapshotDesc(const Desc& desc);
+
+	// overwrite the simulation parameters and colliders of desc with those
+	// of a validated snapshot
+	void ApplySnapshotDesc(const SnapshotHeader& header, const std::uint8_t* pData, Desc& desc);
+
+	// header with the arrays laid out back to back after it
+	SnapshotHeader MakeSnapshotHeader(const Desc& desc, std::uint32_t resolution,
+		std::uint64_t stepCount);
+
+	// write the colliders of desc to snapshot file contents laid out by header
+	void WriteSnapshotColliders(const Desc& desc, const SnapshotHeader& header, std::uint8_t* pData);
+
+	// size of the snapshot file described by header
+	std::size_t GetSnapshotSize(const SnapshotHeader& header);
+
+	// header of snapshot file contents, after checking that the arrays fit
+	const SnapshotHeader& ValidateSnapshot(const std::uint8_t* pData, std::size_t size);
+}
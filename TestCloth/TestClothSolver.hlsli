@@ -0,0 +1,48 @@
+// parameters shared by the solver passes (CB_TEST_CLOTH_UPDATE)
+
+struct Spring
+{
+	float stiffness;
+	float damping;
+	float restLength;
+	float dummy;
+};
+
+// orthotropic triangle membrane (TestClothMembrane.hlsl)
+struct Membrane
+{
+	float warpStiffness;
+	float weftStiffness;
+	float shearStiffness;
+	float damping;
+};
+
+cbuffer cbTestCloth : register(b0)
+{
+	Spring Neighbour;
+	Spring Diagonal;
+	Spring Bending;
+	uint2 ClothResolution;
+	float TimeStep;
+	float TearStrain;
+	float StrainLimit;
+	Membrane TriangleMembrane;
+};
+
+uint ComposeID(in uint2 id)
+{
+	return id.x + id.y * ClothResolution.x;
+}
+
+// triangles are numbered per grid quad (top-left corner q):
+// 2 * quad is (q, q + x, q + x + y) and 2 * quad + 1 is (q, q + x + y, q + y),
+// split along the same diagonal as the geometry shader draws
+uint ComposeQuadID(in uint2 quad)
+{
+	return quad.x + quad.y * (ClothResolution.x - 1);
+}
+
+uint GetNumTriangles()
+{
+	return 2 * (ClothResolution.x - 1) * (ClothResolution.y - 1);
+}
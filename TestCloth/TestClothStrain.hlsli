@@ -0,0 +1,16 @@
+// edge stretched beyond the strain limit, appended by TestClothStrainDetect.hlsl
+struct StretchedEdge
+{
+	uint id0;
+	uint id1;
+	float maxLength;
+	float dummy;
+};
+
+// corrections are accumulated atomically in 8.24 fixed point
+#define CORRECTION_SCALE 16777216.0f
+
+cbuffer cbStretchedEdges : register(b1)
+{
+	uint NumStretchedEdges;
+};
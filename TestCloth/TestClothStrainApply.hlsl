@@ -0,0 +1,29 @@
+#include "TestClothSolver.hlsli"
+#include "TestClothStrain.hlsli"
+
+RWStructuredBuffer<float4> Positions : register(u0);
+RWStructuredBuffer<float4> Velocities : register(u1);
+RWByteAddressBuffer Corrections : register(u2);
+
+// apply and clear corrections accumulated by TestClothStrainLimit.hlsl.
+// velocities follow the positions so the removed stretch does not come back.
+[numthreads(128, 2, 1)]
+void main(uint3 threadID : SV_DispatchThreadID)
+{
+	// the grid is dispatched in whole groups, skip threads beyond it
+	if (any(threadID.xy >= ClothResolution))
+	{
+		return;
+	}
+
+	uint id = ComposeID(threadID.xy);
+	int3 correction = asint(Corrections.Load3(id * 12));
+
+	if (any(correction))
+	{
+		float3 dp = correction / CORRECTION_SCALE;
+		Positions[id] += float4(dp, 0.0f);
+		Velocities[id] += float4(dp / TimeStep, 0.0f);
+		Corrections.Store3(id * 12, uint3(0, 0, 0));
+	}
+}
@@ -0,0 +1,11 @@
+#include "TestClothStrain.hlsli"
+
+RWByteAddressBuffer DispatchArgs : register(u0);
+
+// turn the number of stretched edges into DispatchIndirect arguments
+// for TestClothStrainLimit.hlsl
+[numthreads(1, 1, 1)]
+void main()
+{
+	DispatchArgs.Store3(0, uint3((NumStretchedEdges + 63) / 64, 1, 1));
+}
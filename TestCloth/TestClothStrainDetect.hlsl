@@ -0,0 +1,62 @@
+#include "TestClothLinks.hlsli"
+#include "TestClothSolver.hlsli"
+#include "TestClothStrain.hlsli"
+
+StructuredBuffer<float4> Positions : register(t0);
+StructuredBuffer<uint> Links : register(t1);
+AppendStructuredBuffer<StretchedEdge> StretchedEdges : register(u0);
+
+void DetectEdge(in uint id0, in uint id1, in float restLength)
+{
+	float maxLength = restLength * (1.0f + StrainLimit);
+	float3 dp = Positions[id1].xyz - Positions[id0].xyz;
+
+	if (dot(dp, dp) > maxLength * maxLength)
+	{
+		StretchedEdge edge;
+		edge.id0 = id0;
+		edge.id1 = id1;
+		edge.maxLength = maxLength;
+		edge.dummy = 0.0f;
+		StretchedEdges.Append(edge);
+	}
+}
+
+// each particle owns the four edges towards +y and +x,
+// so every neighbour and diagonal edge is tested exactly once
+[numthreads(128, 2, 1)]
+void main(uint3 threadID : SV_DispatchThreadID)
+{
+	// the grid is dispatched in whole groups, skip threads beyond it
+	if (any(threadID.xy >= ClothResolution))
+	{
+		return;
+	}
+
+	uint id = ComposeID(threadID.xy);
+	uint links = Links[id];
+
+	const uint X_NOT_MIN = threadID.x > 0;
+	const uint X_NOT_MAX = threadID.x < ClothResolution.x - 1;
+	const uint Y_NOT_MAX = threadID.y < ClothResolution.y - 1;
+
+	if (X_NOT_MAX && (links & LINK_NEIGHBOUR_XMAX))
+	{
+		DetectEdge(id, id + 1, Neighbour.restLength);
+	}
+
+	if (Y_NOT_MAX && (links & LINK_NEIGHBOUR_YMAX))
+	{
+		DetectEdge(id, id + ClothResolution.x, Neighbour.restLength);
+	}
+
+	if (X_NOT_MAX && Y_NOT_MAX && (links & LINK_DIAGONAL_XMAX_YMAX))
+	{
+		DetectEdge(id, id + 1 + ClothResolution.x, Diagonal.restLength);
+	}
+
+	if (X_NOT_MIN && Y_NOT_MAX && (links & LINK_DIAGONAL_XMIN_YMAX))
+	{
+		DetectEdge(id, id - 1 + ClothResolution.x, Diagonal.restLength);
+	}
+}
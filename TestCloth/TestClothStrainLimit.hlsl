@@ -0,0 +1,31 @@
+#include "TestClothStrain.hlsli"
+
+StructuredBuffer<float4> Positions : register(t0);
+StructuredBuffer<StretchedEdge> StretchedEdges : register(t1);
+RWByteAddressBuffer Corrections : register(u0);
+
+void AddCorrection(in uint id, in int3 correction)
+{
+	Corrections.InterlockedAdd(id * 12 + 0, asuint(correction.x));
+	Corrections.InterlockedAdd(id * 12 + 4, asuint(correction.y));
+	Corrections.InterlockedAdd(id * 12 + 8, asuint(correction.z));
+}
+
+// pull both ends of a stretched edge back to the limit (Jacobi style).
+// runs only over the compacted list of stretched edges.
+[numthreads(64, 1, 1)]
+void main(uint3 threadID : SV_DispatchThreadID)
+{
+	if (threadID.x >= NumStretchedEdges)
+	{
+		return;
+	}
+
+	StretchedEdge edge = StretchedEdges[threadID.x];
+	float3 dp = Positions[edge.id1].xyz - Positions[edge.id0].xyz;
+	float len = length(dp);
+
+	int3 correction = int3(dp * (0.5f * (1.0f - edge.maxLength / len) * CORRECTION_SCALE));
+	AddCorrection(edge.id0, correction);
+	AddCorrection(edge.id1, -correction);
+}
@@ -1,30 +1,26 @@
+#include "TestClothLinks.hlsli"
+#include "TestClothSolver.hlsli"
+#include "TestClothNormal.hlsli"
+
 StructuredBuffer<float4> PositionsFrom : register(t0);
 StructuredBuffer<float4> VelocitiesFrom : register(t1);
+StructuredBuffer<uint> LinksFrom : register(t2);
 RWStructuredBuffer<float4> PositionsTo : register(u0);
 RWStructuredBuffer<float4> VelocitiesTo : register(u1);
 RWStructuredBuffer<float4> Normals : register(u2);
+RWStructuredBuffer<uint> LinksTo : register(u3);
 
-struct Spring
-{
-	float stiffness;
-	float damping;
-	float restLength;
-	float dummy;
-};
+#ifdef TRIANGLE_MEMBRANE
+// vertex forces written by TestClothMembrane.hlsl
+StructuredBuffer<float4> TriangleForces : register(t3);
+#endif
 
-cbuffer cbTestCloth
-{
-	Spring Neighbour;
-	Spring Diagonal;
-	Spring Bending;
-	uint2 ClothResolution;
-	float TimeStep;
-};
-
-uint ComposeID(in uint2 id)
-{
-	return id.x + id.y * ClothResolution.x;
-}
+#ifdef HINGE_BENDING
+#include "TestClothHinge.hlsli"
+
+// forces accumulated by TestClothHinge.hlsl, cleared once consumed
+RWByteAddressBuffer HingeForces : register(u4);
+#endif
 
 float4 CalcAccel(in uint id0, in uint id1, in Spring spring)
 {
@@ -38,9 +34,41 @@ float4 CalcAccel(in uint id0, in uint id1, in Spring spring)
 		spring.damping * dot(dp.xyz, dv.xyz) / lenSq) * dp;
 }
 
+// clear the link of a spring stretched beyond the tear strain.
+// tearing only updates the link mask written at the end of the step,
+// so the topology seen by this step stays consistent.
+void TearLink(in uint id0, in uint id1, in float restLength,
+	in uint link, inout uint links)
+{
+	float len = length(PositionsFrom[id0].xyz - PositionsFrom[id1].xyz);
+	if (TearStrain > 0.0f && len > restLength * (1.0f + TearStrain))
+	{
+		links &= ~link;
+	}
+}
+
+// acceleration by a spring which can be torn
+float4 CalcLinkAccel(in uint id0, in uint id1, in Spring spring,
+	in uint link, inout uint links)
+{
+	if ((links & link) == 0)
+	{
+		return float4(0.0f, 0.0f, 0.0f, 0.0f);
+	}
+
+	TearLink(id0, id1, spring.restLength, link, links);
+	return CalcAccel(id0, id1, spring);
+}
+
 [numthreads(128, 2, 1)]
 void main(uint3 threadID : SV_DispatchThreadID)
 {
+	// the grid is dispatched in whole groups, skip threads beyond it
+	if (any(threadID.xy >= ClothResolution))
+	{
+		return;
+	}
+
 	uint id = ComposeID(threadID.xy);
 
 	PositionsTo[id] = PositionsFrom[id];
@@ -55,105 +83,171 @@ void main(uint3 threadID : SV_DispatchThreadID)
 	const uint X_NOT_MAX2 = threadID.x < ClothResolution.x - 2;
 	const uint Y_NOT_MAX2 = threadID.y < ClothResolution.y - 2;
 
+	// pinned particles are overwritten afterwards by TestClothAttach.hlsl,
+	// so every particle is integrated without branching on attachments
 	float4 accel = float4(0.0f, 0.0f, 0.0f, 0.0f);
-		if (Y_NOT_MIN)
-		{
-		if (X_NOT_MIN)
-		{
-			accel += CalcAccel(id, id - 1, Neighbour);
-		}
-
-		if (X_NOT_MAX)
-		{
-			accel += CalcAccel(id, id + 1, Neighbour);
-		}
-
-		if (Y_NOT_MIN)
-		{
-			accel += CalcAccel(id, id - ClothResolution.x, Neighbour);
-		}
-
-		if (Y_NOT_MAX)
-		{
-			accel += CalcAccel(id, id + ClothResolution.x, Neighbour);
-		}
-
-		if (X_NOT_MIN && Y_NOT_MIN)
-		{
-			accel += CalcAccel(id, id - 1 - ClothResolution.x, Diagonal);
-		}
-
-		if (X_NOT_MAX && Y_NOT_MIN)
-		{
-			accel += CalcAccel(id, id + 1 - ClothResolution.x, Diagonal);
-		}
-
-		if (X_NOT_MIN && Y_NOT_MAX)
-		{
-			accel += CalcAccel(id, id - 1 + ClothResolution.x, Diagonal);
-		}
-
-		if (X_NOT_MAX && Y_NOT_MAX)
-		{
-			accel += CalcAccel(id, id + 1 + ClothResolution.x, Diagonal);
-		}
-
-		if (X_NOT_MIN2)
-		{
-			accel += CalcAccel(id, id - 2, Bending);
-		}
-
-		if (X_NOT_MAX2)
-		{
-			accel += CalcAccel(id, id + 2, Bending);
-		}
-
-		if (Y_NOT_MIN2)
-		{
-			accel += CalcAccel(id, id - ClothResolution.x * 2, Bending);
-		}
-
-		if (Y_NOT_MAX2)
-		{
-			accel += CalcAccel(id, id + ClothResolution.x * 2, Bending);
-		}
-
-		accel.y -= 9.8f;
+	uint links = LinksFrom[id];
+
+#ifdef TRIANGLE_MEMBRANE
+	// gather forces of the (up to) six incident triangles
+	// instead of evaluating neighbour and diagonal springs
+	const uint NUM_TRIANGLES = GetNumTriangles();
+
+	if (X_NOT_MAX && Y_NOT_MAX)
+	{
+		uint tri = 2 * ComposeQuadID(threadID.xy);
+		accel += TriangleForces[tri] + TriangleForces[tri + 1];
 	}
 
-	float4 newVelocity = VelocitiesFrom[id] + accel * TimeStep;
-	VelocitiesTo[id] = newVelocity;
-	PositionsTo[id] = PositionsFrom[id] + newVelocity * TimeStep;
+	if (X_NOT_MIN && Y_NOT_MAX)
+	{
+		uint tri = 2 * ComposeQuadID(threadID.xy - uint2(1, 0));
+		accel += TriangleForces[NUM_TRIANGLES + tri];
+	}
 
-	float4 normal = float4(0.0f, 0.0f, 0.0f, 0.0f);
+	if (X_NOT_MIN && Y_NOT_MIN)
+	{
+		uint tri = 2 * ComposeQuadID(threadID.xy - uint2(1, 1));
+		accel += TriangleForces[NUM_TRIANGLES * 2 + tri] +
+			TriangleForces[NUM_TRIANGLES + tri + 1];
+	}
+
+	if (X_NOT_MAX && Y_NOT_MIN)
+	{
+		uint tri = 2 * ComposeQuadID(threadID.xy - uint2(0, 1));
+		accel += TriangleForces[NUM_TRIANGLES * 2 + tri + 1];
+	}
+
+	// triangle edges tear as the springs along them would,
+	// TestClothMembrane.hlsl skips the triangles they split
+	if (X_NOT_MIN)
+	{
+		TearLink(id, id - 1, Neighbour.restLength, LINK_NEIGHBOUR_XMIN, links);
+	}
+
+	if (X_NOT_MAX)
+	{
+		TearLink(id, id + 1, Neighbour.restLength, LINK_NEIGHBOUR_XMAX, links);
+	}
+
+	if (Y_NOT_MIN)
+	{
+		TearLink(id, id - ClothResolution.x, Neighbour.restLength, LINK_NEIGHBOUR_YMIN, links);
+	}
+
+	if (Y_NOT_MAX)
+	{
+		TearLink(id, id + ClothResolution.x, Neighbour.restLength, LINK_NEIGHBOUR_YMAX, links);
+	}
 
 	if (X_NOT_MIN && Y_NOT_MIN)
 	{
-		normal.xyz += cross(
-			PositionsFrom[id - 1] - PositionsFrom[id],
-			PositionsFrom[id - ClothResolution.x] - PositionsFrom[id]);
+		TearLink(id, id - 1 - ClothResolution.x, Diagonal.restLength,
+			LINK_DIAGONAL_XMIN_YMIN, links);
 	}
 
 	if (X_NOT_MAX && Y_NOT_MIN)
 	{
-		normal.xyz += cross(
-			PositionsFrom[id - ClothResolution.x] - PositionsFrom[id],
-			PositionsFrom[id + 1] - PositionsFrom[id]);
+		TearLink(id, id + 1 - ClothResolution.x, Diagonal.restLength,
+			LINK_DIAGONAL_XMAX_YMIN, links);
+	}
+
+	if (X_NOT_MIN && Y_NOT_MAX)
+	{
+		TearLink(id, id - 1 + ClothResolution.x, Diagonal.restLength,
+			LINK_DIAGONAL_XMIN_YMAX, links);
 	}
 
 	if (X_NOT_MAX && Y_NOT_MAX)
 	{
-		normal.xyz += cross(
-			PositionsFrom[id + 1] - PositionsFrom[id],
-			PositionsFrom[id + ClothResolution.x] - PositionsFrom[id]);
+		TearLink(id, id + 1 + ClothResolution.x, Diagonal.restLength,
+			LINK_DIAGONAL_XMAX_YMAX, links);
+	}
+#else
+	if (X_NOT_MIN)
+	{
+		accel += CalcLinkAccel(id, id - 1, Neighbour,
+			LINK_NEIGHBOUR_XMIN, links);
+	}
+
+	if (X_NOT_MAX)
+	{
+		accel += CalcLinkAccel(id, id + 1, Neighbour,
+			LINK_NEIGHBOUR_XMAX, links);
+	}
+
+	if (Y_NOT_MIN)
+	{
+		accel += CalcLinkAccel(id, id - ClothResolution.x, Neighbour,
+			LINK_NEIGHBOUR_YMIN, links);
+	}
+
+	if (Y_NOT_MAX)
+	{
+		accel += CalcLinkAccel(id, id + ClothResolution.x, Neighbour,
+			LINK_NEIGHBOUR_YMAX, links);
+	}
+
+	if (X_NOT_MIN && Y_NOT_MIN)
+	{
+		accel += CalcLinkAccel(id, id - 1 - ClothResolution.x, Diagonal,
+			LINK_DIAGONAL_XMIN_YMIN, links);
+	}
+
+	if (X_NOT_MAX && Y_NOT_MIN)
+	{
+		accel += CalcLinkAccel(id, id + 1 - ClothResolution.x, Diagonal,
+			LINK_DIAGONAL_XMAX_YMIN, links);
 	}
 
 	if (X_NOT_MIN && Y_NOT_MAX)
 	{
-		normal.xyz += cross(
-			PositionsFrom[id + ClothResolution.x] - PositionsFrom[id],
-			PositionsFrom[id - 1] - PositionsFrom[id]);
+		accel += CalcLinkAccel(id, id - 1 + ClothResolution.x, Diagonal,
+			LINK_DIAGONAL_XMIN_YMAX, links);
+	}
+
+	if (X_NOT_MAX && Y_NOT_MAX)
+	{
+		accel += CalcLinkAccel(id, id + 1 + ClothResolution.x, Diagonal,
+			LINK_DIAGONAL_XMAX_YMAX, links);
+	}
+#endif
+
+#ifdef HINGE_BENDING
+	accel.xyz += asint(HingeForces.Load3(id * 12)) / HINGE_FORCE_SCALE;
+	HingeForces.Store3(id * 12, uint3(0, 0, 0));
+#else
+	if (X_NOT_MIN2)
+	{
+		accel += CalcLinkAccel(id, id - 2, Bending,
+			LINK_BENDING_XMIN, links);
+	}
+
+	if (X_NOT_MAX2)
+	{
+		accel += CalcLinkAccel(id, id + 2, Bending,
+			LINK_BENDING_XMAX, links);
 	}
 
-	Normals[id] = -normalize(normal);
+	if (Y_NOT_MIN2)
+	{
+		accel += CalcLinkAccel(id, id - ClothResolution.x * 2, Bending,
+			LINK_BENDING_YMIN, links);
+	}
+
+	if (Y_NOT_MAX2)
+	{
+		accel += CalcLinkAccel(id, id + ClothResolution.x * 2, Bending,
+			LINK_BENDING_YMAX, links);
+	}
+#endif
+
+	accel.y -= 9.8f;
+
+	float4 newVelocity = VelocitiesFrom[id] + accel * TimeStep;
+	VelocitiesTo[id] = newVelocity;
+	PositionsTo[id] = PositionsFrom[id] + newVelocity * TimeStep;
+	LinksTo[id] = links;
+
+	Normals[id] = ComputeNormal(PositionsFrom, threadID.xy);
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "TestClothLinks.hlsli"
+
+StructuredBuffer<float4> Positions : register(t0);
+StructuredBuffer<float4> PreviousPositions : register(t1);
+StructuredBuffer<uint> Links : register(t2);
+RWStructuredBuffer<float4> DetailPositions : register(u0);
+RWStructuredBuffer<float4> DetailNormals : register(u1);
+RWStructuredBuffer<uint> DetailLinks : register(u2);
+
+cbuffer cbTestClothUpsample
+{
+	uint2 ClothResolution;
+	uint2 RenderResolution;
+	float RenderAlpha;
+	float RestLength;
+	float WrinkleAmplitude;
+	float dummy;
+};
+
+static const float PI = 3.14159265f;
+
+// simulated position blended between the last two steps
+float3 GetPosition(int2 id)
+{
+	uint i = id.x + id.y * ClothResolution.x;
+	return lerp(PreviousPositions[i].xyz, Positions[i].xyz, RenderAlpha);
+}
+
+// control point of the subdivision surface.
+// points beyond the border are extrapolated, so that the surface
+// continues linearly instead of flattening towards the border.
+float3 GetControlPoint(int2 id)
+{
+	int2 maxID = int2(ClothResolution) - 1;
+	int2 inside = clamp(id, 0, maxID);
+	if (all(inside == id))
+	{
+		return GetPosition(id);
+	}
+
+	return 2.0f * GetPosition(inside) - GetPosition(clamp(2 * inside - id, 0, maxID));
+}
+
+// Catmull-Rom weights and their derivatives, interpolating the control points
+float4 GetWeights(float t)
+{
+	return 0.5f * float4(
+		((-t + 2.0f) * t - 1.0f) * t,
+		(3.0f * t - 5.0f) * t * t + 2.0f,
+		((-3.0f * t + 4.0f) * t + 1.0f) * t,
+		(t - 1.0f) * t * t);
+}
+
+float4 GetDerivativeWeights(float t)
+{
+	return 0.5f * float4(
+		(-3.0f * t + 4.0f) * t - 1.0f,
+		(9.0f * t - 10.0f) * t,
+		(-9.0f * t + 8.0f) * t + 1.0f,
+		(3.0f * t - 2.0f) * t);
+}
+
+// whether the simulated quad under a quad of the render grid is drawn
+bool IsQuadIntact(int2 quad)
+{
+	if (any(quad < 0) || any(quad >= int2(RenderResolution) - 1))
+	{
+		return false;
+	}
+
+	float2 center = (quad + 0.5f) * float2(ClothResolution - 1) / float2(RenderResolution - 1);
+	uint2 cell = min(uint2(center), ClothResolution - 2);
+	uint id = cell.x + cell.y * ClothResolution.x;
+	return (Links[id + ClothResolution.x + 1] & LINK_QUAD_BOTTOM_RIGHT) == LINK_QUAD_BOTTOM_RIGHT &&
+		(Links[id] & LINK_QUAD_TOP_LEFT) == LINK_QUAD_TOP_LEFT;
+}
+
+// reconstructs the render grid from the simulated one.
+// the subdivision surface passes through the simulated particles, and wrinkles
+// are added inside the cells that are compressed: a sine across the cell whose
+// amplitude restores the rest length lost to compression. the wrinkles vanish
+// at the particles, so the detail never departs from the simulated solution.
+[numthreads(128, 2, 1)]
+void main(uint3 threadID : SV_DispatchThreadID)
+{
+	if (any(threadID.xy >= RenderResolution))
+	{
+		return;
+	}
+
+	float2 coarse = threadID.xy * float2(ClothResolution - 1) / float2(RenderResolution - 1);
+	int2 cell = int2(min(uint2(coarse), ClothResolution - 2));
+	float2 f = coarse - cell;
+
+	float4 wu = GetWeights(f.x);
+	float4 wv = GetWeights(f.y);
+	float4 du = GetDerivativeWeights(f.x);
+	float4 dv = GetDerivativeWeights(f.y);
+
+	float3 position = 0.0f;
+	float3 tangentU = 0.0f;
+	float3 tangentV = 0.0f;
+	float3 corners[4];
+
+	[unroll]
+	for (int j = 0; j < 4; j++)
+	{
+		[unroll]
+		for (int i = 0; i < 4; i++)
+		{
+			float3 p = GetControlPoint(cell + int2(i - 1, j - 1));
+			position += wu[i] * wv[j] * p;
+			tangentU += du[i] * wv[j] * p;
+			tangentV += wu[i] * dv[j] * p;
+
+			if ((i == 1 || i == 2) && (j == 1 || j == 2))
+			{
+				corners[(i - 1) + (j - 1) * 2] = p;
+			}
+		}
+	}
+
+	// same orientation as the simulated normals (see TestClothUpdate.hlsl)
+	float3 normal = -normalize(cross(tangentU, tangentV));
+
+	// compression along either direction of the cell, blended across it
+	float compressionU = saturate(1.0f - lerp(length(corners[1] - corners[0]),
+		length(corners[3] - corners[2]), f.y) / RestLength);
+	float compressionV = saturate(1.0f - lerp(length(corners[2] - corners[0]),
+		length(corners[3] - corners[1]), f.x) / RestLength);
+
+	// a half wave per cell, alternating in sign between cells.
+	// for small amplitudes the arc length of A sin(pi x / L) is
+	// L (1 + (pi A / 2 L)^2), which recovers the compression c for
+	// A = 2 L sqrt(c) / pi.
+	float amplitudeU = WrinkleAmplitude * 2.0f * RestLength * sqrt(compressionU) / PI;
+	float amplitudeV = WrinkleAmplitude * 2.0f * RestLength * sqrt(compressionV) / PI;
+	float2 signs = (cell & 1) ? -1.0f : 1.0f;
+	float2 waves = signs * sin(PI * f);
+	float2 slopes = signs * PI * cos(PI * f);
+
+	float displacement = amplitudeU * waves.x + amplitudeV * waves.y;
+	float3 bumpedNormal = normal -
+		amplitudeU * slopes.x * tangentU / max(dot(tangentU, tangentU), 1e-12f) -
+		amplitudeV * slopes.y * tangentV / max(dot(tangentV, tangentV), 1e-12f);
+
+	uint id = threadID.x + threadID.y * RenderResolution.x;
+	DetailPositions[id] = float4(position + displacement * normal, 1.0f);
+	DetailNormals[id] = float4(normalize(bumpedNormal), 0.0f);
+
+	int2 id2D = int2(threadID.xy);
+	DetailLinks[id] =
+		(IsQuadIntact(id2D - 1) ? LINK_QUAD_BOTTOM_RIGHT : 0) |
+		(IsQuadIntact(id2D) ? LINK_QUAD_TOP_LEFT : 0);
+}
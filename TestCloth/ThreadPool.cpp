@@ -0,0 +1,210 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(std::uint32_t numThreads)
+{
+	if (numThreads == 0)
+	{
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (std::uint32_t i = 1; i < numThreads; i++)
+	{
+		m_Threads.emplace_back(&ThreadPool::WorkerMain, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Quit = true;
+	}
+	m_JobReady.notify_all();
+
+	for (auto& thread : m_Threads)
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::Dispatch(const std::function<void(std::uint32_t)>& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_pJob = &job;
+		m_NumRunning = static_cast<std::uint32_t>(m_Threads.size());
+		++m_JobGeneration;
+	}
+	m_JobReady.notify_all();
+
+	// the workers use job until they are done, even if it throws here
+	std::exception_ptr exception;
+	try
+	{
+		job(0);
+	}
+	catch (...)
+	{
+		exception = std::current_exception();
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_JobDone.wait(lock, [this]() { return m_NumRunning == 0; });
+		m_pJob = nullptr;
+	}
+
+	if (exception)
+	{
+		std::rethrow_exception(exception);
+	}
+}
+
+void ThreadPool::WorkerMain(std::uint32_t iThread)
+{
+	std::uint64_t generation = 0;
+
+	for (;;)
+	{
+		const std::function<void(std::uint32_t)>* pJob;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_JobReady.wait(lock, [this, generation]()
+			{
+				return m_Quit || m_JobGeneration != generation;
+			});
+
+			if (m_Quit)
+			{
+				return;
+			}
+
+			generation = m_JobGeneration;
+			pJob = m_pJob;
+		}
+
+		(*pJob)(iThread);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (--m_NumRunning == 0)
+		{
+			m_JobDone.notify_all();
+		}
+	}
+}
+
+TaskGraph::TaskId TaskGraph::AddTask(std::function<void()> task)
+{
+	Task newTask;
+	newTask.Function = std::move(task);
+	m_Tasks.push_back(std::move(newTask));
+
+	return static_cast<TaskId>(m_Tasks.size() - 1);
+}
+
+void TaskGraph::AddDependency(TaskId before, TaskId after)
+{
+	m_Tasks[before].Successors.push_back(after);
+	m_Tasks[after].NumPredecessors++;
+}
+
+void TaskGraph::Clear()
+{
+	m_Tasks.clear();
+}
+
+void TaskGraph::Run(ThreadPool& pool)
+{
+	if (m_Tasks.empty())
+	{
+		return;
+	}
+
+	m_NumWaiting.resize(m_Tasks.size());
+	m_ReadyTasks.clear();
+	for (TaskId id = 0; id < GetNumTasks(); id++)
+	{
+		m_NumWaiting[id] = m_Tasks[id].NumPredecessors;
+		if (m_NumWaiting[id] == 0)
+		{
+			m_ReadyTasks.push_back(id);
+		}
+	}
+
+	// ready tasks are popped from the back; start with the first added ones
+	std::reverse(m_ReadyTasks.begin(), m_ReadyTasks.end());
+	m_NumRemaining = GetNumTasks();
+	m_Exception = nullptr;
+
+	pool.Dispatch([this](std::uint32_t)
+	{
+		RunWorker();
+	});
+
+	if (m_Exception)
+	{
+		std::rethrow_exception(m_Exception);
+	}
+}
+
+void TaskGraph::RunWorker()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	for (;;)
+	{
+		m_TaskReady.wait(lock, [this]()
+		{
+			return !m_ReadyTasks.empty() || m_NumRemaining == 0;
+		});
+
+		if (m_ReadyTasks.empty())
+		{
+			return;
+		}
+
+		TaskId id = m_ReadyTasks.back();
+		m_ReadyTasks.pop_back();
+
+		lock.unlock();
+		try
+		{
+			m_Tasks[id].Function();
+		}
+		catch (...)
+		{
+			lock.lock();
+			if (!m_Exception)
+			{
+				m_Exception = std::current_exception();
+			}
+			lock.unlock();
+		}
+		lock.lock();
+
+		std::uint32_t numNewlyReady = 0;
+		for (auto successor : m_Tasks[id].Successors)
+		{
+			if (--m_NumWaiting[successor] == 0)
+			{
+				m_ReadyTasks.push_back(successor);
+				numNewlyReady++;
+			}
+		}
+
+		if (--m_NumRemaining == 0)
+		{
+			m_TaskReady.notify_all();
+		}
+		else if (numNewlyReady > 1)
+		{
+			m_TaskReady.notify_all();
+		}
+		else if (numNewlyReady == 1)
+		{
+			m_TaskReady.notify_one();
+		}
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads running one job at a time on all threads
+class ThreadPool
+{
+public:
+	// numThreads includes the calling thread (0 selects the number of cores)
+	explicit ThreadPool(std::uint32_t numThreads = 0);
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	// number of threads running a job, including the calling thread
+	std::uint32_t GetNumThreads() const
+	{
+		return static_cast<std::uint32_t>(m_Threads.size()) + 1;
+	}
+
+	// run job(iThread) on every worker and on the calling thread (iThread = 0),
+	// and wait until all of them return. an exception thrown by job on the
+	// calling thread is rethrown once the workers are done.
+	void Dispatch(const std::function<void(std::uint32_t)>& job);
+
+private:
+	void WorkerMain(std::uint32_t iThread);
+
+	std::vector<std::thread> m_Threads;
+	std::mutex m_Mutex;
+	std::condition_variable m_JobReady;
+	std::condition_variable m_JobDone;
+	const std::function<void(std::uint32_t)>* m_pJob = nullptr;
+	std::uint64_t m_JobGeneration = 0;
+	std::uint32_t m_NumRunning = 0;
+	bool m_Quit = false;
+};
+
+// tasks with dependencies, built once and run any number of times
+class TaskGraph
+{
+public:
+	typedef std::uint32_t TaskId;
+
+	TaskGraph() = default;
+	TaskGraph(const TaskGraph&) = delete;
+	TaskGraph& operator=(const TaskGraph&) = delete;
+
+	// add task; tasks without dependencies between them may run concurrently
+	TaskId AddTask(std::function<void()> task);
+
+	// make task 'after' wait for task 'before'
+	void AddDependency(TaskId before, TaskId after);
+
+	void Clear();
+
+	std::uint32_t GetNumTasks() const
+	{
+		return static_cast<std::uint32_t>(m_Tasks.size());
+	}
+
+	// run all the tasks on the pool and wait for them.
+	// the first exception thrown by a task is rethrown after all tasks ran.
+	void Run(ThreadPool& pool);
+
+private:
+	struct Task
+	{
+		std::function<void()> Function;
+		std::vector<TaskId> Successors;
+		std::uint32_t NumPredecessors = 0;
+	};
+
+	void RunWorker();
+
+	std::vector<Task> m_Tasks;
+
+	// execution state, guarded by m_Mutex
+	std::mutex m_Mutex;
+	std::condition_variable m_TaskReady;
+	std::vector<TaskId> m_ReadyTasks;
+	std::vector<std::uint32_t> m_NumWaiting;
+	std::uint32_t m_NumRemaining = 0;
+	std::exception_ptr m_Exception;
+};
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// items processed on worker threads of their own, taken in the order they
+// were pushed (and processed in that order with a single thread). the
+// first exception thrown by process is rethrown by Close(), process is no
+// longer called for the items after it.
+template <typename Item>
+class WorkQueue
+{
+public:
+	// done is called for every item processed or skipped, on its worker thread
+	WorkQueue(std::uint32_t numThreads, std::function<void(Item&)> process,
+		std::function<void(Item&)> done = nullptr)
+		: m_Process(process)
+		, m_Done(done)
+	{
+		for (std::uint32_t i = 0; i < std::max(numThreads, 1u); i++)
+		{
+			m_Threads.push_back(std::thread([this]() { WorkerMain(); }));
+		}
+	}
+
+	WorkQueue(const WorkQueue&) = delete;
+	WorkQueue& operator=(const WorkQueue&) = delete;
+
+	// items still waiting are dropped, items being processed are waited for
+	~WorkQueue()
+	{
+		Cancel();
+	}
+
+	void Push(const Item& item)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Items.push_back(item);
+		}
+		m_ItemReady.notify_one();
+	}
+
+	// process the items waiting and stop the threads.
+	// rethrows the first exception of process.
+	void Close()
+	{
+		Stop();
+
+		if (m_Exception)
+		{
+			auto exception = m_Exception;
+			m_Exception = nullptr;
+			std::rethrow_exception(exception);
+		}
+	}
+
+	// stop the threads once the items being processed are done, and return
+	// the items still waiting without processing them
+	std::vector<Item> Cancel()
+	{
+		std::vector<Item> items;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			items.assign(m_Items.begin(), m_Items.end());
+			m_Items.clear();
+		}
+
+		Stop();
+		return items;
+	}
+
+private:
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Closing = true;
+		}
+		m_ItemReady.notify_all();
+
+		for (auto& thread : m_Threads)
+		{
+			if (thread.joinable())
+			{
+				thread.join();
+			}
+		}
+	}
+
+	void WorkerMain()
+	{
+		for (;;)
+		{
+			Item item;
+			bool failed;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_ItemReady.wait(lock, [this]() { return !m_Items.empty() || m_Closing; });
+				if (m_Items.empty())
+				{
+					break;
+				}
+				item = m_Items.front();
+				m_Items.pop_front();
+				failed = m_Exception != nullptr;
+			}
+
+			if (!failed)
+			{
+				try
+				{
+					m_Process(item);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(m_Mutex);
+					if (!m_Exception)
+					{
+						m_Exception = std::current_exception();
+					}
+				}
+			}
+
+			if (m_Done)
+			{
+				m_Done(item);
+			}
+		}
+	}
+
+	std::function<void(Item&)> m_Process;
+	std::function<void(Item&)> m_Done;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_ItemReady;
+	std::deque<Item> m_Items;
+	bool m_Closing = false;
+	std::exception_ptr m_Exception;
+	std::vector<std::thread> m_Threads;
+};
+
+// preallocated frames handed from a producer to a writer thread, which
+// writes them in order. frames are dropped while all of them are waiting,
+// so that the producer never waits for the writer.
+template <typename Frame>
+class FrameQueue
+{
+public:
+	// numBuffers copies of frame are allocated up front
+	FrameQueue(std::uint32_t numBuffers, const Frame& frame, std::function<void(Frame&)> write)
+		: m_Frames(std::max(numBuffers, 1u), frame)
+		, m_DroppedFrames(0)
+		, m_Queue(1, [write](Frame*& pFrame) { write(*pFrame); },
+			[this](Frame*& pFrame) { Release(pFrame); })
+	{
+		for (auto& buffer : m_Frames)
+		{
+			m_FreeFrames.push_back(&buffer);
+		}
+	}
+
+	FrameQueue(const FrameQueue&) = delete;
+	FrameQueue& operator=(const FrameQueue&) = delete;
+
+	// frame to fill and Push(), or null if the frame is dropped because
+	// all buffers are waiting or the queue is closed
+	Frame* Acquire()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_FreeFrames.empty() || m_Closing)
+		{
+			m_DroppedFrames++;
+			return nullptr;
+		}
+		auto pFrame = m_FreeFrames.back();
+		m_FreeFrames.pop_back();
+		return pFrame;
+	}
+
+	void Push(Frame* pFrame)
+	{
+		m_Queue.Push(pFrame);
+	}
+
+	// count a frame dropped before it was acquired
+	void Drop()
+	{
+		m_DroppedFrames++;
+	}
+
+	// write the waiting frames. rethrows the first error of the writer thread.
+	void Close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Closing = true;
+		}
+		m_Queue.Close();
+	}
+
+	std::uint64_t GetDroppedFrames() const { return m_DroppedFrames; }
+
+private:
+	void Release(Frame* pFrame)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_FreeFrames.push_back(pFrame);
+	}
+
+	std::vector<Frame> m_Frames;
+	std::mutex m_Mutex;
+	std::vector<Frame*> m_FreeFrames;
+	bool m_Closing = false;
+	std::atomic<std::uint64_t> m_DroppedFrames;
+
+	// last, so that the writer thread stops before the frames go
+	WorkQueue<Frame*> m_Queue;
+};